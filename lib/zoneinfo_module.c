@@ -7,6 +7,39 @@
 
 #include "datetime.h"
 
+#ifdef HAVE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+// Where the POSIX directory API is available, keys are validated and looked
+// up on the TZPATH in C (see find_tzfile) rather than by _tzpath.find_tzfile.
+#if defined(HAVE_MMAP) && defined(HAVE_DIRENT_H)
+#define NATIVE_TZPATH
+#include <dirent.h>
+#endif
+
+// On Linux, ZoneInfo.watch_tzpath uses inotify to find out when to look for
+// changes on the TZPATH (see _watch.py).
+#ifdef __linux__
+#define HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
+
+// On 64-bit big-endian platforms, the 64-bit transition times in a TZif file
+// already have the in-memory representation of an int64_t array, so they can
+// be borrowed from a mapped file rather than copied.
+#if defined(HAVE_MMAP) && defined(WORDS_BIGENDIAN) && SIZEOF_VOID_P >= 8
+#define BORROW_MAPPED_TRANSITIONS
+#endif
+
 #if PY_VERSION_HEX < 0x03070000
 #define ATLEAST_37
 #ifdef MS_WINDOWS
@@ -28,44 +61,203 @@
 // Imports
 static PyObject *io_open = NULL;
 static PyObject *_tzpath_find_tzfile = NULL;
+static PyObject *_bundle_mod = NULL;
+static PyObject *_watch_mod = NULL;
 static PyObject *_common_mod = NULL;
+// "__zoneinfo_use_attributes__" (see get_local_timestamp)
+static PyObject *USE_ATTRIBUTES_STR = NULL;
+// The arguments of dt.replace(fold=1)
+static PyObject *EMPTY_TUPLE = NULL;
+static PyObject *FOLD_KWARGS = NULL;
 
 typedef struct TransitionRuleType TransitionRuleType;
 typedef struct StrongCacheNode StrongCacheNode;
+typedef struct _zone_lookup _zone_lookup;
 
 typedef struct {
     PyObject *utcoff;
     PyObject *dstoff;
     PyObject *tzname;
     long utcoff_seconds;
+    unsigned char in_dst;  // Whether dstoff is nonzero
 } _ttinfo;
 
+// The Gregorian calendar repeats every 400 years, and each of its years is
+// one of 14 kinds (by the weekday of January 1st and whether it is a leap
+// year), within which the date of a transition rule does not change.
+#define NUM_YEAR_KINDS 14
+
 typedef struct {
     _ttinfo std;
     _ttinfo dst;
     int dst_diff;
     TransitionRuleType *start;
     TransitionRuleType *end;
+    // The local times of the transitions, in seconds since the start of the
+    // year, for each kind of year (see tzrule_transitions)
+    int32_t start_in_year[NUM_YEAR_KINDS];
+    int32_t end_in_year[NUM_YEAR_KINDS];
     unsigned char std_only;
 } _tzrule;
 
+// A TZ string parsed into C values, from which a _tzrule can be built. The
+// abbreviations point into the TZ string itself.
 typedef struct {
-    PyDateTime_TZInfo base;
-    PyObject *key;
-    PyObject *file_repr;
-    PyObject *weakreflist;
+    const char *std_abbr;  // NULL if there is no TZ string
+    Py_ssize_t std_abbr_len;
+    const char *dst_abbr;  // NULL if the rule is STD-only
+    Py_ssize_t dst_abbr_len;
+    long std_offset;
+    long dst_offset;
+    TransitionRuleType *start;
+    TransitionRuleType *end;
+} _tzstr;
+
+// The decoded ttinfo data of a zone, from which the wall-time transition
+// lists, the _ttinfo objects and tzrule_after are built on first use. The
+// arrays share a single allocation, which starts at `utcoff`.
+typedef struct {
+    long *utcoff;
+    long *dstoff;
+    unsigned char *trans_idx;
+    unsigned char *isdst;
+    unsigned char *abbr_idx;  // Offset of each abbreviation in abbr_chars
+    char *abbr_chars;
+    char *tz_str;  // Empty if the zone has no TZ string
+    _tzstr tzstr;
+    size_t ttinfo_before;  // Index of the ttinfo used before any transition
+    int64_t last_trans_wall[2];  // Last entries of the wall-time lists
+    size_t size;  // Size of the allocation starting at `utcoff`
+} _zone_data;
+
+// Copies of the transition lists in Eytzinger order (the implicit binary
+// tree in which the children of the element at 1-based index k are at 2k and
+// 2k + 1), which is searched with fewer cache misses and no unpredictable
+// branches. They are built on first use for zones with enough transitions
+// (see ensure_trans_search), and share a single allocation, which starts at
+// `utc`.
+typedef struct {
+    int64_t *utc;
+    int64_t *wall[2];
+    uint32_t *rank;  // Index in the sorted lists of each element of the tree
+} _trans_search;
+
+// Everything a ZoneInfo object knows about its zone. Zones loaded from
+// identical data (e.g. links such as US/Eastern and America/New_York, or
+// repeated no_cache() calls) share a single block, which is reference counted
+// and only accessed with the GIL held (see publish_zone_block). Nothing in a
+// block changes once it is published, except that the members built on
+// first use are filled in (and freeze_zones may move the tables).
+typedef struct {
+    Py_ssize_t refcnt;
+    Py_hash_t hash;  // Hash of the zone's data, see hash_zone_block
+    unsigned char shared;  // Whether the block is in ZONE_BLOCK_CACHE
     size_t num_transitions;
     size_t num_ttinfos;
     int64_t *trans_list_utc;
     int64_t *trans_list_wall[2];
+    _trans_search trans_search;
     _ttinfo **trans_ttinfos;  // References to the ttinfo for each transition
     _ttinfo *ttinfo_before;
     _tzrule tzrule_after;
     _ttinfo *_ttinfos;  // Unique array of ttinfos for ease of deallocation
+    _zone_data zone_data;
+    PyObject *data_owner;  // Owner of any borrowed transition lists
+    PyObject *frozen;  // Owner of the tables moved by freeze_zones
+    unsigned char borrowed;  // Which tables are borrowed
     unsigned char fixed_offset;
+    const _zone_lookup *lookup;  // The lookup functions for this kind of zone
+    // The number of batch lookups reading the tables without the GIL (see
+    // run_utc_batch), during which freeze_zones must not move them
+    Py_ssize_t batch_lookups;
+} _zone_block;
+
+// The interval of timestamps around the last one looked up in a zone, in
+// which the same ttinfo (and, for UTC timestamps, fold) applies. Lookups are
+// usually close in time to the previous one, so find_ttinfo and fromutc
+// check it before searching the zone's tables.
+typedef struct {
+    int64_t start;
+    int64_t end;  // Exclusive, so the interval is empty if start == end
+    _ttinfo *ttinfo;
+    unsigned char fold;
+    size_t generation;  // TABLES_GENERATION when the interval was found
+} _last_interval;
+
+typedef struct {
+    PyDateTime_TZInfo base;
+    PyObject *key;
+    PyObject *file_repr;
+    PyObject *weakreflist;
+    _zone_block *zone;
+    _last_interval last_wall[2];  // For local timestamps, by fold
+    _last_interval last_utc;
     unsigned char source;
 } PyZoneInfo_ZoneInfo;
 
+// The functions that find the ttinfo for a datetime, which are specialized
+// for each kind of zone (see init_zone_data). find_ttinfo takes a local
+// datetime (or None) and the fold to look it up with, which may differ from
+// that of the datetime; find_ttinfo_fromutc takes a datetime in UTC and also
+// sets whether the local time it converts to is in a fold. Both return NULL
+// on error.
+struct _zone_lookup {
+    _ttinfo *(*find_ttinfo)(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                            unsigned char fold);
+    _ttinfo *(*find_ttinfo_fromutc)(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                                    unsigned char *fold);
+};
+
+static const _zone_lookup FIXED_OFFSET_LOOKUP;
+static const _zone_lookup RULE_ONLY_LOOKUP;
+static const _zone_lookup TRANSITIONS_LOOKUP;
+
+// The raw contents of a TZif file, decoded into C values
+#define TZIF_ERROR_SIZE 96
+typedef struct {
+    size_t num_transitions;
+    size_t num_ttinfos;
+    int64_t *trans_list_utc;
+    unsigned char *trans_idx;
+    long *utcoff;
+    unsigned char *isdst;
+    unsigned char *abbr_idx;  // Offset of each abbreviation in abbr_chars
+    char *abbr_chars;  // NUL-terminated time zone designations
+    size_t num_abbr_chars;
+    char *tz_str;  // The TZ string footer, or NULL if not present
+    // The (big-endian) 64-bit transition times in the source buffer, or NULL
+    // for Version 1 files.
+    const unsigned char *trans_list_utc_be;
+    // The message of the ValueError to raise if parse_tzif fails, or an empty
+    // string if it failed because it ran out of memory.
+    char error[TZIF_ERROR_SIZE];
+} _tzif_data;
+
+#ifdef HAVE_MMAP
+// The contents of a TZif file, either read into a buffer allocated with
+// PyMem_RawMalloc or mapped into memory.
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    int mapped;
+} _file_contents;
+#endif
+
+// A compiled zone bundle (the format is documented in _bundle.py). Bundles
+// are cached by path, and ZoneInfo objects loaded from a bundle borrow their
+// transition lists from it where possible, keeping its capsule alive.
+typedef struct {
+    PyObject *contents;  // Owns `buf`: a _mapped_file capsule or bytes
+    const unsigned char *buf;
+    size_t len;
+    uint32_t num_zones;
+    const unsigned char *index;
+    long long file_id[4];  // Device, inode, size and mtime of the file
+} _zone_bundle;
+
+static const char ZONE_BUNDLE_CAPSULE_NAME[] =
+    "backports.zoneinfo._czoneinfo._zone_bundle";
+
 struct TransitionRuleType {
     int64_t (*year_to_timestamp)(TransitionRuleType *, int);
 };
@@ -98,45 +290,187 @@ struct StrongCacheNode {
 
 static PyTypeObject PyZoneInfo_ZoneInfoType;
 
+// The result of ZoneInfo.lookup
+static PyTypeObject LookupResultType;
+
+static PyStructSequence_Field lookup_result_fields[] = {
+    {"utcoffset", "the offset from UTC, as returned by utcoffset()"},
+    {"dst", "the DST adjustment, as returned by dst()"},
+    {"tzname", "the abbreviation of the time zone, as returned by tzname()"},
+    {"in_fold", "whether the local time is ambiguous, occurring twice"},
+    {"in_gap", "whether the local time is skipped by a transition"},
+    {NULL}};
+
+static PyStructSequence_Desc lookup_result_desc = {
+    .name = "backports.zoneinfo.LookupResult",
+    .doc = "The UTC offset, DST adjustment and abbreviation of a zone at a "
+           "local datetime, and whether that datetime is in a fold or a gap.",
+    .fields = lookup_result_fields,
+    .n_in_sequence = 5};
+
 // Globals
-static PyObject *TIMEDELTA_CACHE = NULL;
+
+// The timedeltas shared by all _ttinfos (see load_timedelta). Offsets that
+// are whole multiples of 15 minutes, up to 25 hours either side of zero, are
+// indexed directly. Any others (mostly those of LMT) go in a fixed-size hash
+// table with open addressing, where an offset that finds no free slot within
+// a few probes replaces the first entry it probed, so the number of
+// timedeltas kept alive is bounded.
+#define MAX_QUARTER_HOURS 100
+#define ODD_OFFSET_BITS 10
+#define ODD_OFFSET_SLOTS (1 << ODD_OFFSET_BITS)
+#define ODD_OFFSET_PROBES 8
+typedef struct {
+    long seconds;
+    PyObject *timedelta;  // NULL for an empty slot
+} _odd_offset;
+static PyObject *QUARTER_HOUR_TIMEDELTAS[2 * MAX_QUARTER_HOURS + 1];
+static _odd_offset ODD_OFFSET_TIMEDELTAS[ODD_OFFSET_SLOTS];
+static Py_ssize_t TIMEDELTA_CACHE_HITS = 0;
+static Py_ssize_t TIMEDELTA_CACHE_MISSES = 0;
+static Py_ssize_t TIMEDELTA_CACHE_SIZE = 0;
+
+// The tznames shared by all _ttinfos (see load_tzname), in a hash table that
+// works like ODD_OFFSET_TIMEDELTAS. The abbreviations in tzdb are at most 6
+// characters long, and longer ones are not cached.
+#define MAX_CACHED_TZNAME 7
+#define TZNAME_BITS 9
+#define TZNAME_SLOTS (1 << TZNAME_BITS)
+#define TZNAME_PROBES 8
+typedef struct {
+    char abbr[MAX_CACHED_TZNAME + 1];
+    PyObject *tzname;  // NULL for an empty slot
+} _tzname_entry;
+static _tzname_entry TZNAME_TABLE[TZNAME_SLOTS];
+
+// The number of module instances using the timedelta and tzname tables
+static Py_ssize_t SHARED_TABLES_USERS = 0;
+
 static PyObject *ZONEINFO_WEAK_CACHE = NULL;
+static PyObject *ZONE_BUNDLE_CACHE = NULL;
+// The shared zone blocks, by hash (see publish_zone_block)
+static PyObject *ZONE_BLOCK_CACHE = NULL;
+#ifdef NATIVE_TZPATH
+// Listings of the directories searched on the TZPATH (see find_tzfile)
+static PyObject *TZPATH_INDEX = NULL;
+// The TZPATH as a tuple of bytes, or None if it can't be searched in C
+static PyObject *TZPATH_ROOTS = NULL;
+// The function registered in _tzpath.TZPATH_CALLBACKS, and that list
+static PyObject *TZPATH_CALLBACK = NULL;
+static PyObject *TZPATH_CALLBACK_LIST = NULL;
+#endif
 static StrongCacheNode *ZONEINFO_STRONG_CACHE = NULL;
+// Incremented when freeze_zones moves the _ttinfo structs of zones, which
+// invalidates the pointers to them in every _last_interval.
+static size_t TABLES_GENERATION = 0;
 static size_t ZONEINFO_STRONG_CACHE_MAX_SIZE = 8;
 
-static _ttinfo NO_TTINFO = {NULL, NULL, NULL, 0};
+static _ttinfo NO_TTINFO = {NULL, NULL, NULL, 0, 0};
 
 // Constants
 static const int EPOCHORDINAL = 719163;
-static int DAYS_IN_MONTH[] = {
-    -1, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31,
-};
-
+// The ordinal of 9999-12-31, the last date a datetime can represent
+static const int MAX_ORDINAL = 3652059;
 static int DAYS_BEFORE_MONTH[] = {
     -1, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334,
 };
 
+// The kind (see NUM_YEAR_KINDS) and the days from the epoch to January 1st
+// of each year from 400 to 799, which give those of any year by adding a
+// multiple of DAYS_IN_400_YEARS (see init_year_table).
+static const int64_t DAYS_IN_400_YEARS = 146097;
+static unsigned char YEAR_KIND[400];
+static int32_t YEAR_START_DAYS[400];
+
 static const int SOURCE_NOCACHE = 0;
 static const int SOURCE_CACHE = 1;
 static const int SOURCE_FILE = 2;
 
+static const unsigned char BORROWED_TRANS_UTC = 1;
+static const unsigned char BORROWED_TRANS_WALL = 2;
+static const unsigned char BORROWED_TTINFOS = 4;
+static const unsigned char BORROWED_TRANS_SEARCH = 8;
+
+// Zones with fewer transitions than this are searched with _bisect, which is
+// as fast for lists that fit in a few cache lines.
+static const size_t TRANS_SEARCH_MIN_TRANSITIONS = 16;
+
 // Forward declarations
 static int
 load_data(PyZoneInfo_ZoneInfo *self, PyObject *file_obj);
+static int
+load_data_from_buffer(PyZoneInfo_ZoneInfo *self, PyObject *contents);
+#ifdef HAVE_MMAP
+static int
+load_data_from_path(PyZoneInfo_ZoneInfo *self, PyObject *file_path);
+static int
+read_tzif_file(const char *path, _file_contents *out);
+static void
+release_file_contents(_file_contents *contents);
+static int
+load_file_contents(PyZoneInfo_ZoneInfo *self, _file_contents *contents,
+                   const _tzif_data *data);
+#endif
+static int
+load_tzif_data(PyZoneInfo_ZoneInfo *self, const _tzif_data *data,
+               PyObject *data_owner);
+static _zone_block *
+new_zone_block(size_t num_transitions, size_t num_ttinfos);
+static int
+alloc_zone_data(_zone_block *zone, size_t abbr_len, size_t tz_str_len);
+static int
+init_zone_data(_zone_block *zone);
+static int
+publish_zone_block(PyZoneInfo_ZoneInfo *self, _zone_block *zone);
 static void
-utcoff_to_dstoff(size_t *trans_idx, long *utcoffs, long *dstoffs,
-                 unsigned char *isdsts, size_t num_transitions,
-                 size_t num_ttinfos);
+release_zone_block(_zone_block *zone);
+static void
+free_zone_data(_zone_block *zone);
+static void
+free_trans_lists(_zone_block *zone);
+static int
+ensure_trans_list_wall(_zone_block *zone);
+static int
+ensure_trans_search(_zone_block *zone);
+static int
+ensure_ttinfos(_zone_block *zone);
+static int
+ensure_tzrule_after(_zone_block *zone);
+static int
+ensure_lookup_tables(_zone_block *zone);
+static int
+freeze_zones(PyObject *zones);
 static int
-ts_to_local(size_t *trans_idx, int64_t *trans_utc, long *utcoff,
-            int64_t *trans_local[2], size_t num_ttinfos,
+parse_tzif(const unsigned char *buf, size_t len, _tzif_data *out);
+static void
+raise_tzif_error(const _tzif_data *data);
+static void
+free_tzif_data(_tzif_data *data);
+static PyObject *
+get_zone_bundle(PyObject *path);
+static uint64_t
+find_bundle_zone(const _zone_bundle *bundle, const char *key, size_t key_len);
+static int
+load_bundle_zone(PyZoneInfo_ZoneInfo *self, const _zone_bundle *bundle,
+                 PyObject *bundle_obj, uint64_t offset);
+static void
+utcoff_to_dstoff(const unsigned char *trans_idx, const long *utcoffs,
+                 long *dstoffs, const unsigned char *isdsts,
+                 size_t num_transitions, size_t num_ttinfos);
+static int
+ts_to_local(const unsigned char *trans_idx, const int64_t *trans_utc,
+            const long *utcoff, int64_t *trans_local[2], size_t num_ttinfos,
             size_t num_transitions);
 
 static int
-parse_tz_str(PyObject *tz_str_obj, _tzrule *out);
+parse_tz_str(const char *tz_str, _tzstr *out);
+static void
+free_tzstr(_tzstr *tzstr);
+static int
+tzstr_to_tzrule(const _tzstr *tzstr, _tzrule *out);
 
 static Py_ssize_t
-parse_abbr(const char *const p, PyObject **abbr);
+parse_abbr(const char *const p, const char **abbr, Py_ssize_t *abbr_len);
 static Py_ssize_t
 parse_tz_delta(const char *const p, long *total_seconds);
 static Py_ssize_t
@@ -146,17 +480,16 @@ static Py_ssize_t
 parse_transition_rule(const char *const p, TransitionRuleType **out);
 
 static _ttinfo *
-find_tzrule_ttinfo(_tzrule *rule, int64_t ts, unsigned char fold, int year);
+find_tzrule_ttinfo(_tzrule *rule, int64_t ts, unsigned char fold, int year,
+                   int64_t *lo, int64_t *hi);
 static _ttinfo *
 find_tzrule_ttinfo_fromutc(_tzrule *rule, int64_t ts, int year,
-                           unsigned char *fold);
+                           unsigned char *fold, int64_t *lo, int64_t *hi);
 
 static int
 build_ttinfo(long utcoffset, long dstoffset, PyObject *tzname, _ttinfo *out);
 static void
 xdecref_ttinfo(_ttinfo *ttinfo);
-static int
-ttinfo_eq(const _ttinfo *const tti0, const _ttinfo *const tti1);
 
 static int
 build_tzrule(PyObject *std_abbr, PyObject *dst_abbr, long std_offset,
@@ -169,17 +502,42 @@ static PyObject *
 load_timedelta(long seconds);
 
 static int
-get_local_timestamp(PyObject *dt, int64_t *local_ts);
+get_local_timestamp(PyObject *dt, int64_t *local_ts, int *year);
+static int
+get_fold(PyObject *dt, unsigned char *fold);
 static _ttinfo *
 find_ttinfo(PyZoneInfo_ZoneInfo *self, PyObject *dt);
 
+static _ttinfo *
+find_utc_ttinfo(_zone_block *zone, int64_t timestamp, int year,
+                unsigned char *fold, int64_t *lo, int64_t *hi);
+static _ttinfo *
+find_local_ttinfo(_zone_block *zone, int64_t ts, unsigned char fold,
+                  int year, int64_t *lo, int64_t *hi);
+
 static int
 ymd_to_ord(int y, int m, int d);
+static void
+ord_to_ymd(int ord, int *y, int *m, int *d);
+static void
+civil_from_days(int32_t days, int *y, int *m, int *d);
+static int64_t
+year_start_timestamp(int year);
+static void
+narrow_interval(int64_t ts, int64_t boundary, int64_t *lo, int64_t *hi);
 static int
 is_leap_year(int year);
+static void
+init_year_table(void);
 
 static size_t
 _bisect(const int64_t value, const int64_t *arr, size_t size);
+static size_t
+_eytzinger_bisect(const int64_t value, const int64_t *tree,
+                  const uint32_t *rank, size_t size);
+static size_t
+bisect_transitions(const _zone_block *zone, const int64_t value,
+                   const int64_t *arr, const int64_t *tree);
 
 static void
 eject_from_strong_cache(const PyTypeObject *const type, PyObject *key);
@@ -190,23 +548,53 @@ update_strong_cache(const PyTypeObject *const type, PyObject *key,
                     PyObject *zone);
 static PyObject *
 zone_from_strong_cache(const PyTypeObject *const type, PyObject *key);
+static PyObject *
+find_tzfile(PyObject *key);
+#ifdef NATIVE_TZPATH
+static int
+forget_tzpath_dirs(PyObject *key);
+#endif
+static PyObject *
+get_shared_cache(void);
+static PyObject *
+load_shared_zone(PyTypeObject *type, PyObject *key);
+static PyObject *
+load_shared_bundle_zone(PyTypeObject *type, PyObject *bundle_obj,
+                        PyObject *key);
 
 static PyObject *
 zoneinfo_new_instance(PyTypeObject *type, PyObject *key)
 {
     PyObject *file_obj = NULL;
     PyObject *file_path = NULL;
+    PyObject *tzdata = NULL;
+
+    PyObject *shared = load_shared_zone(type, key);
+    if (shared != Py_None) {
+        return shared;
+    }
+    Py_DECREF(shared);
 
-    file_path = PyObject_CallFunctionObjArgs(_tzpath_find_tzfile, key, NULL);
+#ifdef NATIVE_TZPATH
+    int retried = 0;
+find:
+#endif
+    file_path = find_tzfile(key);
     if (file_path == NULL) {
         return NULL;
     }
     else if (file_path == Py_None) {
-        file_obj = PyObject_CallMethod(_common_mod, "load_tzdata", "O", key);
-        if (file_obj == NULL) {
-            Py_DECREF(file_path);
+        // Zones from the tzdata package are files in its directory, or the
+        // contents of the file if it is installed as an archive.
+        Py_DECREF(file_path);
+        file_path = PyObject_CallMethod(_common_mod, "find_tzdata", "O", key);
+        if (file_path == NULL) {
             return NULL;
         }
+        else if (!PyUnicode_Check(file_path)) {
+            tzdata = file_path;
+            file_path = NULL;
+        }
     }
 
     PyObject *self = (PyObject *)(type->tp_alloc(type, 0));
@@ -214,24 +602,55 @@ zoneinfo_new_instance(PyTypeObject *type, PyObject *key)
         goto error;
     }
 
-    if (file_obj == NULL) {
+    if (tzdata != NULL) {
+        if (load_data_from_buffer((PyZoneInfo_ZoneInfo *)self, tzdata)) {
+            goto error;
+        }
+    }
+    else {
+#ifdef HAVE_MMAP
+        // Files found on the TZPATH are mapped and parsed in place
+        if (load_data_from_path((PyZoneInfo_ZoneInfo *)self, file_path)) {
+#ifdef NATIVE_TZPATH
+            // The file may have been found in an out-of-date listing of its
+            // directory, in which case the TZPATH is searched again
+            if (!retried && PyErr_ExceptionMatches(PyExc_FileNotFoundError)) {
+                int forgotten = forget_tzpath_dirs(key);
+                if (forgotten > 0) {
+                    PyErr_Clear();
+                    Py_CLEAR(self);
+                    Py_CLEAR(file_path);
+                    retried = 1;
+                    goto find;
+                }
+                else if (forgotten < 0) {
+                    goto error;
+                }
+            }
+#endif
+            goto error;
+        }
+#else
         file_obj = PyObject_CallFunction(io_open, "Os", file_path, "rb");
         if (file_obj == NULL) {
             goto error;
         }
+#endif
     }
 
-    if (load_data((PyZoneInfo_ZoneInfo *)self, file_obj)) {
-        goto error;
-    }
+    if (file_obj != NULL) {
+        if (load_data((PyZoneInfo_ZoneInfo *)self, file_obj)) {
+            goto error;
+        }
 
-    PyObject *rv = PyObject_CallMethod(file_obj, "close", NULL);
-    Py_DECREF(file_obj);
-    file_obj = NULL;
-    if (rv == NULL) {
-        goto error;
+        PyObject *rv = PyObject_CallMethod(file_obj, "close", NULL);
+        Py_DECREF(file_obj);
+        file_obj = NULL;
+        if (rv == NULL) {
+            goto error;
+        }
+        Py_DECREF(rv);
     }
-    Py_DECREF(rv);
 
     ((PyZoneInfo_ZoneInfo *)self)->key = key;
     Py_INCREF(key);
@@ -242,11 +661,15 @@ error:
     self = NULL;
 cleanup:
     if (file_obj != NULL) {
+        PyObject *exc, *val, *tb;
+        PyErr_Fetch(&exc, &val, &tb);
         PyObject *tmp = PyObject_CallMethod(file_obj, "close", NULL);
-        Py_DECREF(tmp);
+        Py_XDECREF(tmp);
+        PyErr_Restore(exc, val, tb);
         Py_DECREF(file_obj);
     }
-    Py_DECREF(file_path);
+    Py_XDECREF(file_path);
+    Py_XDECREF(tzdata);
     return self;
 }
 
@@ -318,29 +741,10 @@ zoneinfo_dealloc(PyObject *obj_self)
         PyObject_ClearWeakRefs(obj_self);
     }
 
-    if (self->trans_list_utc != NULL) {
-        PyMem_Free(self->trans_list_utc);
-    }
-
-    for (size_t i = 0; i < 2; i++) {
-        if (self->trans_list_wall[i] != NULL) {
-            PyMem_Free(self->trans_list_wall[i]);
-        }
-    }
-
-    if (self->_ttinfos != NULL) {
-        for (size_t i = 0; i < self->num_ttinfos; ++i) {
-            xdecref_ttinfo(&(self->_ttinfos[i]));
-        }
-        PyMem_Free(self->_ttinfos);
-    }
-
-    if (self->trans_ttinfos != NULL) {
-        PyMem_Free(self->trans_ttinfos);
+    if (self->zone != NULL) {
+        release_zone_block(self->zone);
     }
 
-    free_tzrule(&(self->tzrule_after));
-
     Py_XDECREF(self->key);
     Py_XDECREF(self->file_repr);
 
@@ -388,6 +792,68 @@ error:
     return NULL;
 }
 
+static PyObject *
+zoneinfo_from_bundle(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *path = NULL;
+    PyObject *key = NULL;
+    PyObject *bundle_obj = NULL;
+    PyZoneInfo_ZoneInfo *self = NULL;
+
+    static char *kwlist[] = {"path", "key", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OU", kwlist, &path,
+                                     &key)) {
+        return NULL;
+    }
+
+    Py_ssize_t key_len;
+    const char *key_str = PyUnicode_AsUTF8AndSize(key, &key_len);
+    if (key_str == NULL) {
+        return NULL;
+    }
+
+    bundle_obj = get_zone_bundle(path);
+    if (bundle_obj == NULL) {
+        return NULL;
+    }
+
+    _zone_bundle *bundle =
+        PyCapsule_GetPointer(bundle_obj, ZONE_BUNDLE_CAPSULE_NAME);
+    uint64_t offset = find_bundle_zone(bundle, key_str, (size_t)key_len);
+    if (offset == 0) {
+        PyObject *not_found_error =
+            PyObject_GetAttrString(_common_mod, "ZoneInfoNotFoundError");
+        if (not_found_error != NULL) {
+            PyErr_Format(not_found_error,
+                         "No time zone found with key %U in bundle %R", key,
+                         path);
+            Py_DECREF(not_found_error);
+        }
+        goto error;
+    }
+
+    self = (PyZoneInfo_ZoneInfo *)(type->tp_alloc(type, 0));
+    if (self == NULL) {
+        goto error;
+    }
+
+    if (load_bundle_zone(self, bundle, bundle_obj, offset)) {
+        goto error;
+    }
+
+    // Like zones loaded with from_file, these zones can't be pickled by key
+    self->source = SOURCE_FILE;
+    self->key = key;
+    Py_INCREF(key);
+
+    Py_DECREF(bundle_obj);
+    return (PyObject *)self;
+error:
+    Py_XDECREF(self);
+    Py_DECREF(bundle_obj);
+    return NULL;
+}
+
 static PyObject *
 zoneinfo_no_cache(PyTypeObject *cls, PyObject *args, PyObject *kwargs)
 {
@@ -405,1875 +871,6246 @@ zoneinfo_no_cache(PyTypeObject *cls, PyObject *args, PyObject *kwargs)
     return out;
 }
 
-static PyObject *
-zoneinfo_clear_cache(PyObject *cls, PyObject *args, PyObject *kwargs)
+#ifdef HAVE_MMAP
+// The state shared by the threads started by run_parallel
+typedef struct {
+    void (*work)(void *arg, size_t i);
+    void *arg;
+    size_t num_jobs;
+    size_t next_job;
+    size_t num_running;
+    PyThread_type_lock lock;  // Protects next_job and num_running
+    PyThread_type_lock done;  // Held until the last thread has finished
+} _parallel_state;
+
+/* Runs jobs until there are none left.
+ *
+ * This runs without the GIL (possibly on a thread that has no Python thread
+ * state at all), so neither it nor the work function may use the Python API.
+ */
+static void
+parallel_worker(void *arg)
 {
-    PyObject *only_keys = NULL;
-    static char *kwlist[] = {"only_keys", NULL};
+    _parallel_state *state = arg;
 
-    if (!(PyArg_ParseTupleAndKeywords(args, kwargs, "|$O", kwlist,
-                                      &only_keys))) {
-        return NULL;
+    for (;;) {
+        PyThread_acquire_lock(state->lock, WAIT_LOCK);
+        size_t i = state->next_job++;
+        PyThread_release_lock(state->lock);
+        if (i >= state->num_jobs) {
+            break;
+        }
+
+        state->work(state->arg, i);
     }
 
-    PyTypeObject *type = (PyTypeObject *)cls;
-    PyObject *weak_cache = get_weak_cache(type);
+    PyThread_acquire_lock(state->lock, WAIT_LOCK);
+    int last = --state->num_running == 0;
+    PyThread_release_lock(state->lock);
+    if (last) {
+        PyThread_release_lock(state->done);
+    }
+}
 
-    if (only_keys == NULL || only_keys == Py_None) {
-        PyObject *rv = PyObject_CallMethod(weak_cache, "clear", NULL);
-        if (rv != NULL) {
-            Py_DECREF(rv);
-        }
+/* Calls `work(arg, i)` for each `i` in [0, num_jobs) on up to `num_workers`
+ * threads, including this one, and waits for all of the calls to finish.
+ *
+ * This must be called with the GIL held, which is released while the jobs
+ * run. It returns -1 (with an exception set) only if the locks could not be
+ * allocated, in which case no jobs were run.
+ */
+static int
+run_parallel(void (*work)(void *, size_t), void *arg, size_t num_jobs,
+             size_t num_workers)
+{
+    _parallel_state state = {
+        .work = work,
+        .arg = arg,
+        .num_jobs = num_jobs,
+        .next_job = 0,
+        .num_running = 1,  // This thread
+        .lock = PyThread_allocate_lock(),
+        .done = PyThread_allocate_lock(),
+    };
+    int rv = -1;
 
-        clear_strong_cache(type);
+    if (state.lock == NULL || state.done == NULL) {
+        PyErr_NoMemory();
+        goto cleanup;
     }
-    else {
-        PyObject *item = NULL;
-        PyObject *pop = PyUnicode_FromString("pop");
-        if (pop == NULL) {
-            return NULL;
-        }
-
-        PyObject *iter = PyObject_GetIter(only_keys);
-        if (iter == NULL) {
-            Py_DECREF(pop);
-            return NULL;
-        }
 
-        while ((item = PyIter_Next(iter))) {
-            // Remove from strong cache
-            eject_from_strong_cache(type, item);
+    PyThread_acquire_lock(state.done, WAIT_LOCK);
 
-            // Remove from weak cache
-            PyObject *tmp = PyObject_CallMethodObjArgs(weak_cache, pop, item,
-                                                       Py_None, NULL);
+    Py_BEGIN_ALLOW_THREADS;
+    for (size_t i = 1; i < num_workers && i < num_jobs; ++i) {
+        PyThread_acquire_lock(state.lock, WAIT_LOCK);
+        state.num_running++;
+        PyThread_release_lock(state.lock);
 
-            Py_DECREF(item);
-            if (tmp == NULL) {
-                break;
-            }
-            Py_DECREF(tmp);
+        // If a thread can't be started, make do with the ones we have
+        if (PyThread_start_new_thread(parallel_worker, &state) ==
+            (unsigned long)-1) {
+            PyThread_acquire_lock(state.lock, WAIT_LOCK);
+            state.num_running--;
+            PyThread_release_lock(state.lock);
+            break;
         }
-        Py_DECREF(iter);
-        Py_DECREF(pop);
     }
 
-    if (PyErr_Occurred()) {
-        return NULL;
-    }
+    parallel_worker(&state);
+    PyThread_acquire_lock(state.done, WAIT_LOCK);
+    Py_END_ALLOW_THREADS;
 
-    Py_RETURN_NONE;
+    PyThread_release_lock(state.done);
+    rv = 0;
+cleanup:
+    if (state.lock != NULL) {
+        PyThread_free_lock(state.lock);
+    }
+    if (state.done != NULL) {
+        PyThread_free_lock(state.done);
+    }
+    return rv;
 }
 
-static PyObject *
-zoneinfo_utcoffset(PyObject *self, PyObject *dt)
+/* Returns the default number of threads for run_parallel. */
+static size_t
+default_num_workers(void)
 {
-    _ttinfo *tti = find_ttinfo((PyZoneInfo_ZoneInfo *)self, dt);
-    if (tti == NULL) {
-        return NULL;
-    }
-    Py_INCREF(tti->utcoff);
-    return tti->utcoff;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (size_t)num_cpus : 1;
 }
 
-static PyObject *
-zoneinfo_dst(PyObject *self, PyObject *dt)
+// A TZif file being loaded by ZoneInfo.preload
+typedef struct {
+    PyObject *key;
+    PyObject *file_path;
+    PyObject *path_bytes;
+    _file_contents contents;
+    _tzif_data data;
+    int read_errno;
+    int parse_failed;
+} _preload_job;
+
+/* Reads and parses one TZif file for ZoneInfo.preload (see run_parallel). */
+static void
+preload_job(void *arg, size_t i)
 {
-    _ttinfo *tti = find_ttinfo((PyZoneInfo_ZoneInfo *)self, dt);
-    if (tti == NULL) {
-        return NULL;
+    _preload_job *job = &(((_preload_job *)arg)[i]);
+    job->read_errno =
+        read_tzif_file(PyBytes_AS_STRING(job->path_bytes), &(job->contents));
+    if (!job->read_errno) {
+        job->parse_failed =
+            parse_tzif(job->contents.buf, job->contents.len, &(job->data));
     }
-    Py_INCREF(tti->dstoff);
-    return tti->dstoff;
 }
 
-static PyObject *
-zoneinfo_tzname(PyObject *self, PyObject *dt)
+/* Adds a zone loaded by preload_files to the weak cache (unless another
+ * thread got there first) and appends the cached instance to `loaded`.
+ * Returns 0 on success and -1 on failure.
+ */
+static int
+cache_preloaded_zone(PyObject *weak_cache, PyZoneInfo_ZoneInfo *self,
+                     PyObject *loaded)
 {
-    _ttinfo *tti = find_ttinfo((PyZoneInfo_ZoneInfo *)self, dt);
-    if (tti == NULL) {
-        return NULL;
+    PyObject *instance =
+        PyObject_CallMethod(weak_cache, "setdefault", "OO", self->key, self);
+    if (instance == NULL) {
+        return -1;
     }
-    Py_INCREF(tti->tzname);
-    return tti->tzname;
-}
+    ((PyZoneInfo_ZoneInfo *)instance)->source = SOURCE_CACHE;
 
-#define HASTZINFO(p) (((_PyDateTime_BaseTZInfo *)(p))->hastzinfo)
-#define GET_DT_TZINFO(p) \
-    (HASTZINFO(p) ? ((PyDateTime_DateTime *)(p))->tzinfo : Py_None)
+    int rv = PyList_Append(loaded, instance);
+    Py_DECREF(instance);
+    return rv;
+}
 
-static PyObject *
-zoneinfo_fromutc(PyObject *obj_self, PyObject *dt)
+/* Loads the zones with the specified keys that are not already in the weak
+ * cache and that are found in the shared cache or on the TZPATH, adding them
+ * to the weak cache.
+ *
+ * As in the constructor, zones in the shared cache (see set_shared_cache)
+ * are loaded from it, so only the others are looked up on the TZPATH. Their
+ * files are read and parsed on up to `num_workers` threads without holding
+ * the GIL; the GIL is only held to resolve the paths beforehand and to build
+ * the ZoneInfo objects afterwards, which is done in the order of `keys`,
+ * stopping at the first error.
+ *
+ * The new zones are appended to `loaded`, so that they are not evicted from
+ * the weak cache before the caller can use them. Returns 0 on success and -1
+ * on failure.
+ */
+static int
+preload_files(PyTypeObject *type, PyObject *keys, size_t num_workers,
+              PyObject *loaded)
 {
-    if (!PyDateTime_Check(dt)) {
-        PyErr_SetString(PyExc_TypeError,
-                        "fromutc: argument must be a datetime");
-        return NULL;
-    }
-    if (GET_DT_TZINFO(dt) != obj_self) {
-        PyErr_SetString(PyExc_ValueError,
-                        "fromutc: dt.tzinfo "
-                        "is not self");
-        return NULL;
+    _preload_job *jobs = NULL;
+    size_t num_jobs = 0;
+    PyObject *seen = NULL;
+    int rv = -1;
+
+    PyObject *weak_cache = get_weak_cache(type);
+    if (weak_cache == NULL) {
+        return -1;
     }
 
-    PyZoneInfo_ZoneInfo *self = (PyZoneInfo_ZoneInfo *)obj_self;
+    PyObject *shared_cache = get_shared_cache();
+    if (shared_cache == NULL) {
+        return -1;
+    }
 
-    int64_t timestamp;
-    if (get_local_timestamp(dt, &timestamp)) {
-        return NULL;
+    Py_ssize_t num_keys = PyList_GET_SIZE(keys);
+    jobs = PyMem_Calloc(num_keys, sizeof(_preload_job));
+    seen = PySet_New(NULL);
+    if (jobs == NULL || seen == NULL) {
+        if (jobs == NULL) {
+            PyErr_NoMemory();
+        }
+        goto cleanup;
     }
-    size_t num_trans = self->num_transitions;
 
-    _ttinfo *tti = NULL;
-    unsigned char fold = 0;
+    for (Py_ssize_t i = 0; i < num_keys; ++i) {
+        PyObject *key = PyList_GET_ITEM(keys, i);
+        int duplicate = PySet_Contains(seen, key);
+        if (duplicate < 0 || (!duplicate && PySet_Add(seen, key))) {
+            goto cleanup;
+        }
+        else if (duplicate) {
+            continue;
+        }
 
-    if (num_trans >= 1 && timestamp < self->trans_list_utc[0]) {
-        tti = self->ttinfo_before;
-    }
-    else if (num_trans == 0 ||
-             timestamp > self->trans_list_utc[num_trans - 1]) {
-        tti = find_tzrule_ttinfo_fromutc(&(self->tzrule_after), timestamp,
-                                         PyDateTime_GET_YEAR(dt), &fold);
+        PyObject *cached =
+            PyObject_CallMethod(weak_cache, "get", "O", key, Py_None);
+        if (cached == NULL) {
+            goto cleanup;
+        }
+        Py_DECREF(cached);
+        if (cached != Py_None) {
+            continue;
+        }
 
-        // Immediately after the last manual transition, the fold/gap is
-        // between self->trans_ttinfos[num_transitions - 1] and whatever
-        // ttinfo applies immediately after the last transition, not between
-        // the STD and DST rules in the tzrule_after, so we may need to
-        // adjust the fold value.
-        if (num_trans) {
-            _ttinfo *tti_prev = NULL;
-            if (num_trans == 1) {
-                tti_prev = self->ttinfo_before;
-            }
-            else {
-                tti_prev = self->trans_ttinfos[num_trans - 2];
+        if (shared_cache != Py_None) {
+            PyObject *shared =
+                load_shared_bundle_zone(type, shared_cache, key);
+            if (shared == NULL) {
+                goto cleanup;
             }
-            int64_t diff = tti_prev->utcoff_seconds - tti->utcoff_seconds;
-            if (diff > 0 &&
-                timestamp < (self->trans_list_utc[num_trans - 1] + diff)) {
-                fold = 1;
+            else if (shared != Py_None) {
+                int cache_failed = cache_preloaded_zone(
+                    weak_cache, (PyZoneInfo_ZoneInfo *)shared, loaded);
+                Py_DECREF(shared);
+                if (cache_failed) {
+                    goto cleanup;
+                }
+                continue;
             }
+            Py_DECREF(shared);
         }
-    }
-    else {
-        size_t idx = _bisect(timestamp, self->trans_list_utc, num_trans);
-        _ttinfo *tti_prev = NULL;
 
-        if (idx >= 2) {
-            tti_prev = self->trans_ttinfos[idx - 2];
-            tti = self->trans_ttinfos[idx - 1];
+        PyObject *file_path = find_tzfile(key);
+        if (file_path == NULL) {
+            goto cleanup;
         }
-        else {
-            tti_prev = self->ttinfo_before;
-            tti = self->trans_ttinfos[0];
+        else if (file_path == Py_None) {
+            // Zones from the tzdata package are loaded by the constructor
+            Py_DECREF(file_path);
+            continue;
         }
 
-        // Detect fold
-        int64_t shift =
-            (int64_t)(tti_prev->utcoff_seconds - tti->utcoff_seconds);
-        if (shift > (timestamp - self->trans_list_utc[idx - 1])) {
-            fold = 1;
+        _preload_job *job = &(jobs[num_jobs++]);
+        job->key = key;
+        job->file_path = file_path;
+        if (!PyUnicode_FSConverter(file_path, &(job->path_bytes))) {
+            goto cleanup;
         }
     }
 
-    PyObject *tmp = PyNumber_Add(dt, tti->utcoff);
-    if (tmp == NULL) {
-        return NULL;
+    if (num_jobs && run_parallel(preload_job, jobs, num_jobs, num_workers)) {
+        goto cleanup;
     }
 
-    if (fold) {
-        if (PyDateTime_CheckExact(tmp)) {
-            ((PyDateTime_DateTime *)tmp)->fold = 1;
-            dt = tmp;
-        }
-        else {
-            PyObject *replace = PyObject_GetAttrString(tmp, "replace");
-            PyObject *args = PyTuple_New(0);
-            PyObject *kwargs = PyDict_New();
-            PyObject *one = NULL;
-
-#ifdef ATLEAST_37
-            one = PyLong_FromLong(1);
-#else
-            one = _PyLong_One;
-#endif
-
-            Py_DECREF(tmp);
-            if (args == NULL || kwargs == NULL || replace == NULL ||
-                one == NULL) {
-                Py_XDECREF(args);
-                Py_XDECREF(kwargs);
-                Py_XDECREF(replace);
-                return NULL;
+    for (size_t i = 0; i < num_jobs; ++i) {
+        _preload_job *job = &(jobs[i]);
+        if (job->read_errno) {
+#ifdef NATIVE_TZPATH
+            // As in zoneinfo_new_instance, a file that was found in an
+            // out-of-date listing is left to the constructor to search for
+            // again
+            if (job->read_errno == ENOENT) {
+                int forgotten = forget_tzpath_dirs(job->key);
+                if (forgotten > 0) {
+                    continue;
+                }
+                else if (forgotten < 0) {
+                    goto cleanup;
+                }
             }
+#endif
+            errno = job->read_errno;
+            PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError,
+                                                 job->file_path);
+            goto cleanup;
+        }
+        else if (job->parse_failed) {
+            raise_tzif_error(&(job->data));
+            goto cleanup;
+        }
 
-            dt = NULL;
-            if (!PyDict_SetItemString(kwargs, "fold", one)) {
-                dt = PyObject_Call(replace, args, kwargs);
-            }
+        PyZoneInfo_ZoneInfo *self =
+            (PyZoneInfo_ZoneInfo *)(type->tp_alloc(type, 0));
+        if (self == NULL) {
+            goto cleanup;
+        }
 
-            Py_DECREF(args);
-            Py_DECREF(kwargs);
-            Py_DECREF(replace);
-#ifdef ATLEAST_37
-            Py_DECREF(one);
-#endif
+        if (load_file_contents(self, &(job->contents), &(job->data))) {
+            Py_DECREF(self);
+            goto cleanup;
+        }
+        self->key = job->key;
+        Py_INCREF(job->key);
 
-            if (dt == NULL) {
-                return NULL;
-            }
+        int cache_failed = cache_preloaded_zone(weak_cache, self, loaded);
+        Py_DECREF(self);
+        if (cache_failed) {
+            goto cleanup;
         }
     }
-    else {
-        dt = tmp;
-    }
-    return dt;
-}
 
-static PyObject *
-zoneinfo_repr(PyZoneInfo_ZoneInfo *self)
-{
-    PyObject *rv = NULL;
-    const char *type_name = Py_TYPE((PyObject *)self)->tp_name;
-    if (!(self->key == Py_None)) {
-        rv = PyUnicode_FromFormat("%s(key=%R)", type_name, self->key);
-    }
-    else {
-        assert(PyUnicode_Check(self->file_repr));
-        rv = PyUnicode_FromFormat("%s.from_file(%U)", type_name,
-                                  self->file_repr);
+    rv = 0;
+cleanup:
+    if (jobs != NULL) {
+        for (size_t i = 0; i < num_jobs; ++i) {
+            _preload_job *job = &(jobs[i]);
+            release_file_contents(&(job->contents));
+            free_tzif_data(&(job->data));
+            Py_XDECREF(job->file_path);
+            Py_XDECREF(job->path_bytes);
+        }
+        PyMem_Free(jobs);
     }
-
+    Py_XDECREF(seen);
+    Py_DECREF(shared_cache);
     return rv;
 }
+#endif
 
 static PyObject *
-zoneinfo_str(PyZoneInfo_ZoneInfo *self)
+zoneinfo_preload(PyTypeObject *type, PyObject *args, PyObject *kwargs)
 {
-    if (!(self->key == Py_None)) {
-        Py_INCREF(self->key);
-        return self->key;
-    }
-    else {
-        return zoneinfo_repr(self);
+    static char *kwlist[] = {"keys", "workers", "freeze", NULL};
+    PyObject *keys = NULL;
+    PyObject *workers = Py_None;
+    int freeze = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O$p", kwlist, &keys,
+                                     &workers, &freeze)) {
+        return NULL;
     }
-}
 
-/* Pickles the ZoneInfo object by key and source.
- *
- * ZoneInfo objects are pickled by reference to the TZif file that they came
- * from, which means that the exact transitions may be different or the file
- * may not un-pickle if the data has changed on disk in the interim.
- *
- * It is necessary to include a bit indicating whether or not the object
- * was constructed from the cache, because from-cache objects will hit the
- * unpickling process's cache, whereas no-cache objects will bypass it.
- *
- * Objects constructed from ZoneInfo.from_file cannot be pickled.
- */
-static PyObject *
-zoneinfo_reduce(PyObject *obj_self, PyObject *unused)
-{
-    PyZoneInfo_ZoneInfo *self = (PyZoneInfo_ZoneInfo *)obj_self;
-    if (self->source == SOURCE_FILE) {
-        // Objects constructed from files cannot be pickled.
-        PyObject *pickle = PyImport_ImportModule("pickle");
-        if (pickle == NULL) {
+    Py_ssize_t num_workers = 1;
+    if (workers != Py_None) {
+        num_workers = PyNumber_AsSsize_t(workers, PyExc_OverflowError);
+        if (num_workers == -1 && PyErr_Occurred()) {
             return NULL;
         }
-
-        PyObject *pickle_error =
-            PyObject_GetAttrString(pickle, "PicklingError");
-        Py_DECREF(pickle);
-        if (pickle_error == NULL) {
+        else if (num_workers <= 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "workers must be greater than 0");
             return NULL;
         }
+    }
+#ifdef HAVE_MMAP
+    else {
+        num_workers = (Py_ssize_t)default_num_workers();
+    }
+#endif
 
-        PyErr_Format(pickle_error,
-                     "Cannot pickle a ZoneInfo file from a file stream.");
-        Py_DECREF(pickle_error);
+    PyObject *loaded = NULL;
+    PyObject *out = NULL;
+
+    keys = PySequence_List(keys);
+    if (keys == NULL) {
         return NULL;
     }
 
-    unsigned char from_cache = self->source == SOURCE_CACHE ? 1 : 0;
-    PyObject *constructor = PyObject_GetAttrString(obj_self, "_unpickle");
+    loaded = PyList_New(0);
+    if (loaded == NULL) {
+        goto error;
+    }
 
-    if (constructor == NULL) {
-        return NULL;
+#ifdef HAVE_MMAP
+    if (preload_files(type, keys, (size_t)num_workers, loaded)) {
+        goto error;
     }
+#endif
 
-    PyObject *rv = Py_BuildValue("O(OB)", constructor, self->key, from_cache);
-    Py_DECREF(constructor);
-    return rv;
+    // Everything that was not loaded above (zones that were already cached or
+    // that come from the tzdata package) is loaded by the constructor, which
+    // also adds the zones to the strong cache.
+    Py_ssize_t num_keys = PyList_GET_SIZE(keys);
+    out = PyList_New(num_keys);
+    if (out == NULL) {
+        goto error;
+    }
+
+    for (Py_ssize_t i = 0; i < num_keys; ++i) {
+        PyObject *zone = PyObject_CallFunctionObjArgs(
+            (PyObject *)type, PyList_GET_ITEM(keys, i), NULL);
+        if (zone == NULL) {
+            goto error;
+        }
+        PyList_SET_ITEM(out, i, zone);
+    }
+
+    if (freeze && freeze_zones(out)) {
+        goto error;
+    }
+
+    Py_DECREF(loaded);
+    Py_DECREF(keys);
+    return out;
+error:
+    Py_XDECREF(out);
+    Py_XDECREF(loaded);
+    Py_DECREF(keys);
+    return NULL;
 }
 
 static PyObject *
-zoneinfo__unpickle(PyTypeObject *cls, PyObject *args)
+zoneinfo_clear_cache(PyObject *cls, PyObject *args, PyObject *kwargs)
 {
-    PyObject *key;
-    unsigned char from_cache;
-    if (!PyArg_ParseTuple(args, "OB", &key, &from_cache)) {
+    PyObject *only_keys = NULL;
+    static char *kwlist[] = {"only_keys", NULL};
+
+    if (!(PyArg_ParseTupleAndKeywords(args, kwargs, "|$O", kwlist,
+                                      &only_keys))) {
         return NULL;
     }
 
-    if (from_cache) {
-        PyObject *val_args = Py_BuildValue("(O)", key);
-        if (val_args == NULL) {
+    PyTypeObject *type = (PyTypeObject *)cls;
+    PyObject *weak_cache = get_weak_cache(type);
+
+    if (only_keys == NULL || only_keys == Py_None) {
+        PyObject *rv = PyObject_CallMethod(weak_cache, "clear", NULL);
+        if (rv != NULL) {
+            Py_DECREF(rv);
+        }
+
+        clear_strong_cache(type);
+    }
+    else {
+        PyObject *item = NULL;
+        PyObject *pop = PyUnicode_FromString("pop");
+        if (pop == NULL) {
             return NULL;
         }
 
-        PyObject *rv = zoneinfo_new(cls, val_args, NULL);
+        PyObject *iter = PyObject_GetIter(only_keys);
+        if (iter == NULL) {
+            Py_DECREF(pop);
+            return NULL;
+        }
 
-        Py_DECREF(val_args);
-        return rv;
+        while ((item = PyIter_Next(iter))) {
+            // Remove from strong cache
+            eject_from_strong_cache(type, item);
+
+            // Remove from weak cache
+            PyObject *tmp = PyObject_CallMethodObjArgs(weak_cache, pop, item,
+                                                       Py_None, NULL);
+
+            Py_DECREF(item);
+            if (tmp == NULL) {
+                break;
+            }
+            Py_DECREF(tmp);
+        }
+        Py_DECREF(iter);
+        Py_DECREF(pop);
     }
-    else {
-        return zoneinfo_new_instance(cls, key);
+
+    if (PyErr_Occurred()) {
+        return NULL;
     }
+
+    Py_RETURN_NONE;
 }
 
-/* It is relatively expensive to construct new timedelta objects, and in most
- * cases we're looking at a relatively small number of timedeltas, such as
- * integer number of hours, etc. We will keep a cache so that we construct
- * a minimal number of these.
- *
- * Possibly this should be replaced with an LRU cache so that it's not possible
- * for the memory usage to explode from this, but in order for this to be a
- * serious problem, one would need to deliberately craft a malicious time zone
- * file with many distinct offsets. As of tzdb 2019c, loading every single zone
- * fills the cache with ~450 timedeltas for a total size of ~12kB.
+/* Removes the specified keys from the caches, like clear_cache.
  *
- * This returns a new reference to the timedelta.
+ * This returns a list of the keys that had a zone in the weak cache, which
+ * ZoneInfo.watch_tzpath uses to reload the zones that were in use.
  */
 static PyObject *
-load_timedelta(long seconds)
+zoneinfo__evict_keys(PyObject *cls, PyObject *keys)
 {
-    PyObject *rv = NULL;
-    PyObject *pyoffset = PyLong_FromLong(seconds);
-    if (pyoffset == NULL) {
+    PyTypeObject *type = (PyTypeObject *)cls;
+    PyObject *weak_cache = get_weak_cache(type);
+    PyObject *item = NULL;
+
+    PyObject *evicted = PyList_New(0);
+    if (evicted == NULL) {
         return NULL;
     }
-    int contains = PyDict_Contains(TIMEDELTA_CACHE, pyoffset);
-    if (contains == -1) {
-        goto error;
-    }
 
-    if (!contains) {
-        PyObject *tmp = PyDateTimeAPI->Delta_FromDelta(
-            0, seconds, 0, 1, PyDateTimeAPI->DeltaType);
+    PyObject *iter = PyObject_GetIter(keys);
+    if (iter == NULL) {
+        Py_DECREF(evicted);
+        return NULL;
+    }
 
-        if (tmp == NULL) {
-            goto error;
+    while ((item = PyIter_Next(iter))) {
+        // The zone is taken out of the weak cache first, since ejecting it
+        // from the strong cache may drop the last reference to it
+        PyObject *zone = PyObject_CallMethod(weak_cache, "pop", "OO", item,
+                                             Py_None);
+        if (zone == NULL ||
+            (zone != Py_None && PyList_Append(evicted, item))) {
+            Py_XDECREF(zone);
+            Py_DECREF(item);
+            break;
         }
-
-        rv = PyDict_SetDefault(TIMEDELTA_CACHE, pyoffset, tmp);
-        Py_DECREF(tmp);
+        eject_from_strong_cache(type, item);
+        Py_DECREF(zone);
+        Py_DECREF(item);
     }
-    else {
-        rv = PyDict_GetItem(TIMEDELTA_CACHE, pyoffset);
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(evicted);
+        return NULL;
     }
 
-    Py_DECREF(pyoffset);
-    Py_INCREF(rv);
-    return rv;
-error:
-    Py_DECREF(pyoffset);
-    return NULL;
+    return evicted;
 }
 
-/* Constructor for _ttinfo object - this starts by initializing the _ttinfo
- * to { NULL, NULL, NULL }, so that Py_XDECREF will work on partially
- * initialized _ttinfo objects.
- */
-static int
-build_ttinfo(long utcoffset, long dstoffset, PyObject *tzname, _ttinfo *out)
+static PyObject *
+zoneinfo_watch_tzpath(PyObject *cls, PyObject *args, PyObject *kwargs)
 {
-    out->utcoff = NULL;
-    out->dstoff = NULL;
-    out->tzname = NULL;
+    PyObject *watcher_type =
+        PyObject_GetAttrString(_watch_mod, "TZPathWatcher");
+    if (watcher_type == NULL) {
+        return NULL;
+    }
 
-    out->utcoff_seconds = utcoffset;
-    out->utcoff = load_timedelta(utcoffset);
-    if (out->utcoff == NULL) {
-        return -1;
+    // TZPathWatcher takes the class followed by the arguments to this method
+    PyObject *watcher_args = NULL;
+    PyObject *prefix = PyTuple_Pack(1, cls);
+    if (prefix != NULL) {
+        watcher_args = PySequence_Concat(prefix, args);
+        Py_DECREF(prefix);
     }
 
-    out->dstoff = load_timedelta(dstoffset);
-    if (out->dstoff == NULL) {
-        return -1;
+    PyObject *watcher = NULL;
+    if (watcher_args != NULL) {
+        watcher = PyObject_Call(watcher_type, watcher_args, kwargs);
+        Py_DECREF(watcher_args);
     }
+    Py_DECREF(watcher_type);
+    return watcher;
+}
 
-    out->tzname = tzname;
-    Py_INCREF(tzname);
+static PyObject *
+zoneinfo_utcoffset(PyObject *self, PyObject *dt)
+{
+    _ttinfo *tti = find_ttinfo((PyZoneInfo_ZoneInfo *)self, dt);
+    if (tti == NULL) {
+        return NULL;
+    }
+    Py_INCREF(tti->utcoff);
+    return tti->utcoff;
+}
 
-    return 0;
+static PyObject *
+zoneinfo_dst(PyObject *self, PyObject *dt)
+{
+    _ttinfo *tti = find_ttinfo((PyZoneInfo_ZoneInfo *)self, dt);
+    if (tti == NULL) {
+        return NULL;
+    }
+    Py_INCREF(tti->dstoff);
+    return tti->dstoff;
 }
 
-/* Decrease reference count on any non-NULL members of a _ttinfo  */
-static void
-xdecref_ttinfo(_ttinfo *ttinfo)
+static PyObject *
+zoneinfo_tzname(PyObject *self, PyObject *dt)
 {
-    if (ttinfo != NULL) {
-        Py_XDECREF(ttinfo->utcoff);
-        Py_XDECREF(ttinfo->dstoff);
-        Py_XDECREF(ttinfo->tzname);
+    _ttinfo *tti = find_ttinfo((PyZoneInfo_ZoneInfo *)self, dt);
+    if (tti == NULL) {
+        return NULL;
     }
+    Py_INCREF(tti->tzname);
+    return tti->tzname;
 }
 
-/* Equality function for _ttinfo. */
-static int
-ttinfo_eq(const _ttinfo *const tti0, const _ttinfo *const tti1)
+static PyObject *
+zoneinfo_lookup(PyObject *obj_self, PyObject *dt)
 {
-    int rv;
-    if ((rv = PyObject_RichCompareBool(tti0->utcoff, tti1->utcoff, Py_EQ)) <
-        1) {
-        goto end;
+    if (!PyDateTime_Check(dt)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "lookup: argument must be a datetime");
+        return NULL;
     }
 
-    if ((rv = PyObject_RichCompareBool(tti0->dstoff, tti1->dstoff, Py_EQ)) <
-        1) {
-        goto end;
+    PyZoneInfo_ZoneInfo *self = (PyZoneInfo_ZoneInfo *)obj_self;
+    const _zone_lookup *lookup = self->zone->lookup;
+    unsigned char fold;
+    if (get_fold(dt, &fold)) {
+        return NULL;
     }
 
-    if ((rv = PyObject_RichCompareBool(tti0->tzname, tti1->tzname, Py_EQ)) <
-        1) {
-        goto end;
+    _ttinfo *tti = lookup->find_ttinfo(self, dt, fold);
+    if (tti == NULL) {
+        return NULL;
     }
-end:
-    return rv;
+
+    // The offsets for fold=0 and fold=1 only differ in a fold, where fold=0
+    // gets the larger offset from before the transition, and in a gap, where
+    // it gets the smaller one.
+    _ttinfo *tti_other = lookup->find_ttinfo(self, dt, !fold);
+    if (tti_other == NULL) {
+        return NULL;
+    }
+
+    long utcoff_0 = tti->utcoff_seconds;
+    long utcoff_1 = tti_other->utcoff_seconds;
+    if (fold) {
+        utcoff_0 = tti_other->utcoff_seconds;
+        utcoff_1 = tti->utcoff_seconds;
+    }
+
+    PyObject *result = PyStructSequence_New(&LookupResultType);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(tti->utcoff);
+    PyStructSequence_SET_ITEM(result, 0, tti->utcoff);
+    Py_INCREF(tti->dstoff);
+    PyStructSequence_SET_ITEM(result, 1, tti->dstoff);
+    Py_INCREF(tti->tzname);
+    PyStructSequence_SET_ITEM(result, 2, tti->tzname);
+    PyStructSequence_SET_ITEM(result, 3, PyBool_FromLong(utcoff_0 > utcoff_1));
+    PyStructSequence_SET_ITEM(result, 4, PyBool_FromLong(utcoff_0 < utcoff_1));
+    return result;
 }
 
-/* Given a file-like object, this populates a ZoneInfo object
- *
- * The current version calls into a Python function to read the data from
- * file into Python objects, and this translates those Python objects into
- * C values and calculates derived values (e.g. dstoff) in C.
- *
- * This returns 0 on success and -1 on failure.
+#define HASTZINFO(p) (((_PyDateTime_BaseTZInfo *)(p))->hastzinfo)
+#define GET_DT_TZINFO(p) \
+    (HASTZINFO(p) ? ((PyDateTime_DateTime *)(p))->tzinfo : Py_None)
+
+/* Creates the local datetime for `dt`, an exact datetime in UTC, given the
+ * offset and fold that apply to it.
  *
- * The function will never return while `self` is partially initialized —
- * the object only needs to be freed / deallocated if this succeeds.
+ * This is equivalent to (dt + utcoff).replace(fold=fold), but it calculates
+ * the fields in C and creates the result directly.
  */
-static int
-load_data(PyZoneInfo_ZoneInfo *self, PyObject *file_obj)
+static PyObject *
+local_datetime_from_utc(PyObject *dt, long utcoff_seconds, unsigned char fold)
 {
-    PyObject *data_tuple = NULL;
+    int ord = ymd_to_ord(PyDateTime_GET_YEAR(dt), PyDateTime_GET_MONTH(dt),
+                         PyDateTime_GET_DAY(dt));
+    int64_t seconds = (int64_t)(ord - 1) * 86400 +
+                      PyDateTime_DATE_GET_HOUR(dt) * 3600 +
+                      PyDateTime_DATE_GET_MINUTE(dt) * 60 +
+                      PyDateTime_DATE_GET_SECOND(dt) + utcoff_seconds;
+    if (seconds < 0 || seconds >= (int64_t)MAX_ORDINAL * 86400) {
+        PyErr_SetString(PyExc_OverflowError, "date value out of range");
+        return NULL;
+    }
 
-    long *utcoff = NULL;
-    long *dstoff = NULL;
-    size_t *trans_idx = NULL;
-    unsigned char *isdst = NULL;
+    int year, month, day;
+    ord_to_ymd((int)(seconds / 86400) + 1, &year, &month, &day);
+    int second = (int)(seconds % 86400);
 
-    self->trans_list_utc = NULL;
-    self->trans_list_wall[0] = NULL;
-    self->trans_list_wall[1] = NULL;
-    self->trans_ttinfos = NULL;
-    self->_ttinfos = NULL;
-    self->file_repr = NULL;
+    return PyDateTimeAPI->DateTime_FromDateAndTimeAndFold(
+        year, month, day, second / 3600, (second / 60) % 60, second % 60,
+        PyDateTime_DATE_GET_MICROSECOND(dt), GET_DT_TZINFO(dt), fold,
+        PyDateTimeAPI->DateTimeType);
+}
 
-    size_t ttinfos_allocated = 0;
+static PyObject *
+zoneinfo_fromutc(PyObject *obj_self, PyObject *dt)
+{
+    if (!PyDateTime_Check(dt)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "fromutc: argument must be a datetime");
+        return NULL;
+    }
+    if (GET_DT_TZINFO(dt) != obj_self) {
+        PyErr_SetString(PyExc_ValueError,
+                        "fromutc: dt.tzinfo "
+                        "is not self");
+        return NULL;
+    }
 
-    data_tuple = PyObject_CallMethod(_common_mod, "load_data", "O", file_obj);
+    _zone_block *zone = ((PyZoneInfo_ZoneInfo *)obj_self)->zone;
 
-    if (data_tuple == NULL) {
-        goto error;
+    unsigned char fold = 0;
+    _ttinfo *tti =
+        zone->lookup->find_ttinfo_fromutc((PyZoneInfo_ZoneInfo *)obj_self, dt,
+                                          &fold);
+    if (tti == NULL) {
+        return NULL;
     }
 
-    if (!PyTuple_CheckExact(data_tuple)) {
-        PyErr_Format(PyExc_TypeError, "Invalid data result type: %r",
-                     data_tuple);
-        goto error;
+    if (PyDateTime_CheckExact(dt)) {
+        return local_datetime_from_utc(dt, tti->utcoff_seconds, fold);
     }
 
-    // Unpack the data tuple
-    PyObject *trans_idx_list = PyTuple_GetItem(data_tuple, 0);
-    if (trans_idx_list == NULL) {
-        goto error;
+    // Subclasses may override the arithmetic, so the result is constructed
+    // with the same operations as in the pure Python implementation.
+    PyObject *tmp = PyNumber_Add(dt, tti->utcoff);
+    if (tmp == NULL || !fold) {
+        return tmp;
     }
 
-    PyObject *trans_utc = PyTuple_GetItem(data_tuple, 1);
-    if (trans_utc == NULL) {
-        goto error;
+    PyObject *replace = PyObject_GetAttrString(tmp, "replace");
+    Py_DECREF(tmp);
+    if (replace == NULL) {
+        return NULL;
     }
 
-    PyObject *utcoff_list = PyTuple_GetItem(data_tuple, 2);
-    if (utcoff_list == NULL) {
-        goto error;
-    }
+    dt = PyObject_Call(replace, EMPTY_TUPLE, FOLD_KWARGS);
+    Py_DECREF(replace);
+    return dt;
+}
 
-    PyObject *isdst_list = PyTuple_GetItem(data_tuple, 3);
-    if (isdst_list == NULL) {
-        goto error;
-    }
+// The range of UTC timestamps that datetime can represent, from 0001-01-01
+// to 9999-12-31T23:59:59
+#define MIN_TIMESTAMP (-(int64_t)(EPOCHORDINAL - 1) * 86400)
+#define MAX_TIMESTAMP ((int64_t)(MAX_ORDINAL - EPOCHORDINAL + 1) * 86400 - 1)
 
-    PyObject *abbr = PyTuple_GetItem(data_tuple, 4);
-    if (abbr == NULL) {
-        goto error;
-    }
+// Batch lookups over fewer elements than this keep the GIL, since releasing
+// it would cost more than the lookups themselves
+#define BATCH_GIL_MINSIZE 2048
 
-    PyObject *tz_str = PyTuple_GetItem(data_tuple, 5);
-    if (tz_str == NULL) {
-        goto error;
+// The arrays that a batch lookup at UTC timestamps fills in, any of which may
+// be NULL: the UTC offsets in seconds, whether DST is in effect, the local
+// timestamps (in the same units as trans_list_wall) and their folds.
+typedef struct {
+    int32_t *offsets;
+    unsigned char *in_dst;
+    int64_t *local;
+    unsigned char *fold;
+} _utc_batch_output;
+
+/* Gets a C-contiguous buffer of `obj` for a batch lookup, whose items must
+ * be `itemsize` bytes long and have one of the native struct formats in
+ * `formats`. `flags` may add PyBUF_WRITABLE for output buffers.
+ */
+static int
+get_batch_buffer(PyObject *obj, const char *name, Py_ssize_t itemsize,
+                 const char *formats, int flags, Py_buffer *view)
+{
+    if (PyObject_GetBuffer(obj, view,
+                           flags | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS)) {
+        return -1;
     }
 
-    // Load the relevant sizes
-    Py_ssize_t num_transitions = PyTuple_Size(trans_utc);
-    if (num_transitions < 0) {
-        goto error;
+    // A NULL format means unsigned bytes
+    const char *format = view->format != NULL ? view->format : "B";
+    const char *given = format;
+    if (*format == '@') {
+        ++format;
     }
-
-    Py_ssize_t num_ttinfos = PyTuple_Size(utcoff_list);
-    if (num_ttinfos < 0) {
-        goto error;
+    if (view->itemsize != itemsize || format[0] == '\0' ||
+        format[1] != '\0' || strchr(formats, format[0]) == NULL) {
+        PyErr_Format(PyExc_TypeError,
+                     "%s must be a buffer of %zd-byte items with one of the "
+                     "formats '%s', not '%s'",
+                     name, itemsize, formats, given);
+        PyBuffer_Release(view);
+        return -1;
     }
 
-    self->num_transitions = (size_t)num_transitions;
-    self->num_ttinfos = (size_t)num_ttinfos;
+    return 0;
+}
 
-    // Load the transition indices and list
-    self->trans_list_utc =
-        PyMem_Malloc(self->num_transitions * sizeof(int64_t));
-    trans_idx = PyMem_Malloc(self->num_transitions * sizeof(Py_ssize_t));
+/* Checks that a buffer of a batch lookup has `n` items, like its input. */
+static int
+check_batch_length(const Py_buffer *view, const char *name,
+                   const char *input, Py_ssize_t n)
+{
+    if (view->len / view->itemsize != n) {
+        PyErr_Format(PyExc_ValueError, "%s must have the same length as %s",
+                     name, input);
+        return -1;
+    }
 
-    for (size_t i = 0; i < self->num_transitions; ++i) {
-        PyObject *num = PyTuple_GetItem(trans_utc, i);
-        if (num == NULL) {
-            goto error;
-        }
-        self->trans_list_utc[i] = PyLong_AsLongLong(num);
-        if (self->trans_list_utc[i] == -1 && PyErr_Occurred()) {
-            goto error;
-        }
+    return 0;
+}
 
-        num = PyTuple_GetItem(trans_idx_list, i);
-        if (num == NULL) {
-            goto error;
-        }
+/* Returns the year of a UTC timestamp, clamping it to [MIN_TIMESTAMP,
+ * MAX_TIMESTAMP] first: timestamps just outside that range only come from
+ * shifting local timestamps near its ends by their offsets.
+ */
+static int
+timestamp_year(int64_t timestamp)
+{
+    if (timestamp < MIN_TIMESTAMP) {
+        timestamp = MIN_TIMESTAMP;
+    }
+    else if (timestamp > MAX_TIMESTAMP) {
+        timestamp = MAX_TIMESTAMP;
+    }
 
-        Py_ssize_t cur_trans_idx = PyLong_AsSsize_t(num);
-        if (cur_trans_idx == -1) {
-            goto error;
-        }
+    int64_t days = timestamp / 86400 - (timestamp % 86400 < 0);
 
-        trans_idx[i] = (size_t)cur_trans_idx;
-        if (trans_idx[i] > self->num_ttinfos) {
-            PyErr_Format(
-                PyExc_ValueError,
-                "Invalid transition index found while reading TZif: %zd",
-                cur_trans_idx);
+    int year, month, day;
+    civil_from_days((int32_t)days, &year, &month, &day);
+    return year;
+}
 
-            goto error;
-        }
-    }
+/* Looks up `n` UTC timestamps in a zone, whose tables must have been built
+ * by ensure_lookup_tables, filling in the arrays in `out`.
+ *
+ * This uses no Python objects, so it is called without the GIL. It returns
+ * -1 on success, or the index of the first timestamp that is out of range.
+ */
+static Py_ssize_t
+batch_lookup_utc(_zone_block *zone, const int64_t *timestamps, Py_ssize_t n,
+                 const _utc_batch_output *out)
+{
+    // The interval in which the ttinfo and fold found last apply, which
+    // successive timestamps usually fall in
+    int64_t lo = 0;
+    int64_t hi = 0;
+    _ttinfo *tti = NULL;
+    unsigned char fold = 0;
 
-    // Load UTC offsets and isdst (size num_ttinfos)
-    utcoff = PyMem_Malloc(self->num_ttinfos * sizeof(long));
-    isdst = PyMem_Malloc(self->num_ttinfos * sizeof(unsigned char));
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        int64_t ts = timestamps[i];
+        if (ts < lo || ts >= hi) {
+            if (ts < MIN_TIMESTAMP || ts > MAX_TIMESTAMP) {
+                return i;
+            }
 
-    if (utcoff == NULL || isdst == NULL) {
-        goto error;
-    }
-    for (size_t i = 0; i < self->num_ttinfos; ++i) {
-        PyObject *num = PyTuple_GetItem(utcoff_list, i);
-        if (num == NULL) {
-            goto error;
+            lo = MIN_TIMESTAMP;
+            hi = MAX_TIMESTAMP + 1;
+            tti = find_utc_ttinfo(zone, ts, timestamp_year(ts), &fold, &lo,
+                                  &hi);
         }
 
-        utcoff[i] = PyLong_AsLong(num);
-        if (utcoff[i] == -1 && PyErr_Occurred()) {
-            goto error;
+        if (out->offsets != NULL) {
+            out->offsets[i] = (int32_t)tti->utcoff_seconds;
         }
-
-        num = PyTuple_GetItem(isdst_list, i);
-        if (num == NULL) {
-            goto error;
+        if (out->in_dst != NULL) {
+            out->in_dst[i] = tti->in_dst;
         }
-
-        int isdst_with_error = PyObject_IsTrue(num);
-        if (isdst_with_error == -1) {
-            goto error;
+        if (out->local != NULL) {
+            out->local[i] = ts + tti->utcoff_seconds;
         }
-        else {
-            isdst[i] = (unsigned char)isdst_with_error;
+        if (out->fold != NULL) {
+            out->fold[i] = fold;
         }
     }
 
-    dstoff = PyMem_Calloc(self->num_ttinfos, sizeof(long));
-    if (dstoff == NULL) {
-        goto error;
+    return -1;
+}
+
+/* Runs batch_lookup_utc over the timestamps in a buffer, without the GIL if
+ * there are enough of them. Returns 0 on success and -1 on failure.
+ */
+static int
+run_utc_batch(PyObject *obj_self, const Py_buffer *timestamps,
+              const _utc_batch_output *out)
+{
+    _zone_block *zone = ((PyZoneInfo_ZoneInfo *)obj_self)->zone;
+    if (ensure_lookup_tables(zone)) {
+        return -1;
     }
 
-    // Derive dstoff and trans_list_wall from the information we've loaded
-    utcoff_to_dstoff(trans_idx, utcoff, dstoff, isdst, self->num_transitions,
-                     self->num_ttinfos);
+    Py_ssize_t n = timestamps->len / 8;
+    Py_ssize_t error_idx;
+    zone->batch_lookups++;
+    if (n >= BATCH_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS;
+        error_idx = batch_lookup_utc(zone, timestamps->buf, n, out);
+        Py_END_ALLOW_THREADS;
+    }
+    else {
+        error_idx = batch_lookup_utc(zone, timestamps->buf, n, out);
+    }
+    zone->batch_lookups--;
 
-    if (ts_to_local(trans_idx, self->trans_list_utc, utcoff,
-                    self->trans_list_wall, self->num_ttinfos,
-                    self->num_transitions)) {
-        goto error;
+    if (error_idx >= 0) {
+        PyErr_Format(PyExc_OverflowError,
+                     "timestamps[%zd] is out of the range of datetime",
+                     error_idx);
+        return -1;
     }
 
-    // Build _ttinfo objects from utcoff, dstoff and abbr
-    self->_ttinfos = PyMem_Malloc(self->num_ttinfos * sizeof(_ttinfo));
-    for (size_t i = 0; i < self->num_ttinfos; ++i) {
-        PyObject *tzname = PyTuple_GetItem(abbr, i);
-        if (tzname == NULL) {
-            goto error;
-        }
+    return 0;
+}
 
-        ttinfos_allocated++;
-        if (build_ttinfo(utcoff[i], dstoff[i], tzname, &(self->_ttinfos[i]))) {
-            goto error;
-        }
+static PyObject *
+zoneinfo_utcoffsets(PyObject *obj_self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = {"timestamps", "offsets", "isdst", NULL};
+    PyObject *timestamps_obj;
+    PyObject *offsets_obj;
+    PyObject *isdst_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|O:utcoffsets", kwlist,
+                                     &timestamps_obj, &offsets_obj,
+                                     &isdst_obj)) {
+        return NULL;
     }
 
-    // Build our mapping from transition to the ttinfo that applies
-    self->trans_ttinfos =
-        PyMem_Calloc(self->num_transitions, sizeof(_ttinfo *));
-    for (size_t i = 0; i < self->num_transitions; ++i) {
-        size_t ttinfo_idx = trans_idx[i];
-        assert(ttinfo_idx < self->num_ttinfos);
-        self->trans_ttinfos[i] = &(self->_ttinfos[ttinfo_idx]);
-    }
-
-    // Set ttinfo_before to the first non-DST transition
-    for (size_t i = 0; i < self->num_ttinfos; ++i) {
-        if (!isdst[i]) {
-            self->ttinfo_before = &(self->_ttinfos[i]);
-            break;
-        }
+    Py_buffer timestamps = {NULL};
+    Py_buffer offsets = {NULL};
+    Py_buffer isdst = {NULL};
+    PyObject *rv = NULL;
+
+    if (get_batch_buffer(timestamps_obj, "timestamps", 8, "lqn", 0,
+                         &timestamps) ||
+        get_batch_buffer(offsets_obj, "offsets", 4, "il", PyBUF_WRITABLE,
+                         &offsets) ||
+        (isdst_obj != Py_None &&
+         get_batch_buffer(isdst_obj, "isdst", 1, "?bB", PyBUF_WRITABLE,
+                          &isdst))) {
+        goto cleanup;
     }
 
-    // If there are only DST ttinfos, pick the first one, if there are no
-    // ttinfos at all, set ttinfo_before to NULL
-    if (self->ttinfo_before == NULL && self->num_ttinfos > 0) {
-        self->ttinfo_before = &(self->_ttinfos[0]);
+    Py_ssize_t n = timestamps.len / 8;
+    if (check_batch_length(&offsets, "offsets", "timestamps", n) ||
+        (isdst.obj != NULL &&
+         check_batch_length(&isdst, "isdst", "timestamps", n))) {
+        goto cleanup;
     }
 
-    if (tz_str != Py_None && PyObject_IsTrue(tz_str)) {
-        if (parse_tz_str(tz_str, &(self->tzrule_after))) {
-            goto error;
-        }
+    _utc_batch_output out = {offsets.buf, isdst.buf, NULL, NULL};
+    if (run_utc_batch(obj_self, &timestamps, &out)) {
+        goto cleanup;
     }
-    else {
-        if (!self->num_ttinfos) {
-            PyErr_Format(PyExc_ValueError, "No time zone information found.");
-            goto error;
-        }
 
-        size_t idx;
-        if (!self->num_transitions) {
-            idx = self->num_ttinfos - 1;
-        }
-        else {
-            idx = trans_idx[self->num_transitions - 1];
-        }
+    rv = Py_None;
+    Py_INCREF(rv);
+cleanup:
+    if (timestamps.obj != NULL) {
+        PyBuffer_Release(&timestamps);
+    }
+    if (offsets.obj != NULL) {
+        PyBuffer_Release(&offsets);
+    }
+    if (isdst.obj != NULL) {
+        PyBuffer_Release(&isdst);
+    }
+    return rv;
+}
 
-        _ttinfo *tti = &(self->_ttinfos[idx]);
-        build_tzrule(tti->tzname, NULL, tti->utcoff_seconds, 0, NULL, NULL,
-                     &(self->tzrule_after));
+static PyObject *
+zoneinfo_fromutc_timestamps(PyObject *obj_self, PyObject *args,
+                            PyObject *kwargs)
+{
+    static char *kwlist[] = {"timestamps", "local", "fold", NULL};
+    PyObject *timestamps_obj;
+    PyObject *local_obj;
+    PyObject *fold_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|O:fromutc_timestamps",
+                                     kwlist, &timestamps_obj, &local_obj,
+                                     &fold_obj)) {
+        return NULL;
+    }
 
-        // We've abused the build_tzrule constructor to construct an STD-only
-        // rule mimicking whatever ttinfo we've picked up, but it's possible
-        // that the one we've picked up is a DST zone, so we need to make sure
-        // that the dstoff is set correctly in that case.
-        if (PyObject_IsTrue(tti->dstoff)) {
-            _ttinfo *tti_after = &(self->tzrule_after.std);
-            Py_DECREF(tti_after->dstoff);
-            tti_after->dstoff = tti->dstoff;
-            Py_INCREF(tti_after->dstoff);
-        }
+    Py_buffer timestamps = {NULL};
+    Py_buffer local = {NULL};
+    Py_buffer fold = {NULL};
+    PyObject *rv = NULL;
+
+    if (get_batch_buffer(timestamps_obj, "timestamps", 8, "lqn", 0,
+                         &timestamps) ||
+        get_batch_buffer(local_obj, "local", 8, "lqn", PyBUF_WRITABLE,
+                         &local) ||
+        (fold_obj != Py_None &&
+         get_batch_buffer(fold_obj, "fold", 1, "?bB", PyBUF_WRITABLE,
+                          &fold))) {
+        goto cleanup;
     }
 
-    // Determine if this is a "fixed offset" zone, meaning that the output of
-    // the utcoffset, dst and tzname functions does not depend on the specific
-    // datetime passed.
-    //
-    // We make three simplifying assumptions here:
-    //
-    // 1. If tzrule_after is not std_only, it has transitions that might occur
-    //    (it is possible to construct TZ strings that specify STD and DST but
-    //    no transitions ever occur, such as AAA0BBB,0/0,J365/25).
-    // 2. If self->_ttinfos contains more than one _ttinfo object, the objects
-    //    represent different offsets.
-    // 3. self->ttinfos contains no unused _ttinfos (in which case an otherwise
-    //    fixed-offset zone with extra _ttinfos defined may appear to *not* be
-    //    a fixed offset zone).
-    //
-    // Violations to these assumptions would be fairly exotic, and exotic
-    // zones should almost certainly not be used with datetime.time (the
-    // only thing that would be affected by this).
-    if (self->num_ttinfos > 1 || !self->tzrule_after.std_only) {
-        self->fixed_offset = 0;
+    Py_ssize_t n = timestamps.len / 8;
+    if (check_batch_length(&local, "local", "timestamps", n) ||
+        (fold.obj != NULL &&
+         check_batch_length(&fold, "fold", "timestamps", n))) {
+        goto cleanup;
     }
-    else if (self->num_ttinfos == 0) {
-        self->fixed_offset = 1;
+
+    _utc_batch_output out = {NULL, NULL, local.buf, fold.buf};
+    if (run_utc_batch(obj_self, &timestamps, &out)) {
+        goto cleanup;
     }
-    else {
-        int constant_offset =
-            ttinfo_eq(&(self->_ttinfos[0]), &self->tzrule_after.std);
-        if (constant_offset < 0) {
-            goto error;
+
+    rv = Py_None;
+    Py_INCREF(rv);
+cleanup:
+    if (timestamps.obj != NULL) {
+        PyBuffer_Release(&timestamps);
+    }
+    if (local.obj != NULL) {
+        PyBuffer_Release(&local);
+    }
+    if (fold.obj != NULL) {
+        PyBuffer_Release(&fold);
+    }
+    return rv;
+}
+
+// The policies of toutc_timestamps for local times that are in a gap, which
+// index GAP_POLICIES...
+#define GAP_RAISE 0
+#define GAP_SHIFT_FORWARD 1
+#define GAP_SHIFT_BACKWARD 2
+#define GAP_MASK 3
+static const char *const GAP_POLICIES[] = {"raise", "shift_forward",
+                                           "shift_backward", "mask", NULL};
+
+// ... and for local times that are in a fold, which index FOLD_POLICIES
+// except for FOLD_GIVEN, where the fold of each one is given in an array
+#define FOLD_RAISE 0
+#define FOLD_EARLIEST 1
+#define FOLD_LATEST 2
+#define FOLD_MASK 3
+#define FOLD_GIVEN 4
+static const char *const FOLD_POLICIES[] = {"raise", "earliest", "latest",
+                                            "mask", NULL};
+
+// The UTC timestamp written for local times masked by the policies, which is
+// the one NumPy uses for NaT
+#define MASKED_TIMESTAMP INT64_MIN
+
+// Why a batch conversion from local timestamps stopped
+#define BATCH_OUT_OF_RANGE 0
+#define BATCH_IN_GAP 1
+#define BATCH_IN_FOLD 2
+
+// The arguments of a batch conversion from local timestamps: the arrays it
+// fills in (`in_gap` and `in_fold` may be NULL), the policies and, for
+// FOLD_GIVEN, the folds to use.
+typedef struct {
+    int64_t *utc;
+    unsigned char *in_gap;
+    unsigned char *in_fold;
+    unsigned char gap_policy;
+    unsigned char fold_policy;
+    const unsigned char *folds;
+} _local_batch;
+
+/* Parses a policy name of toutc_timestamps into its index in `policies`,
+ * returning -1 if it is not one of them.
+ */
+static int
+parse_batch_policy(PyObject *obj, const char *name,
+                   const char *const *policies)
+{
+    if (PyUnicode_Check(obj)) {
+        for (int i = 0; policies[i] != NULL; ++i) {
+            if (PyUnicode_CompareWithASCIIString(obj, policies[i]) == 0) {
+                return i;
+            }
+        }
+    }
+
+    PyErr_Format(PyExc_ValueError, "invalid %s policy: %R", name, obj);
+    return -1;
+}
+
+/* Finds the UTC timestamp of the transition that creates the gap a local
+ * timestamp is in, given the offsets before and after it.
+ *
+ * That is the first UTC timestamp in (ts - off_after, ts - off_before] at
+ * which the offset is off_after, so it is found by bisection, which works
+ * the same for transitions from the list and from tzrule_after.
+ */
+static int64_t
+find_gap_transition(_zone_block *zone, int64_t ts, int32_t off_before,
+                    int32_t off_after)
+{
+    int64_t before = ts - off_after;
+    int64_t after = ts - off_before;
+    while (after - before > 1) {
+        int64_t mid = before + (after - before) / 2;
+
+        int64_t lo = INT64_MIN;
+        int64_t hi = INT64_MAX;
+        unsigned char fold;
+        _ttinfo *tti =
+            find_utc_ttinfo(zone, mid, timestamp_year(mid), &fold, &lo, &hi);
+        if (tti->utcoff_seconds == off_after) {
+            after = mid;
         }
         else {
-            self->fixed_offset = constant_offset;
+            before = mid;
         }
     }
 
-    int rv = 0;
-    goto cleanup;
-error:
-    // These resources only need to be freed if we have failed, if we succeed
-    // in initializing a PyZoneInfo_ZoneInfo object, we can rely on its dealloc
-    // method to free the relevant resources.
-    if (self->trans_list_utc != NULL) {
-        PyMem_Free(self->trans_list_utc);
-        self->trans_list_utc = NULL;
-    }
+    return after;
+}
 
-    for (size_t i = 0; i < 2; ++i) {
-        if (self->trans_list_wall[i] != NULL) {
-            PyMem_Free(self->trans_list_wall[i]);
-            self->trans_list_wall[i] = NULL;
+/* Converts `n` local timestamps in a zone, whose tables must have been built
+ * by ensure_lookup_tables, to UTC under the policies in `batch`.
+ *
+ * Each one is looked up with both folds: where the offsets agree it is
+ * unambiguous, where the offset with fold=0 is greater it is in a fold and
+ * otherwise it is in a gap.
+ *
+ * This uses no Python objects, so it is called without the GIL. It returns
+ * -1 on success, or the index of the first timestamp that is out of range or
+ * that the policies reject, with the reason in *error.
+ */
+static Py_ssize_t
+batch_local_to_utc(_zone_block *zone, const int64_t *local, Py_ssize_t n,
+                   const _local_batch *batch, unsigned char *error)
+{
+    // The intervals in which the offsets found last with each fold apply
+    int64_t lo[2] = {0, 0};
+    int64_t hi[2] = {0, 0};
+    int32_t offset[2] = {0, 0};
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        int64_t ts = local[i];
+        for (unsigned char fold = 0; fold < 2; ++fold) {
+            if (ts >= lo[fold] && ts < hi[fold]) {
+                continue;
+            }
+            if (ts < MIN_TIMESTAMP || ts > MAX_TIMESTAMP) {
+                *error = BATCH_OUT_OF_RANGE;
+                return i;
+            }
+
+            lo[fold] = MIN_TIMESTAMP;
+            hi[fold] = MAX_TIMESTAMP + 1;
+            offset[fold] = (int32_t)find_local_ttinfo(zone, ts, fold,
+                                                      timestamp_year(ts),
+                                                      &lo[fold], &hi[fold])
+                               ->utcoff_seconds;
+        }
+
+        unsigned char in_gap = offset[0] < offset[1];
+        unsigned char in_fold = offset[0] > offset[1];
+        int64_t utc;
+        if (in_gap) {
+            if (batch->gap_policy == GAP_RAISE) {
+                *error = BATCH_IN_GAP;
+                return i;
+            }
+            else if (batch->gap_policy == GAP_MASK) {
+                utc = MASKED_TIMESTAMP;
+            }
+            else {
+                int64_t transition =
+                    find_gap_transition(zone, ts, offset[0], offset[1]);
+                utc = batch->gap_policy == GAP_SHIFT_FORWARD ? transition
+                                                             : transition - 1;
+            }
+        }
+        else if (in_fold) {
+            if (batch->fold_policy == FOLD_RAISE) {
+                *error = BATCH_IN_FOLD;
+                return i;
+            }
+            else if (batch->fold_policy == FOLD_MASK) {
+                utc = MASKED_TIMESTAMP;
+            }
+            else {
+                unsigned char fold = batch->fold_policy == FOLD_GIVEN
+                                         ? batch->folds[i] != 0
+                                         : batch->fold_policy != FOLD_EARLIEST;
+                utc = ts - offset[fold];
+            }
+        }
+        else {
+            utc = ts - offset[0];
         }
-    }
 
-    if (self->_ttinfos != NULL) {
-        for (size_t i = 0; i < ttinfos_allocated; ++i) {
-            xdecref_ttinfo(&(self->_ttinfos[i]));
+        batch->utc[i] = utc;
+        if (batch->in_gap != NULL) {
+            batch->in_gap[i] = in_gap;
+        }
+        if (batch->in_fold != NULL) {
+            batch->in_fold[i] = in_fold;
         }
-        PyMem_Free(self->_ttinfos);
-        self->_ttinfos = NULL;
     }
 
-    if (self->trans_ttinfos != NULL) {
-        PyMem_Free(self->trans_ttinfos);
-        self->trans_ttinfos = NULL;
+    return -1;
+}
+
+static PyObject *
+zoneinfo_toutc_timestamps(PyObject *obj_self, PyObject *args,
+                          PyObject *kwargs)
+{
+    static char *kwlist[] = {"local",     "utc",    "nonexistent",
+                             "ambiguous", "in_gap", "in_fold",
+                             NULL};
+    PyObject *local_obj;
+    PyObject *utc_obj;
+    PyObject *nonexistent_obj = NULL;
+    PyObject *ambiguous_obj = NULL;
+    PyObject *in_gap_obj = Py_None;
+    PyObject *in_fold_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(
+            args, kwargs, "OO|$OOOO:toutc_timestamps", kwlist, &local_obj,
+            &utc_obj, &nonexistent_obj, &ambiguous_obj, &in_gap_obj,
+            &in_fold_obj)) {
+        return NULL;
     }
 
-    rv = -1;
-cleanup:
-    Py_XDECREF(data_tuple);
+    Py_buffer local = {NULL};
+    Py_buffer utc = {NULL};
+    Py_buffer folds = {NULL};
+    Py_buffer in_gap = {NULL};
+    Py_buffer in_fold = {NULL};
+    PyObject *rv = NULL;
 
-    if (utcoff != NULL) {
-        PyMem_Free(utcoff);
+    _local_batch batch = {NULL, NULL, NULL, GAP_RAISE, FOLD_RAISE, NULL};
+    if (nonexistent_obj != NULL) {
+        int policy =
+            parse_batch_policy(nonexistent_obj, "nonexistent", GAP_POLICIES);
+        if (policy < 0) {
+            goto cleanup;
+        }
+        batch.gap_policy = (unsigned char)policy;
+    }
+    if (ambiguous_obj != NULL && PyUnicode_Check(ambiguous_obj)) {
+        int policy =
+            parse_batch_policy(ambiguous_obj, "ambiguous", FOLD_POLICIES);
+        if (policy < 0) {
+            goto cleanup;
+        }
+        batch.fold_policy = (unsigned char)policy;
+    }
+
+    if (get_batch_buffer(local_obj, "local", 8, "lqn", 0, &local) ||
+        get_batch_buffer(utc_obj, "utc", 8, "lqn", PyBUF_WRITABLE, &utc) ||
+        (ambiguous_obj != NULL && !PyUnicode_Check(ambiguous_obj) &&
+         get_batch_buffer(ambiguous_obj, "ambiguous", 1, "?bB", 0, &folds)) ||
+        (in_gap_obj != Py_None &&
+         get_batch_buffer(in_gap_obj, "in_gap", 1, "?bB", PyBUF_WRITABLE,
+                          &in_gap)) ||
+        (in_fold_obj != Py_None &&
+         get_batch_buffer(in_fold_obj, "in_fold", 1, "?bB", PyBUF_WRITABLE,
+                          &in_fold))) {
+        goto cleanup;
+    }
+
+    Py_ssize_t n = local.len / 8;
+    if (check_batch_length(&utc, "utc", "local", n) ||
+        (folds.obj != NULL &&
+         check_batch_length(&folds, "ambiguous", "local", n)) ||
+        (in_gap.obj != NULL &&
+         check_batch_length(&in_gap, "in_gap", "local", n)) ||
+        (in_fold.obj != NULL &&
+         check_batch_length(&in_fold, "in_fold", "local", n))) {
+        goto cleanup;
+    }
+
+    batch.utc = utc.buf;
+    batch.in_gap = in_gap.buf;
+    batch.in_fold = in_fold.buf;
+    if (folds.obj != NULL) {
+        batch.fold_policy = FOLD_GIVEN;
+        batch.folds = folds.buf;
+    }
+
+    _zone_block *zone = ((PyZoneInfo_ZoneInfo *)obj_self)->zone;
+    if (ensure_lookup_tables(zone)) {
+        goto cleanup;
+    }
+
+    Py_ssize_t error_idx;
+    unsigned char error = BATCH_OUT_OF_RANGE;
+    zone->batch_lookups++;
+    if (n >= BATCH_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS;
+        error_idx = batch_local_to_utc(zone, local.buf, n, &batch, &error);
+        Py_END_ALLOW_THREADS;
+    }
+    else {
+        error_idx = batch_local_to_utc(zone, local.buf, n, &batch, &error);
     }
+    zone->batch_lookups--;
 
-    if (dstoff != NULL) {
-        PyMem_Free(dstoff);
+    if (error_idx >= 0) {
+        if (error == BATCH_IN_GAP) {
+            PyErr_Format(PyExc_ValueError,
+                         "local[%zd] does not exist (it is in a gap)",
+                         error_idx);
+        }
+        else if (error == BATCH_IN_FOLD) {
+            PyErr_Format(PyExc_ValueError,
+                         "local[%zd] is ambiguous (it is in a fold)",
+                         error_idx);
+        }
+        else {
+            PyErr_Format(PyExc_OverflowError,
+                         "local[%zd] is out of the range of datetime",
+                         error_idx);
+        }
+        goto cleanup;
     }
 
-    if (isdst != NULL) {
-        PyMem_Free(isdst);
+    rv = Py_None;
+    Py_INCREF(rv);
+cleanup:
+    if (local.obj != NULL) {
+        PyBuffer_Release(&local);
+    }
+    if (utc.obj != NULL) {
+        PyBuffer_Release(&utc);
+    }
+    if (folds.obj != NULL) {
+        PyBuffer_Release(&folds);
+    }
+    if (in_gap.obj != NULL) {
+        PyBuffer_Release(&in_gap);
     }
+    if (in_fold.obj != NULL) {
+        PyBuffer_Release(&in_fold);
+    }
+    return rv;
+}
 
-    if (trans_idx != NULL) {
-        PyMem_Free(trans_idx);
+static PyObject *
+zoneinfo_repr(PyZoneInfo_ZoneInfo *self)
+{
+    PyObject *rv = NULL;
+    const char *type_name = Py_TYPE((PyObject *)self)->tp_name;
+    if (!(self->key == Py_None)) {
+        rv = PyUnicode_FromFormat("%s(key=%R)", type_name, self->key);
+    }
+    else {
+        assert(PyUnicode_Check(self->file_repr));
+        rv = PyUnicode_FromFormat("%s.from_file(%U)", type_name,
+                                  self->file_repr);
     }
 
     return rv;
 }
 
-/* Function to calculate the local timestamp of a transition from the year. */
-int64_t
-calendarrule_year_to_timestamp(TransitionRuleType *base_self, int year)
+static PyObject *
+zoneinfo_str(PyZoneInfo_ZoneInfo *self)
 {
-    CalendarRule *self = (CalendarRule *)base_self;
+    if (!(self->key == Py_None)) {
+        Py_INCREF(self->key);
+        return self->key;
+    }
+    else {
+        return zoneinfo_repr(self);
+    }
+}
 
-    // We want (year, month, day of month); we have year and month, but we
-    // need to turn (week, day-of-week) into day-of-month
-    //
-    // Week 1 is the first week in which day `day` (where 0 = Sunday) appears.
-    // Week 5 represents the last occurrence of day `day`, so we need to know
-    // the first weekday of the month and the number of days in the month.
-    int8_t first_day = (ymd_to_ord(year, self->month, 1) + 6) % 7;
-    uint8_t days_in_month = DAYS_IN_MONTH[self->month];
-    if (self->month == 2 && is_leap_year(year)) {
-        days_in_month += 1;
+/* Pickles the ZoneInfo object by key and source.
+ *
+ * ZoneInfo objects are pickled by reference to the TZif file that they came
+ * from, which means that the exact transitions may be different or the file
+ * may not un-pickle if the data has changed on disk in the interim.
+ *
+ * It is necessary to include a bit indicating whether or not the object
+ * was constructed from the cache, because from-cache objects will hit the
+ * unpickling process's cache, whereas no-cache objects will bypass it.
+ *
+ * Objects constructed from ZoneInfo.from_file cannot be pickled.
+ */
+static PyObject *
+zoneinfo_reduce(PyObject *obj_self, PyObject *unused)
+{
+    PyZoneInfo_ZoneInfo *self = (PyZoneInfo_ZoneInfo *)obj_self;
+    if (self->source == SOURCE_FILE) {
+        // Objects constructed from files cannot be pickled.
+        PyObject *pickle = PyImport_ImportModule("pickle");
+        if (pickle == NULL) {
+            return NULL;
+        }
+
+        PyObject *pickle_error =
+            PyObject_GetAttrString(pickle, "PicklingError");
+        Py_DECREF(pickle);
+        if (pickle_error == NULL) {
+            return NULL;
+        }
+
+        PyErr_Format(pickle_error,
+                     "Cannot pickle a ZoneInfo file from a file stream.");
+        Py_DECREF(pickle_error);
+        return NULL;
     }
 
-    // This equation seems magical, so I'll break it down:
-    // 1. calendar says 0 = Monday, POSIX says 0 = Sunday so we need first_day
-    //    + 1 to get 1 = Monday -> 7 = Sunday, which is still equivalent
-    //    because this math is mod 7
-    // 2. Get first day - desired day mod 7 (adjusting by 7 for negative
-    //    numbers so that -1 % 7 = 6).
-    // 3. Add 1 because month days are a 1-based index.
-    int8_t month_day = ((int8_t)(self->day) - (first_day + 1)) % 7;
-    if (month_day < 0) {
-        month_day += 7;
+    unsigned char from_cache = self->source == SOURCE_CACHE ? 1 : 0;
+    PyObject *constructor = PyObject_GetAttrString(obj_self, "_unpickle");
+
+    if (constructor == NULL) {
+        return NULL;
     }
-    month_day += 1;
 
-    // Now use a 0-based index version of `week` to calculate the w-th
-    // occurrence of `day`
-    month_day += ((int8_t)(self->week) - 1) * 7;
+    PyObject *rv = Py_BuildValue("O(OB)", constructor, self->key, from_cache);
+    Py_DECREF(constructor);
+    return rv;
+}
 
-    // month_day will only be > days_in_month if w was 5, and `w` means "last
-    // occurrence of `d`", so now we just check if we over-shot the end of the
-    // month and if so knock off 1 week.
-    if (month_day > days_in_month) {
-        month_day -= 7;
+static PyObject *
+zoneinfo__unpickle(PyTypeObject *cls, PyObject *args)
+{
+    PyObject *key;
+    unsigned char from_cache;
+    if (!PyArg_ParseTuple(args, "OB", &key, &from_cache)) {
+        return NULL;
     }
 
-    int64_t ordinal = ymd_to_ord(year, self->month, month_day) - EPOCHORDINAL;
-    return ((ordinal * 86400) + (int64_t)(self->hour * 3600) +
-            (int64_t)(self->minute * 60) + (int64_t)(self->second));
+    if (from_cache) {
+        PyObject *val_args = Py_BuildValue("(O)", key);
+        if (val_args == NULL) {
+            return NULL;
+        }
+
+        PyObject *rv = zoneinfo_new(cls, val_args, NULL);
+
+        Py_DECREF(val_args);
+        return rv;
+    }
+    else {
+        return zoneinfo_new_instance(cls, key);
+    }
 }
 
-/* Constructor for CalendarRule. */
-int
-calendarrule_new(uint8_t month, uint8_t week, uint8_t day, int8_t hour,
-                 int8_t minute, int8_t second, CalendarRule *out)
+/* It is relatively expensive to construct new timedelta objects, and in most
+ * cases we're looking at a relatively small number of timedeltas, such as
+ * integer number of hours, etc. We will keep a cache so that we construct
+ * a minimal number of these.
+ *
+ * The common offsets are found by indexing an array, and the rest in a
+ * bounded hash table (see QUARTER_HOUR_TIMEDELTAS), so a crafted time zone
+ * file with many distinct offsets cannot make the cache grow without limit:
+ * it holds at most 2 * MAX_QUARTER_HOURS + 1 timedeltas in the array and
+ * ODD_OFFSET_SLOTS in the hash table. An odd offset that collides with
+ * ODD_OFFSET_PROBES others replaces the entry in its first slot, so a
+ * timedelta that was cached is not guaranteed to be found again, and two
+ * equal offsets may be represented by different objects.
+ *
+ * This returns a new reference to the timedelta.
+ */
+static PyObject *
+load_timedelta(long seconds)
 {
-    // These bounds come from the POSIX standard, which describes an Mm.n.d
-    // rule as:
-    //
-    //   The d'th day (0 <= d <= 6) of week n of month m of the year (1 <= n <=
-    //   5, 1 <= m <= 12, where week 5 means "the last d day in month m" which
-    //   may occur in either the fourth or the fifth week). Week 1 is the first
-    //   week in which the d'th day occurs. Day zero is Sunday.
-    if (month <= 0 || month > 12) {
-        PyErr_Format(PyExc_ValueError, "Month must be in (0, 12]");
-        return -1;
+    PyObject **slot = NULL;
+    if (seconds % 900 == 0 && seconds >= -900L * MAX_QUARTER_HOURS &&
+        seconds <= 900L * MAX_QUARTER_HOURS) {
+        slot = &QUARTER_HOUR_TIMEDELTAS[seconds / 900 + MAX_QUARTER_HOURS];
     }
+    else {
+        // Fibonacci hashing, which spreads out nearby offsets
+        uint32_t hash = (uint32_t)seconds * UINT32_C(2654435769);
+        size_t idx = hash >> (32 - ODD_OFFSET_BITS);
+        for (size_t i = 0; i < ODD_OFFSET_PROBES; ++i) {
+            _odd_offset *entry =
+                &ODD_OFFSET_TIMEDELTAS[(idx + i) % ODD_OFFSET_SLOTS];
+            if (entry->timedelta == NULL) {
+                entry->seconds = seconds;
+            }
 
-    if (week <= 0 || week > 5) {
-        PyErr_Format(PyExc_ValueError, "Week must be in (0, 5]");
-        return -1;
+            if (entry->seconds == seconds) {
+                slot = &(entry->timedelta);
+                break;
+            }
+        }
+
+        if (slot == NULL) {
+            // Slots are never emptied once they are used, so replacing an
+            // entry does not cut short the probes for any other offset. The
+            // _ttinfos that use the old timedelta keep their references.
+            _odd_offset *entry = &ODD_OFFSET_TIMEDELTAS[idx];
+            Py_CLEAR(entry->timedelta);
+            TIMEDELTA_CACHE_SIZE--;
+            entry->seconds = seconds;
+            slot = &(entry->timedelta);
+        }
     }
 
-    // The actual bounds of day are (day >= 0 && day <= 6), but since day is an
-    // unsigned variable, day >= 0 is always true. To ensure that a bug is not
-    // introduced in the event that someone changes day to a signed type, we
-    // will assert that it is an unsigned type.
-    Py_ASSERT_VAR_UNSIGNED(day);
-    if (day > 6) {
-        PyErr_Format(PyExc_ValueError, "Day must be in [0, 6]");
-        return -1;
+    if (*slot != NULL) {
+        TIMEDELTA_CACHE_HITS++;
+        Py_INCREF(*slot);
+        return *slot;
     }
 
-    TransitionRuleType base = {&calendarrule_year_to_timestamp};
+    TIMEDELTA_CACHE_MISSES++;
+    PyObject *rv = PyDateTimeAPI->Delta_FromDelta(0, seconds, 0, 1,
+                                                  PyDateTimeAPI->DeltaType);
+    if (rv != NULL) {
+        Py_INCREF(rv);
+        *slot = rv;
+        TIMEDELTA_CACHE_SIZE++;
+    }
 
-    CalendarRule new_offset = {
-        .base = base,
-        .month = month,
-        .week = week,
-        .day = day,
-        .hour = hour,
-        .minute = minute,
-        .second = second,
-    };
-
-    *out = new_offset;
-    return 0;
+    return rv;
 }
 
-/* Function to calculate the local timestamp of a transition from the year.
+/* Returns a new reference to the tzname for an abbreviation of `len` bytes,
+ * which need not be NUL-terminated.
  *
- * This translates the day of the year into a local timestamp — either a
- * 1-based Julian day, not including leap days, or the 0-based year-day,
- * including leap days.
- * */
-int64_t
-dayrule_year_to_timestamp(TransitionRuleType *base_self, int year)
+ * Most abbreviations are used by many zones, so the strings are shared
+ * between all of them (and interned, to share them with the rest of the
+ * program too). This only saves memory: abbreviations longer than
+ * MAX_CACHED_TZNAME bytes are never shared, and an entry that is replaced
+ * leaves the _ttinfos built before with a different object than those built
+ * after, so equal _ttinfos do not necessarily have the same members.
+ */
+static PyObject *
+load_tzname(const char *abbr, size_t len)
 {
-    // The function signature requires a TransitionRuleType pointer, but this
-    // function is only applicable to DayRule* objects.
-    DayRule *self = (DayRule *)base_self;
+    if (len > MAX_CACHED_TZNAME) {
+        return PyUnicode_DecodeUTF8(abbr, len, NULL);
+    }
 
-    // ymd_to_ord calculates the number of days since 0001-01-01, but we want
-    // to know the number of days since 1970-01-01, so we must subtract off
-    // the equivalent of ymd_to_ord(1970, 1, 1).
-    //
-    // We subtract off an additional 1 day to account for January 1st (we want
-    // the number of full days *before* the date of the transition - partial
-    // days are accounted for in the hour, minute and second portions.
-    int64_t days_before_year = ymd_to_ord(year, 1, 1) - EPOCHORDINAL - 1;
+    // FNV-1a
+    uint32_t hash = UINT32_C(2166136261);
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ (unsigned char)abbr[i]) * UINT32_C(16777619);
+    }
 
-    // The Julian day specification skips over February 29th in leap years,
-    // from the POSIX standard:
-    //
-    //   Leap days shall not be counted. That is, in all years-including leap
-    //   years-February 28 is day 59 and March 1 is day 60. It is impossible to
-    //   refer explicitly to the occasional February 29.
-    //
-    // This is actually more useful than you'd think — if you want a rule that
-    // always transitions on a given calendar day (other than February 29th),
-    // you would use a Julian day, e.g. J91 always refers to April 1st and J365
-    // always refers to December 31st.
-    unsigned int day = self->day;
-    if (self->julian && day >= 59 && is_leap_year(year)) {
-        day += 1;
+    size_t idx = hash >> (32 - TZNAME_BITS);
+    _tzname_entry *slot = NULL;
+    for (size_t i = 0; i < TZNAME_PROBES; ++i) {
+        _tzname_entry *entry = &TZNAME_TABLE[(idx + i) % TZNAME_SLOTS];
+        if (entry->tzname == NULL) {
+            slot = entry;
+            break;
+        }
+
+        if (memcmp(entry->abbr, abbr, len) == 0 && entry->abbr[len] == '\0') {
+            Py_INCREF(entry->tzname);
+            return entry->tzname;
+        }
     }
 
-    return ((days_before_year + day) * 86400) + (self->hour * 3600) +
-           (self->minute * 60) + self->second;
+    PyObject *tzname = PyUnicode_DecodeUTF8(abbr, len, NULL);
+    if (tzname == NULL) {
+        return NULL;
+    }
+    PyUnicode_InternInPlace(&tzname);
+
+    // As in load_timedelta, replacing an entry cannot hide any other
+    if (slot == NULL) {
+        slot = &TZNAME_TABLE[idx];
+        Py_CLEAR(slot->tzname);
+    }
+    memcpy(slot->abbr, abbr, len);
+    slot->abbr[len] = '\0';
+    Py_INCREF(tzname);
+    slot->tzname = tzname;
+
+    return tzname;
 }
 
-/* Constructor for DayRule. */
+static void
+clear_shared_tables(void)
+{
+    for (size_t i = 0; i < 2 * MAX_QUARTER_HOURS + 1; ++i) {
+        Py_CLEAR(QUARTER_HOUR_TIMEDELTAS[i]);
+    }
+
+    for (size_t i = 0; i < ODD_OFFSET_SLOTS; ++i) {
+        Py_CLEAR(ODD_OFFSET_TIMEDELTAS[i].timedelta);
+    }
+
+    for (size_t i = 0; i < TZNAME_SLOTS; ++i) {
+        Py_CLEAR(TZNAME_TABLE[i].tzname);
+    }
+
+    TIMEDELTA_CACHE_HITS = 0;
+    TIMEDELTA_CACHE_MISSES = 0;
+    TIMEDELTA_CACHE_SIZE = 0;
+}
+
+static PyObject *
+zoneinfo_timedelta_cache_info(PyObject *module, PyObject *unused)
+{
+    return Py_BuildValue("{s:n,s:n,s:n,s:n}", "hits", TIMEDELTA_CACHE_HITS,
+                         "misses", TIMEDELTA_CACHE_MISSES, "currsize",
+                         TIMEDELTA_CACHE_SIZE, "maxsize",
+                         (Py_ssize_t)(2 * MAX_QUARTER_HOURS + 1 +
+                                      ODD_OFFSET_SLOTS));
+}
+
+/* Constructor for _ttinfo object - this starts by initializing the _ttinfo
+ * to { NULL, NULL, NULL }, so that Py_XDECREF will work on partially
+ * initialized _ttinfo objects.
+ */
 static int
-dayrule_new(uint8_t julian, unsigned int day, int8_t hour, int8_t minute,
-            int8_t second, DayRule *out)
+build_ttinfo(long utcoffset, long dstoffset, PyObject *tzname, _ttinfo *out)
 {
-    // The POSIX standard specifies that Julian days must be in the range (1 <=
-    // n <= 365) and that non-Julian (they call it "0-based Julian") days must
-    // be in the range (0 <= n <= 365).
-    if (day < julian || day > 365) {
-        PyErr_Format(PyExc_ValueError, "day must be in [%u, 365], not: %u",
-                     julian, day);
+    out->utcoff = NULL;
+    out->dstoff = NULL;
+    out->tzname = NULL;
+
+    out->utcoff_seconds = utcoffset;
+    out->in_dst = dstoffset != 0;
+    out->utcoff = load_timedelta(utcoffset);
+    if (out->utcoff == NULL) {
         return -1;
     }
 
-    TransitionRuleType base = {
-        &dayrule_year_to_timestamp,
-    };
-
-    DayRule tmp = {
-        .base = base,
-        .julian = julian,
-        .day = day,
-        .hour = hour,
-        .minute = minute,
-        .second = second,
-    };
+    out->dstoff = load_timedelta(dstoffset);
+    if (out->dstoff == NULL) {
+        return -1;
+    }
 
-    *out = tmp;
+    out->tzname = tzname;
+    Py_INCREF(tzname);
 
     return 0;
 }
 
-/* Calculate the start and end rules for a _tzrule in the given year. */
+/* Decrease reference count on any non-NULL members of a _ttinfo  */
 static void
-tzrule_transitions(_tzrule *rule, int year, int64_t *start, int64_t *end)
+xdecref_ttinfo(_ttinfo *ttinfo)
 {
-    assert(rule->start != NULL);
-    assert(rule->end != NULL);
-    *start = rule->start->year_to_timestamp(rule->start, year);
-    *end = rule->end->year_to_timestamp(rule->end, year);
+    if (ttinfo != NULL) {
+        Py_XDECREF(ttinfo->utcoff);
+        Py_XDECREF(ttinfo->dstoff);
+        Py_XDECREF(ttinfo->tzname);
+    }
 }
 
-/* Calculate the _ttinfo that applies at a given local time from a _tzrule.
+/* Given a file-like object, this populates a ZoneInfo object
  *
- * This takes a local timestamp and fold for disambiguation purposes; the year
- * could technically be calculated from the timestamp, but given that the
- * callers of this function already have the year information accessible from
- * the datetime struct, it is taken as an additional parameter to reduce
- * unncessary calculation.
- * */
-static _ttinfo *
-find_tzrule_ttinfo(_tzrule *rule, int64_t ts, unsigned char fold, int year)
+ * The entire contents of the file are read with a single call to `read()`,
+ * and the resulting bytes are decoded directly into C values by parse_tzif;
+ * see load_tzif_data for how those values are used to populate `self`.
+ *
+ * This returns 0 on success and -1 on failure.
+ *
+ * The function will never return while `self` is partially initialized —
+ * the object only needs to be freed / deallocated if this succeeds.
+ */
+static int
+load_data(PyZoneInfo_ZoneInfo *self, PyObject *file_obj)
 {
-    if (rule->std_only) {
-        return &(rule->std);
+    PyObject *contents = PyObject_CallMethod(file_obj, "read", NULL);
+    if (contents == NULL) {
+        return -1;
     }
 
-    int64_t start, end;
-    uint8_t isdst;
+    int rv = load_data_from_buffer(self, contents);
+    Py_DECREF(contents);
+    return rv;
+}
 
-    tzrule_transitions(rule, year, &start, &end);
+/* Given the contents of a TZif file as a bytes-like object, this populates a
+ * ZoneInfo object (see load_data).
+ */
+static int
+load_data_from_buffer(PyZoneInfo_ZoneInfo *self, PyObject *contents)
+{
+    _tzif_data data = {0};
+    Py_buffer view;
+    int rv = -1;
 
-    // With fold = 0, the period (denominated in local time) with the smaller
-    // offset starts at the end of the gap and ends at the end of the fold;
-    // with fold = 1, it runs from the start of the gap to the beginning of the
-    // fold.
-    //
-    // So in order to determine the DST boundaries we need to know both the
-    // fold and whether DST is positive or negative (rare), and it turns out
-    // that this boils down to fold XOR is_positive.
-    if (fold == (rule->dst_diff >= 0)) {
-        end -= rule->dst_diff;
-    }
-    else {
-        start += rule->dst_diff;
+    if (PyObject_GetBuffer(contents, &view, PyBUF_SIMPLE)) {
+        return -1;
     }
 
-    if (start < end) {
-        isdst = (ts >= start) && (ts < end);
+    if (parse_tzif(view.buf, (size_t)view.len, &data)) {
+        raise_tzif_error(&data);
     }
     else {
-        isdst = (ts < end) || (ts >= start);
+        rv = load_tzif_data(self, &data, NULL);
     }
 
-    if (isdst) {
-        return &(rule->dst);
-    }
-    else {
-        return &(rule->std);
+    free_tzif_data(&data);
+    PyBuffer_Release(&view);
+    return rv;
+}
+
+#ifdef HAVE_MMAP
+// TZif files at least this large are mapped into memory rather than read.
+#define MMAP_THRESHOLD ((size_t)64 * 1024)
+
+// A memory-mapped file that is kept alive by ZoneInfo objects borrowing from
+// it; it is wrapped in a capsule that unmaps the file when destroyed.
+typedef struct {
+    void *addr;
+    size_t len;
+} _mapped_file;
+
+static const char MAPPED_FILE_CAPSULE_NAME[] =
+    "backports.zoneinfo._czoneinfo._mapped_file";
+
+static void
+mapped_file_capsule_destructor(PyObject *capsule)
+{
+    _mapped_file *mapping =
+        PyCapsule_GetPointer(capsule, MAPPED_FILE_CAPSULE_NAME);
+    if (mapping != NULL) {
+        munmap(mapping->addr, mapping->len);
+        PyMem_Free(mapping);
     }
 }
 
-/* Calculate the ttinfo and fold that applies for a _tzrule at an epoch time.
- *
- * This function can determine the _ttinfo that applies at a given epoch time,
- * (analogous to trans_list_utc), and whether or not the datetime is in a fold.
- * This is to be used in the .fromutc() function.
+/* Wraps a mapping in a _mapped_file capsule, which takes ownership of it.
  *
- * The year is technically a redundant parameter, because it can be calculated
- * from the timestamp, but all callers of this function should have the year
- * in the datetime struct anyway, so taking it as a parameter saves unnecessary
- * calculation.
- **/
-static _ttinfo *
-find_tzrule_ttinfo_fromutc(_tzrule *rule, int64_t ts, int year,
-                           unsigned char *fold)
+ * On failure, the mapping is released and NULL is returned.
+ */
+static PyObject *
+new_mapped_file(void *addr, size_t len)
 {
-    if (rule->std_only) {
-        *fold = 0;
-        return &(rule->std);
+    _mapped_file *mapping = PyMem_Malloc(sizeof(_mapped_file));
+    if (mapping == NULL) {
+        munmap(addr, len);
+        PyErr_NoMemory();
+        return NULL;
     }
+    mapping->addr = addr;
+    mapping->len = len;
 
-    int64_t start, end;
-    uint8_t isdst;
-    tzrule_transitions(rule, year, &start, &end);
-    start -= rule->std.utcoff_seconds;
-    end -= rule->dst.utcoff_seconds;
+    PyObject *capsule = PyCapsule_New(mapping, MAPPED_FILE_CAPSULE_NAME,
+                                      mapped_file_capsule_destructor);
+    if (capsule == NULL) {
+        munmap(addr, len);
+        PyMem_Free(mapping);
+    }
+    return capsule;
+}
 
-    if (start < end) {
-        isdst = (ts >= start) && (ts < end);
+/* Reads the TZif file at `path` into `out`.
+ *
+ * Large files are mapped into memory rather than read. Typical TZif files are
+ * only a few kilobytes, and for those a single read() into a temporary buffer
+ * is considerably cheaper than setting up and tearing down a mapping.
+ *
+ * This does not use the Python API, so it may be called without holding the
+ * GIL. It returns 0 on success and an errno value on failure, in which case
+ * `out` does not need to be released.
+ */
+static int
+read_tzif_file(const char *path, _file_contents *out)
+{
+    int fd;
+    int saved_errno = 0;
+    struct stat st;
+
+    out->buf = NULL;
+    out->len = 0;
+    out->mapped = 0;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st)) {
+        saved_errno = errno;
+    }
+    else if ((size_t)st.st_size >= MMAP_THRESHOLD) {
+        void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                          fd, 0);
+        if (addr == MAP_FAILED) {
+            saved_errno = errno;
+        }
+        else {
+            out->buf = addr;
+            out->len = (size_t)st.st_size;
+            out->mapped = 1;
+        }
+    }
+    else if ((out->buf = PyMem_RawMalloc((size_t)st.st_size)) == NULL) {
+        saved_errno = ENOMEM;
     }
     else {
-        isdst = (ts < end) || (ts >= start);
+        // If the file shrinks between the fstat and read calls, this stops at
+        // EOF and the parser will reject the truncated contents.
+        size_t size = (size_t)st.st_size;
+        ssize_t n;
+        while (out->len < size &&
+               (n = read(fd, out->buf + out->len, size - out->len)) != 0) {
+            if (n > 0) {
+                out->len += (size_t)n;
+            }
+            else if (errno != EINTR) {
+                saved_errno = errno;
+                break;
+            }
+        }
     }
 
-    // For positive DST, the ambiguous period is one dst_diff after the end of
-    // DST; for negative DST, the ambiguous period is one dst_diff before the
-    // start of DST.
-    int64_t ambig_start, ambig_end;
-    if (rule->dst_diff > 0) {
-        ambig_start = end;
-        ambig_end = end + rule->dst_diff;
-    }
-    else {
-        ambig_start = start;
-        ambig_end = start - rule->dst_diff;
+    if (fd >= 0) {
+        close(fd);
     }
 
-    *fold = (ts >= ambig_start) && (ts < ambig_end);
+    if (saved_errno) {
+        release_file_contents(out);
+    }
+    return saved_errno;
+}
 
-    if (isdst) {
-        return &(rule->dst);
+/* Unmaps or frees the contents of a file read by read_tzif_file. */
+static void
+release_file_contents(_file_contents *contents)
+{
+    if (contents->mapped) {
+        munmap(contents->buf, contents->len);
     }
     else {
-        return &(rule->std);
+        PyMem_RawFree(contents->buf);
     }
+
+    contents->buf = NULL;
+    contents->len = 0;
+    contents->mapped = 0;
 }
 
-/* Parse a TZ string in the format specified by the POSIX standard:
- *
- *  std offset[dst[offset],start[/time],end[/time]]
- *
- *  std and dst must be 3 or more characters long and must not contain a
- *  leading colon, embedded digits, commas, nor a plus or minus signs; The
- *  spaces between "std" and "offset" are only for display and are not actually
- *  present in the string.
- *
- *  The format of the offset is ``[+|-]hh[:mm[:ss]]``
+/* Populates a ZoneInfo object from the contents of a TZif file, which have
+ * already been parsed into `data`.
  *
- * See the POSIX.1 spec: IEE Std 1003.1-2018 §8.3:
+ * This takes ownership of `contents`: unless the transition list is borrowed
+ * from a mapped file (see load_tzif_data), they are released before this
+ * returns. TZif files are updated by replacing them rather than by modifying
+ * them in place, so a mapping is not expected to change while it is in use.
  *
- * https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/V1_chap08.html
+ * This returns 0 on success and -1 on failure.
  */
 static int
-parse_tz_str(PyObject *tz_str_obj, _tzrule *out)
+load_file_contents(PyZoneInfo_ZoneInfo *self, _file_contents *contents,
+                   const _tzif_data *data)
 {
-    PyObject *std_abbr = NULL;
-    PyObject *dst_abbr = NULL;
-    TransitionRuleType *start = NULL;
-    TransitionRuleType *end = NULL;
-    // Initialize offsets to invalid value (> 24 hours)
-    long std_offset = 1 << 20;
-    long dst_offset = 1 << 20;
-
-    char *tz_str = PyBytes_AsString(tz_str_obj);
-    if (tz_str == NULL) {
-        return -1;
-    }
-    char *p = tz_str;
-
-    // Read the `std` abbreviation, which must be at least 3 characters long.
-    Py_ssize_t num_chars = parse_abbr(p, &std_abbr);
-    if (num_chars < 1) {
-        PyErr_Format(PyExc_ValueError, "Invalid STD format in %R", tz_str_obj);
-        goto error;
+    PyObject *data_owner = NULL;
+#ifdef BORROW_MAPPED_TRANSITIONS
+    if (contents->mapped) {
+        // The capsule takes ownership of the mapping, even on failure
+        data_owner = new_mapped_file(contents->buf, contents->len);
+        contents->buf = NULL;
+        contents->mapped = 0;
+        if (data_owner == NULL) {
+            return -1;
+        }
     }
+#endif
 
-    p += num_chars;
+    int rv = load_tzif_data(self, data, data_owner);
 
-    // Now read the STD offset, which is required
-    num_chars = parse_tz_delta(p, &std_offset);
-    if (num_chars < 0) {
-        PyErr_Format(PyExc_ValueError, "Invalid STD offset in %R", tz_str_obj);
-        goto error;
+    Py_XDECREF(data_owner);
+    release_file_contents(contents);
+    return rv;
+}
+
+/* Given a path to a TZif file, this populates a ZoneInfo object
+ *
+ * This bypasses the Python file object protocol entirely: the file is read
+ * (see read_tzif_file) and parsed without holding the GIL.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+load_data_from_path(PyZoneInfo_ZoneInfo *self, PyObject *file_path)
+{
+    PyObject *path_bytes = NULL;
+    if (!PyUnicode_FSConverter(file_path, &path_bytes)) {
+        return -1;
     }
-    p += num_chars;
 
-    // If the string ends here, there is no DST, otherwise we must parse the
-    // DST abbreviation and start and end dates and times.
-    if (*p == '\0') {
-        goto complete;
+    _file_contents contents;
+    _tzif_data data = {0};
+    int saved_errno;
+    int parse_failed = 0;
+
+    Py_BEGIN_ALLOW_THREADS;
+    saved_errno = read_tzif_file(PyBytes_AS_STRING(path_bytes), &contents);
+    if (!saved_errno) {
+        parse_failed = parse_tzif(contents.buf, contents.len, &data);
     }
+    Py_END_ALLOW_THREADS;
 
-    num_chars = parse_abbr(p, &dst_abbr);
-    if (num_chars < 1) {
-        PyErr_Format(PyExc_ValueError, "Invalid DST format in %R", tz_str_obj);
-        goto error;
+    Py_DECREF(path_bytes);
+    if (saved_errno) {
+        errno = saved_errno;
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, file_path);
+        return -1;
     }
-    p += num_chars;
 
-    if (*p == ',') {
-        // From the POSIX standard:
-        //
-        // If no offset follows dst, the alternative time is assumed to be one
-        // hour ahead of standard time.
-        dst_offset = std_offset + 3600;
+    int rv = -1;
+    if (parse_failed) {
+        raise_tzif_error(&data);
+        release_file_contents(&contents);
     }
     else {
-        num_chars = parse_tz_delta(p, &dst_offset);
-        if (num_chars < 0) {
-            PyErr_Format(PyExc_ValueError, "Invalid DST offset in %R",
-                         tz_str_obj);
-            goto error;
-        }
+        rv = load_file_contents(self, &contents, &data);
+    }
 
-        p += num_chars;
+    free_tzif_data(&data);
+    return rv;
+}
+#endif
+
+/* Populates a ZoneInfo object from decoded TZif data.
+ *
+ * This copies the transition list and the ttinfo data into a zone block and
+ * infers the DST offsets; everything else is derived on first use (see
+ * init_zone_data). `data` is not modified and remains owned by the caller.
+ *
+ * If `data_owner` is not NULL, it is an object that keeps the buffer `data`
+ * was parsed from alive, and where the platform allows it, the transition
+ * list will be borrowed from that buffer (holding a reference to
+ * `data_owner`) rather than copied.
+ *
+ * This returns 0 on success and -1 on failure.
+ *
+ * The function will never return while `self` is partially initialized —
+ * the object only needs to be freed / deallocated if this succeeds.
+ */
+static int
+load_tzif_data(PyZoneInfo_ZoneInfo *self, const _tzif_data *data,
+               PyObject *data_owner)
+{
+    size_t num_transitions = data->num_transitions;
+    size_t num_ttinfos = data->num_ttinfos;
+
+    self->file_repr = NULL;
+
+    _zone_block *zone = new_zone_block(num_transitions, num_ttinfos);
+    if (zone == NULL) {
+        return -1;
     }
 
-    TransitionRuleType **transitions[2] = {&start, &end};
-    for (size_t i = 0; i < 2; ++i) {
-        if (*p != ',') {
-            PyErr_Format(PyExc_ValueError,
-                         "Missing transition rules in TZ string: %R",
-                         tz_str_obj);
-            goto error;
-        }
-        p++;
+#ifdef BORROW_MAPPED_TRANSITIONS
+    if (data_owner != NULL && data->trans_list_utc_be != NULL &&
+        ((uintptr_t)data->trans_list_utc_be % sizeof(int64_t)) == 0) {
+        zone->trans_list_utc = (int64_t *)data->trans_list_utc_be;
+        zone->data_owner = data_owner;
+        zone->borrowed = BORROWED_TRANS_UTC;
+        Py_INCREF(data_owner);
+    }
+#endif
 
-        num_chars = parse_transition_rule(p, transitions[i]);
-        if (num_chars < 0) {
-            PyErr_Format(PyExc_ValueError,
-                         "Malformed transition rule in TZ string: %R",
-                         tz_str_obj);
+    // Copy the transition list if it could not be borrowed
+    if (num_transitions && zone->trans_list_utc == NULL) {
+        zone->trans_list_utc = PyMem_Malloc(num_transitions * sizeof(int64_t));
+        if (zone->trans_list_utc == NULL) {
+            PyErr_NoMemory();
             goto error;
         }
-        p += num_chars;
+        memcpy(zone->trans_list_utc, data->trans_list_utc,
+               num_transitions * sizeof(int64_t));
     }
 
-    if (*p != '\0') {
-        PyErr_Format(PyExc_ValueError,
-                     "Extraneous characters at end of TZ string: %R",
-                     tz_str_obj);
+    size_t tz_str_len = data->tz_str == NULL ? 0 : strlen(data->tz_str);
+    if (alloc_zone_data(zone, data->num_abbr_chars + 1, tz_str_len)) {
         goto error;
     }
 
-complete:
-    build_tzrule(std_abbr, dst_abbr, std_offset, dst_offset, start, end, out);
-    Py_DECREF(std_abbr);
-    Py_XDECREF(dst_abbr);
+    _zone_data *zone_data = &(zone->zone_data);
+    memcpy(zone_data->utcoff, data->utcoff, num_ttinfos * sizeof(long));
+    memcpy(zone_data->trans_idx, data->trans_idx, num_transitions);
+    memcpy(zone_data->isdst, data->isdst, num_ttinfos);
+    memcpy(zone_data->abbr_idx, data->abbr_idx, num_ttinfos);
+    memcpy(zone_data->abbr_chars, data->abbr_chars,
+           data->num_abbr_chars + 1);
+    memcpy(zone_data->tz_str, data->tz_str, tz_str_len);
 
-    return 0;
+    // Derive dstoff from the information we've loaded
+    memset(zone_data->dstoff, 0, num_ttinfos * sizeof(long));
+    utcoff_to_dstoff(zone_data->trans_idx, zone_data->utcoff,
+                     zone_data->dstoff, zone_data->isdst, num_transitions,
+                     num_ttinfos);
+
+    return publish_zone_block(self, zone);
 error:
-    Py_XDECREF(std_abbr);
-    if (dst_abbr != NULL && dst_abbr != Py_None) {
-        Py_DECREF(dst_abbr);
-    }
+    release_zone_block(zone);
+    return -1;
+}
 
-    if (start != NULL) {
-        PyMem_Free(start);
+/* Allocates an empty zone block, holding a single reference to it.
+ *
+ * The caller populates the transition lists and the zone data (see
+ * alloc_zone_data) and then passes the block to publish_zone_block, or
+ * releases it on failure. This returns NULL on failure.
+ */
+static _zone_block *
+new_zone_block(size_t num_transitions, size_t num_ttinfos)
+{
+    _zone_block *zone = PyMem_Calloc(1, sizeof(_zone_block));
+    if (zone == NULL) {
+        PyErr_NoMemory();
+        return NULL;
     }
 
-    if (end != NULL) {
-        PyMem_Free(end);
+    zone->refcnt = 1;
+    zone->num_transitions = num_transitions;
+    zone->num_ttinfos = num_ttinfos;
+    return zone;
+}
+
+/* Hashes the data a zone block was loaded from.
+ *
+ * This covers the UTC transition list and the zone data, which are laid out
+ * the same way whether the zone came from a TZif file or a bundle, using
+ * 64-bit FNV-1a. Blocks with equal hashes are compared in full before they
+ * are shared (see zone_blocks_equal), so collisions are harmless.
+ */
+static Py_hash_t
+hash_zone_block(const _zone_block *zone)
+{
+    const unsigned char *chunks[2] = {
+        (const unsigned char *)zone->trans_list_utc,
+        (const unsigned char *)zone->zone_data.utcoff,
+    };
+    size_t sizes[2] = {zone->num_transitions * sizeof(int64_t),
+                       zone->zone_data.size};
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < sizes[i]; ++j) {
+            hash ^= chunks[i][j];
+            hash *= 1099511628211ULL;
+        }
     }
 
-    return -1;
+    return (Py_hash_t)hash;
 }
 
 static int
-parse_uint(const char *const p, uint8_t *value)
+zone_blocks_equal(const _zone_block *a, const _zone_block *b)
 {
-    if (!isdigit(*p)) {
-        return -1;
-    }
-
-    *value = (*p) - '0';
-    return 0;
+    return a->num_transitions == b->num_transitions &&
+           a->num_ttinfos == b->num_ttinfos &&
+           a->zone_data.size == b->zone_data.size &&
+           (!a->num_transitions ||
+            memcmp(a->trans_list_utc, b->trans_list_utc,
+                   a->num_transitions * sizeof(int64_t)) == 0) &&
+           memcmp(a->zone_data.utcoff, b->zone_data.utcoff,
+                  a->zone_data.size) == 0;
 }
 
-/* Parse the STD and DST abbreviations from a TZ string. */
-static Py_ssize_t
-parse_abbr(const char *const p, PyObject **abbr)
+/* Finishes loading a populated zone block and makes it self->zone.
+ *
+ * If a block with identical data is already in use, `self` shares that block
+ * and `zone` is released; otherwise `zone` is initialized (see
+ * init_zone_data) and added to ZONE_BLOCK_CACHE so that later zones can
+ * share it. Either way, this consumes the caller's reference to `zone`.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+publish_zone_block(PyZoneInfo_ZoneInfo *self, _zone_block *zone)
 {
-    const char *ptr = p;
-    char buff = *ptr;
-    const char *str_start;
-    const char *str_end;
+    zone->hash = hash_zone_block(zone);
 
-    if (*ptr == '<') {
-        ptr++;
-        str_start = ptr;
-        while ((buff = *ptr) != '>') {
-            // From the POSIX standard:
-            //
-            //   In the quoted form, the first character shall be the less-than
-            //   ( '<' ) character and the last character shall be the
-            //   greater-than ( '>' ) character. All characters between these
-            //   quoting characters shall be alphanumeric characters from the
-            //   portable character set in the current locale, the plus-sign (
-            //   '+' ) character, or the minus-sign ( '-' ) character. The std
-            //   and dst fields in this case shall not include the quoting
-            //   characters.
-            if (!isalpha(buff) && !isdigit(buff) && buff != '+' &&
-                buff != '-') {
-                return -1;
-            }
-            ptr++;
-        }
-        str_end = ptr;
-        ptr++;
+    PyObject *hash = PyLong_FromSsize_t(zone->hash);
+    if (hash == NULL) {
+        goto error;
     }
-    else {
-        str_start = p;
-        // From the POSIX standard:
-        //
-        //   In the unquoted form, all characters in these fields shall be
-        //   alphabetic characters from the portable character set in the
-        //   current locale.
-        while (isalpha(*ptr)) {
-            ptr++;
+
+    PyObject *entry = PyDict_GetItemWithError(ZONE_BLOCK_CACHE, hash);
+    if (entry != NULL) {
+        _zone_block *shared = PyLong_AsVoidPtr(entry);
+        if (zone_blocks_equal(zone, shared)) {
+            Py_DECREF(hash);
+            release_zone_block(zone);
+            shared->refcnt++;
+            self->zone = shared;
+            return 0;
         }
-        str_end = ptr;
+    }
+    else if (PyErr_Occurred()) {
+        goto error;
     }
 
-    *abbr = PyUnicode_FromStringAndSize(str_start, str_end - str_start);
-    if (abbr == NULL) {
-        return -1;
+    if (init_zone_data(zone)) {
+        goto error;
     }
 
-    return ptr - p;
+    // In the unlikely event of a hash collision, the new block isn't shared
+    if (entry == NULL) {
+        PyObject *ptr = PyLong_FromVoidPtr(zone);
+        if (ptr == NULL) {
+            goto error;
+        }
+
+        int rv = PyDict_SetItem(ZONE_BLOCK_CACHE, hash, ptr);
+        Py_DECREF(ptr);
+        if (rv) {
+            goto error;
+        }
+        zone->shared = 1;
+    }
+
+    Py_DECREF(hash);
+    self->zone = zone;
+    return 0;
+error:
+    Py_XDECREF(hash);
+    release_zone_block(zone);
+    return -1;
 }
 
-/* Parse a UTC offset from a TZ str. */
-static Py_ssize_t
-parse_tz_delta(const char *const p, long *total_seconds)
+/* Releases a reference to a zone block.
+ *
+ * When the last reference is released, the block is removed from
+ * ZONE_BLOCK_CACHE and freed. This does not raise exceptions and leaves any
+ * exception that is already set in place.
+ */
+static void
+release_zone_block(_zone_block *zone)
 {
-    // From the POSIX spec:
-    //
-    //   Indicates the value added to the local time to arrive at Coordinated
-    //   Universal Time. The offset has the form:
-    //
-    //   hh[:mm[:ss]]
-    //
-    //   One or more digits may be used; the value is always interpreted as a
-    //   decimal number.
-    //
-    // The POSIX spec says that the values for `hour` must be between 0 and 24
-    // hours, but RFC 8536 §3.3.1 specifies that the hours part of the
-    // transition times may be signed and range from -167 to 167.
-    long sign = -1;
-    long hours = 0;
-    long minutes = 0;
-    long seconds = 0;
+    assert(zone->refcnt > 0);
+    if (--zone->refcnt) {
+        return;
+    }
 
-    const char *ptr = p;
-    char buff = *ptr;
-    if (buff == '-' || buff == '+') {
-        // Negative numbers correspond to *positive* offsets, from the spec:
-        //
-        //   If preceded by a '-', the timezone shall be east of the Prime
-        //   Meridian; otherwise, it shall be west (which may be indicated by
-        //   an optional preceding '+' ).
-        if (buff == '-') {
-            sign = 1;
+    // The cache may have been freed and recreated (along with the module)
+    // since the block was added, so this only removes an entry that still
+    // refers to this block
+    if (zone->shared && ZONE_BLOCK_CACHE != NULL) {
+        PyObject *exc, *val, *tb;
+        PyErr_Fetch(&exc, &val, &tb);
+
+        PyObject *hash = PyLong_FromSsize_t(zone->hash);
+        if (hash != NULL) {
+            PyObject *entry = PyDict_GetItemWithError(ZONE_BLOCK_CACHE, hash);
+            if (entry != NULL && PyLong_AsVoidPtr(entry) == zone) {
+                PyDict_DelItem(ZONE_BLOCK_CACHE, hash);
+            }
+            Py_DECREF(hash);
         }
 
-        ptr++;
+        PyErr_Restore(exc, val, tb);
     }
 
-    // The hour can be 1 or 2 numeric characters
-    for (size_t i = 0; i < 2; ++i) {
-        buff = *ptr;
-        if (!isdigit(buff)) {
-            if (i == 0) {
-                return -1;
-            }
-            else {
-                break;
-            }
+    // This must come before free_trans_lists, which resets zone->borrowed
+    if (zone->_ttinfos != NULL) {
+        for (size_t i = 0; i < zone->num_ttinfos; ++i) {
+            xdecref_ttinfo(&(zone->_ttinfos[i]));
         }
 
-        hours *= 10;
-        hours += buff - '0';
-        ptr++;
+        if (!(zone->borrowed & BORROWED_TTINFOS)) {
+            PyMem_Free(zone->_ttinfos);
+            if (zone->trans_ttinfos != NULL) {
+                PyMem_Free(zone->trans_ttinfos);
+            }
+        }
     }
 
-    if (hours > 24 || hours < 0) {
-        return -1;
+    free_trans_lists(zone);
+    Py_XDECREF(zone->frozen);
+
+    free_tzrule(&(zone->tzrule_after));
+    free_zone_data(zone);
+    PyMem_Free(zone);
+}
+
+/* Frees (or releases, if they are borrowed) the transition lists. */
+static void
+free_trans_lists(_zone_block *zone)
+{
+    if (zone->trans_list_utc != NULL &&
+        !(zone->borrowed & BORROWED_TRANS_UTC)) {
+        PyMem_Free(zone->trans_list_utc);
     }
+    zone->trans_list_utc = NULL;
 
-    // Minutes and seconds always of the format ":dd"
-    long *outputs[2] = {&minutes, &seconds};
     for (size_t i = 0; i < 2; ++i) {
-        if (*ptr != ':') {
-            goto complete;
-        }
-        ptr++;
-
-        for (size_t j = 0; j < 2; ++j) {
-            buff = *ptr;
-            if (!isdigit(buff)) {
-                return -1;
-            }
-            *(outputs[i]) *= 10;
-            *(outputs[i]) += buff - '0';
-            ptr++;
+        if (zone->trans_list_wall[i] != NULL &&
+            !(zone->borrowed & BORROWED_TRANS_WALL)) {
+            PyMem_Free(zone->trans_list_wall[i]);
         }
+        zone->trans_list_wall[i] = NULL;
     }
 
-complete:
-    *total_seconds = sign * ((hours * 3600) + (minutes * 60) + seconds);
+    if (zone->trans_search.utc != NULL &&
+        !(zone->borrowed & BORROWED_TRANS_SEARCH)) {
+        PyMem_Free(zone->trans_search.utc);
+    }
+    memset(&(zone->trans_search), 0, sizeof(_trans_search));
 
-    return ptr - p;
+    Py_CLEAR(zone->data_owner);
+    zone->borrowed = 0;
 }
 
-/* Parse the date portion of a transition rule. */
-static Py_ssize_t
-parse_transition_rule(const char *const p, TransitionRuleType **out)
+/* Allocates the arrays in zone->zone_data.
+ *
+ * The arrays are sized for num_transitions transitions and num_ttinfos
+ * ttinfos (which must already be set), `abbr_len` bytes of abbreviations and
+ * a TZ string of `tz_str_len` characters, which is NUL-terminated here. The
+ * caller is responsible for populating them and then calling init_zone_data.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+alloc_zone_data(_zone_block *zone, size_t abbr_len, size_t tz_str_len)
 {
-    // The full transition rule indicates when to change back and forth between
-    // STD and DST, and has the form:
-    //
-    //   date[/time],date[/time]
-    //
-    // This function parses an individual date[/time] section, and returns
-    // the number of characters that contributed to the transition rule. This
-    // does not include the ',' at the end of the first rule.
-    //
-    // The POSIX spec states that if *time* is not given, the default is 02:00.
-    const char *ptr = p;
-    int8_t hour = 2;
-    int8_t minute = 0;
-    int8_t second = 0;
+    _zone_data *data = &(zone->zone_data);
+    size_t num_transitions = zone->num_transitions;
+    size_t num_ttinfos = zone->num_ttinfos;
+
+    // The longs come first so that they are correctly aligned
+    size_t size = num_ttinfos * (2 * sizeof(long) + 2) + num_transitions +
+                  abbr_len + tz_str_len + 1;
+    char *block = PyMem_Malloc(size);
+    if (block == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
 
-    // Rules come in one of three flavors:
-    //
-    //   1. Jn: Julian day n, with no leap days.
-    //   2. n: Day of year (0-based, with leap days)
-    //   3. Mm.n.d: Specifying by month, week and day-of-week.
+    data->utcoff = (long *)block;
+    data->dstoff = data->utcoff + num_ttinfos;
+    data->trans_idx = (unsigned char *)(data->dstoff + num_ttinfos);
+    data->isdst = data->trans_idx + num_transitions;
+    data->abbr_idx = data->isdst + num_ttinfos;
+    data->abbr_chars = (char *)(data->abbr_idx + num_ttinfos);
+    data->tz_str = data->abbr_chars + abbr_len;
+    data->tz_str[tz_str_len] = '\0';
+    data->size = size;
 
-    if (*ptr == 'M') {
-        uint8_t month, week, day;
-        ptr++;
-        if (parse_uint(ptr, &month)) {
+    return 0;
+}
+
+/* Finishes loading a zone once the arrays in zone->zone_data are populated.
+ *
+ * To keep construction cheap for zones that are rarely queried, this only
+ * does the work that needs no Python objects: the TZ string is parsed (so
+ * that an invalid one is still reported by the constructor), and the values
+ * that every lookup needs are calculated. The wall-time transition lists,
+ * the _ttinfo objects and tzrule_after are built the first time a lookup
+ * needs them, by ensure_trans_list_wall, ensure_ttinfos and
+ * ensure_tzrule_after respectively.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+init_zone_data(_zone_block *zone)
+{
+    _zone_data *data = &(zone->zone_data);
+    size_t num_transitions = zone->num_transitions;
+    size_t num_ttinfos = zone->num_ttinfos;
+
+    if (*(data->tz_str) != '\0') {
+        if (parse_tz_str(data->tz_str, &(data->tzstr))) {
             return -1;
         }
-        ptr++;
-        if (*ptr != '.') {
-            uint8_t tmp;
-            if (parse_uint(ptr, &tmp)) {
-                return -1;
-            }
+    }
+    else if (!num_ttinfos) {
+        PyErr_Format(PyExc_ValueError, "No time zone information found.");
+        return -1;
+    }
 
-            month *= 10;
-            month += tmp;
-            ptr++;
+    // ttinfo_before is the first non-DST ttinfo, or the first ttinfo if
+    // there are only DST ttinfos
+    data->ttinfo_before = 0;
+    for (size_t i = 0; i < num_ttinfos; ++i) {
+        if (!data->isdst[i]) {
+            data->ttinfo_before = i;
+            break;
         }
+    }
 
-        uint8_t *values[2] = {&week, &day};
+    // Lookups after the last transition are resolved by tzrule_after alone,
+    // so the last wall-time transitions are calculated up front (in the same
+    // way as ts_to_local does) rather than building the wall-time lists.
+    if (num_transitions) {
+        size_t last = num_transitions - 1;
+        int64_t offset_before =
+            data->utcoff[last ? data->trans_idx[last - 1] : 0];
+        int64_t offset_after = data->utcoff[data->trans_idx[last]];
+        int64_t trans_utc = zone->trans_list_utc[last];
+
+        if (offset_before > offset_after) {
+            data->last_trans_wall[0] = trans_utc + offset_before;
+            data->last_trans_wall[1] = trans_utc + offset_after;
+        }
+        else {
+            data->last_trans_wall[0] = trans_utc + offset_after;
+            data->last_trans_wall[1] = trans_utc + offset_before;
+        }
+    }
+
+    // Determine if this is a "fixed offset" zone, meaning that the output of
+    // the utcoffset, dst and tzname functions does not depend on the specific
+    // datetime passed.
+    //
+    // We make three simplifying assumptions here:
+    //
+    // 1. If tzrule_after is not std_only, it has transitions that might occur
+    //    (it is possible to construct TZ strings that specify STD and DST but
+    //    no transitions ever occur, such as AAA0BBB,0/0,J365/25).
+    // 2. If the zone contains more than one ttinfo, the ttinfos represent
+    //    different offsets.
+    // 3. The zone contains no unused ttinfos (in which case an otherwise
+    //    fixed-offset zone with extra ttinfos defined may appear to *not* be
+    //    a fixed offset zone).
+    //
+    // Violations to these assumptions would be fairly exotic, and exotic
+    // zones should almost certainly not be used with datetime.time (the
+    // only thing that would be affected by this).
+    const _tzstr *tzstr = &(data->tzstr);
+    if (num_ttinfos > 1 || tzstr->dst_abbr != NULL) {
+        zone->fixed_offset = 0;
+    }
+    else if (num_ttinfos == 0 || tzstr->std_abbr == NULL) {
+        // Without a TZ string, tzrule_after is built from the only ttinfo
+        zone->fixed_offset = 1;
+    }
+    else {
+        const char *abbr = data->abbr_chars + data->abbr_idx[0];
+        zone->fixed_offset =
+            data->utcoff[0] == tzstr->std_offset && data->dstoff[0] == 0 &&
+            strlen(abbr) == (size_t)tzstr->std_abbr_len &&
+            memcmp(abbr, tzstr->std_abbr, tzstr->std_abbr_len) == 0;
+    }
+
+    // Fixed-offset zones need no lookup at all, and zones without any
+    // transitions only need tzrule_after.
+    if (zone->fixed_offset) {
+        zone->lookup = &FIXED_OFFSET_LOOKUP;
+    }
+    else if (!num_transitions) {
+        zone->lookup = &RULE_ONLY_LOOKUP;
+    }
+    else {
+        zone->lookup = &TRANSITIONS_LOOKUP;
+    }
+
+    return 0;
+}
+
+/* Destructor for the zone data. */
+static void
+free_zone_data(_zone_block *zone)
+{
+    if (zone->zone_data.utcoff != NULL) {
+        PyMem_Free(zone->zone_data.utcoff);
+    }
+
+    free_tzstr(&(zone->zone_data.tzstr));
+    memset(&(zone->zone_data), 0, sizeof(_zone_data));
+}
+
+/* Builds the wall-time transition lists on first use.
+ *
+ * This and the other ensure_* functions are safe to call repeatedly and from
+ * any thread holding the GIL; the results are only published once they are
+ * complete. They return 0 on success and -1 on failure.
+ */
+static int
+ensure_trans_list_wall(_zone_block *zone)
+{
+    if (zone->trans_list_wall[0] != NULL || !zone->num_transitions) {
+        return 0;
+    }
+
+    int64_t *trans_list_wall[2] = {NULL, NULL};
+    if (ts_to_local(zone->zone_data.trans_idx, zone->trans_list_utc,
+                    zone->zone_data.utcoff, trans_list_wall,
+                    zone->num_ttinfos, zone->num_transitions)) {
         for (size_t i = 0; i < 2; ++i) {
-            if (*ptr != '.') {
-                return -1;
+            if (trans_list_wall[i] != NULL) {
+                PyMem_Free(trans_list_wall[i]);
             }
-            ptr++;
+        }
+        PyErr_NoMemory();
+        return -1;
+    }
 
-            if (parse_uint(ptr, values[i])) {
-                return -1;
-            }
-            ptr++;
+    zone->trans_list_wall[0] = trans_list_wall[0];
+    zone->trans_list_wall[1] = trans_list_wall[1];
+    return 0;
+}
+
+/* Returns the size of the allocation holding a zone's _trans_search. */
+static size_t
+trans_search_size(size_t num_transitions)
+{
+    return (num_transitions + 1) * (3 * sizeof(int64_t) + sizeof(uint32_t));
+}
+
+/* Fills in the indexes in the sorted lists of the elements of the subtree
+ * rooted at `k` of an Eytzinger tree of `size` elements, the first of which
+ * is at index `i`. Returns the index of the element after the subtree.
+ */
+static size_t
+fill_eytzinger_rank(uint32_t *rank, size_t size, size_t i, size_t k)
+{
+    if (k <= size) {
+        i = fill_eytzinger_rank(rank, size, i, 2 * k);
+        rank[k] = (uint32_t)i++;
+        i = fill_eytzinger_rank(rank, size, i, 2 * k + 1);
+    }
+
+    return i;
+}
+
+/* Builds the Eytzinger-ordered transition lists on first use.
+ *
+ * Nothing is built for zones with fewer than TRANS_SEARCH_MIN_TRANSITIONS
+ * transitions, whose lists are searched in place. Since the tree has the
+ * same shape for every list of a zone, the ranks are shared by all three.
+ */
+static int
+ensure_trans_search(_zone_block *zone)
+{
+    size_t num_transitions = zone->num_transitions;
+    if (zone->trans_search.utc != NULL ||
+        num_transitions < TRANS_SEARCH_MIN_TRANSITIONS ||
+        num_transitions >= UINT32_MAX) {
+        return 0;
+    }
+
+    if (ensure_trans_list_wall(zone)) {
+        return -1;
+    }
+
+    int64_t *buf = PyMem_Malloc(trans_search_size(num_transitions));
+    if (buf == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    // The element at index 0 of each list is unused
+    _trans_search search;
+    search.utc = buf;
+    search.wall[0] = buf + (num_transitions + 1);
+    search.wall[1] = buf + 2 * (num_transitions + 1);
+    search.rank = (uint32_t *)(buf + 3 * (num_transitions + 1));
+
+    search.rank[0] = 0;
+    fill_eytzinger_rank(search.rank, num_transitions, 0, 1);
+
+    const int64_t *sorted[3] = {zone->trans_list_utc,
+                                zone->trans_list_wall[0],
+                                zone->trans_list_wall[1]};
+    int64_t *trees[3] = {search.utc, search.wall[0], search.wall[1]};
+    for (size_t i = 0; i < 3; ++i) {
+        trees[i][0] = 0;
+        for (size_t k = 1; k <= num_transitions; ++k) {
+            trees[i][k] = sorted[i][search.rank[k]];
         }
+    }
 
-        if (*ptr == '/') {
-            ptr++;
-            Py_ssize_t num_chars =
-                parse_transition_time(ptr, &hour, &minute, &second);
-            if (num_chars < 0) {
-                return -1;
-            }
-            ptr += num_chars;
+    zone->trans_search = search;
+    return 0;
+}
+
+/* Builds the _ttinfo objects, trans_ttinfos and ttinfo_before on first use.
+ */
+static int
+ensure_ttinfos(_zone_block *zone)
+{
+    if (zone->_ttinfos != NULL) {
+        return 0;
+    }
+
+    const _zone_data *data = &(zone->zone_data);
+    _ttinfo **trans_ttinfos = NULL;
+    size_t ttinfos_allocated = 0;
+    int rv = -1;
+
+    // Build _ttinfo objects from utcoff, dstoff and abbr
+    _ttinfo *ttinfos = PyMem_Malloc(zone->num_ttinfos * sizeof(_ttinfo));
+    if (ttinfos == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (size_t i = 0; i < zone->num_ttinfos; ++i) {
+        const char *abbr = data->abbr_chars + data->abbr_idx[i];
+        PyObject *tzname = load_tzname(abbr, strlen(abbr));
+        if (tzname == NULL) {
+            goto cleanup;
         }
 
-        CalendarRule *rv = PyMem_Calloc(1, sizeof(CalendarRule));
-        if (rv == NULL) {
+        ttinfos_allocated++;
+        int build_failed = build_ttinfo(data->utcoff[i], data->dstoff[i],
+                                        tzname, &(ttinfos[i]));
+        Py_DECREF(tzname);
+        if (build_failed) {
+            goto cleanup;
+        }
+    }
+
+    // Build our mapping from transition to the ttinfo that applies
+    trans_ttinfos = PyMem_Calloc(zone->num_transitions, sizeof(_ttinfo *));
+    if (trans_ttinfos == NULL && zone->num_transitions) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (size_t i = 0; i < zone->num_transitions; ++i) {
+        size_t ttinfo_idx = data->trans_idx[i];
+        assert(ttinfo_idx < zone->num_ttinfos);
+        trans_ttinfos[i] = &(ttinfos[ttinfo_idx]);
+    }
+
+    // Creating the objects may have run arbitrary code (e.g. through the
+    // garbage collector) that needed the ttinfos and built them first
+    rv = 0;
+    if (zone->_ttinfos != NULL) {
+        goto cleanup;
+    }
+
+    zone->trans_ttinfos = trans_ttinfos;
+    zone->ttinfo_before =
+        zone->num_ttinfos ? &(ttinfos[data->ttinfo_before]) : NULL;
+    zone->_ttinfos = ttinfos;
+    return 0;
+cleanup:
+    for (size_t i = 0; i < ttinfos_allocated; ++i) {
+        xdecref_ttinfo(&(ttinfos[i]));
+    }
+    PyMem_Free(ttinfos);
+
+    if (trans_ttinfos != NULL) {
+        PyMem_Free(trans_ttinfos);
+    }
+
+    return rv;
+}
+
+/* Builds the rule that applies after the last transition on first use. */
+static int
+ensure_tzrule_after(_zone_block *zone)
+{
+    if (zone->tzrule_after.std.utcoff != NULL) {
+        return 0;
+    }
+
+    _zone_data *data = &(zone->zone_data);
+    _tzrule rule = {{0}};
+
+    if (data->tzstr.std_abbr != NULL) {
+        if (tzstr_to_tzrule(&(data->tzstr), &rule)) {
             return -1;
         }
+    }
+    else {
+        // Without a TZ string, the zone keeps the last ttinfo it used (or
+        // its last ttinfo, if there are no transitions) forever, which we
+        // represent as an STD-only rule mimicking that ttinfo. The ttinfo may
+        // be a DST one, so its dstoff is kept as well.
+        size_t idx;
+        if (!zone->num_transitions) {
+            idx = zone->num_ttinfos - 1;
+        }
+        else {
+            idx = data->trans_idx[zone->num_transitions - 1];
+        }
 
-        if (calendarrule_new(month, week, day, hour, minute, second, rv)) {
-            PyMem_Free(rv);
+        const char *abbr = data->abbr_chars + data->abbr_idx[idx];
+        PyObject *tzname = load_tzname(abbr, strlen(abbr));
+        if (tzname == NULL) {
             return -1;
         }
 
-        *out = (TransitionRuleType *)rv;
+        rule.std_only = 1;
+        int build_failed = build_ttinfo(data->utcoff[idx], data->dstoff[idx],
+                                        tzname, &(rule.std));
+        Py_DECREF(tzname);
+        if (build_failed) {
+            return -1;
+        }
     }
-    else {
-        uint8_t julian = 0;
-        unsigned int day = 0;
-        if (*ptr == 'J') {
-            julian = 1;
-            ptr++;
+
+    // As in ensure_ttinfos, someone else may have published the rule first;
+    // the transition rules themselves are shared with data->tzstr, so only
+    // our _ttinfo objects need to be released in that case.
+    if (zone->tzrule_after.std.utcoff != NULL) {
+        xdecref_ttinfo(&(rule.std));
+        if (!rule.std_only) {
+            xdecref_ttinfo(&(rule.dst));
         }
+        return 0;
+    }
 
-        for (size_t i = 0; i < 3; ++i) {
-            if (!isdigit(*ptr)) {
-                if (i == 0) {
-                    return -1;
-                }
-                break;
-            }
-            day *= 10;
-            day += (*ptr) - '0';
-            ptr++;
+    // tzrule_after now owns the transition rules
+    zone->tzrule_after = rule;
+    data->tzstr.start = NULL;
+    data->tzstr.end = NULL;
+    return 0;
+}
+
+/* Builds every table that find_utc_ttinfo and find_local_ttinfo may read. */
+static int
+ensure_lookup_tables(_zone_block *zone)
+{
+    if (zone->num_transitions &&
+        (ensure_trans_list_wall(zone) || ensure_trans_search(zone) ||
+         ensure_ttinfos(zone))) {
+        return -1;
+    }
+
+    return ensure_tzrule_after(zone);
+}
+
+/* Returns the space freeze_zone_block needs for a zone's tables. */
+static size_t
+frozen_zone_size(const _zone_block *zone)
+{
+    size_t size = zone->num_ttinfos * sizeof(_ttinfo) +
+                  zone->num_transitions * sizeof(_ttinfo *);
+    if (!(zone->borrowed & BORROWED_TRANS_UTC)) {
+        size += zone->num_transitions * sizeof(int64_t);
+    }
+    if (!(zone->borrowed & BORROWED_TRANS_WALL)) {
+        size += 2 * zone->num_transitions * sizeof(int64_t);
+    }
+    if (zone->trans_search.utc != NULL &&
+        !(zone->borrowed & BORROWED_TRANS_SEARCH)) {
+        size += trans_search_size(zone->num_transitions);
+    }
+
+    return (size + 7) & ~(size_t)7;
+}
+
+/* Moves the tables of a zone to `buf`, which is owned by `arena`.
+ *
+ * The transition lists (unless they are already borrowed from a mapped file
+ * or bundle), the _ttinfo structs and trans_ttinfos are copied and then
+ * borrowed from `buf`, which must have room for frozen_zone_size(zone)
+ * bytes. All of the tables must already have been built. The _ttinfo structs
+ * keep their references, which are released with the zone as before.
+ */
+static void
+freeze_zone_block(_zone_block *zone, char *buf, PyObject *arena)
+{
+    size_t num_transitions = zone->num_transitions;
+    size_t num_ttinfos = zone->num_ttinfos;
+
+    // The 64-bit lists come first so that everything is correctly aligned
+    if (!(zone->borrowed & BORROWED_TRANS_UTC)) {
+        int64_t *trans_list_utc = (int64_t *)buf;
+        if (num_transitions) {
+            memcpy(trans_list_utc, zone->trans_list_utc,
+                   num_transitions * sizeof(int64_t));
+            PyMem_Free(zone->trans_list_utc);
+            zone->trans_list_utc = trans_list_utc;
         }
+        buf += num_transitions * sizeof(int64_t);
+        zone->borrowed |= BORROWED_TRANS_UTC;
+    }
 
-        if (*ptr == '/') {
-            ptr++;
-            Py_ssize_t num_chars =
-                parse_transition_time(ptr, &hour, &minute, &second);
-            if (num_chars < 0) {
-                return -1;
-            }
-            ptr += num_chars;
+    if (!(zone->borrowed & BORROWED_TRANS_WALL)) {
+        for (size_t i = 0; i < 2 && num_transitions; ++i) {
+            int64_t *trans_list_wall = (int64_t *)buf + i * num_transitions;
+            memcpy(trans_list_wall, zone->trans_list_wall[i],
+                   num_transitions * sizeof(int64_t));
+            PyMem_Free(zone->trans_list_wall[i]);
+            zone->trans_list_wall[i] = trans_list_wall;
         }
+        buf += 2 * num_transitions * sizeof(int64_t);
+        zone->borrowed |= BORROWED_TRANS_WALL;
+    }
 
-        DayRule *rv = PyMem_Calloc(1, sizeof(DayRule));
-        if (rv == NULL) {
-            return -1;
+    if (zone->trans_search.utc != NULL &&
+        !(zone->borrowed & BORROWED_TRANS_SEARCH)) {
+        // The pointers keep their offsets from the start of the allocation
+        _trans_search *search = &(zone->trans_search);
+        int64_t *base = search->utc;
+        int64_t *moved = (int64_t *)buf;
+        memcpy(moved, base, trans_search_size(num_transitions));
+
+        search->utc = moved;
+        search->wall[0] = moved + (search->wall[0] - base);
+        search->wall[1] = moved + (search->wall[1] - base);
+        search->rank = (uint32_t *)(moved + ((int64_t *)search->rank - base));
+        PyMem_Free(base);
+
+        buf += trans_search_size(num_transitions);
+        zone->borrowed |= BORROWED_TRANS_SEARCH;
+    }
+
+    _ttinfo *ttinfos = (_ttinfo *)buf;
+    _ttinfo **trans_ttinfos = (_ttinfo **)(ttinfos + num_ttinfos);
+    memcpy(ttinfos, zone->_ttinfos, num_ttinfos * sizeof(_ttinfo));
+    for (size_t i = 0; i < num_transitions; ++i) {
+        trans_ttinfos[i] = ttinfos + (zone->trans_ttinfos[i] - zone->_ttinfos);
+    }
+    if (zone->ttinfo_before != NULL) {
+        zone->ttinfo_before =
+            ttinfos + (zone->ttinfo_before - zone->_ttinfos);
+    }
+
+    PyMem_Free(zone->_ttinfos);
+    if (zone->trans_ttinfos != NULL) {
+        PyMem_Free(zone->trans_ttinfos);
+    }
+    zone->_ttinfos = ttinfos;
+    zone->trans_ttinfos = trans_ttinfos;
+    zone->borrowed |= BORROWED_TTINFOS;
+
+    zone->frozen = arena;
+    Py_INCREF(arena);
+}
+
+/* Moves the lookup tables of the zones of the ZoneInfo objects in the list
+ * `zones` into a single read-only allocation.
+ *
+ * The tables that are otherwise built on first use are built first, so once
+ * this returns, nothing that is read when looking up an offset in these zones
+ * is written again, and after a fork the pages holding the tables stay shared
+ * with the parent process. Where mmap is available, the tables are mapped
+ * separately from the Python heap (whose pages are dirtied by reference
+ * count changes and the allocations of any other objects) and then made
+ * read-only. Zones that are already frozen, or whose tables are being read
+ * by a batch lookup without the GIL, are skipped.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+freeze_zones(PyObject *zones)
+{
+    PyObject *seen = NULL;
+    PyObject *arena = NULL;
+    _zone_block **blocks = NULL;
+    size_t num_blocks = 0;
+    size_t size = 0;
+    int rv = -1;
+
+    Py_ssize_t num_zones = PyList_GET_SIZE(zones);
+    blocks = PyMem_Malloc((num_zones + 1) * sizeof(_zone_block *));
+    seen = PySet_New(NULL);
+    if (blocks == NULL || seen == NULL) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    for (Py_ssize_t i = 0; i < num_zones; ++i) {
+        // A subclass's constructor may return anything
+        PyObject *obj = PyList_GET_ITEM(zones, i);
+        if (!PyObject_TypeCheck(obj, &PyZoneInfo_ZoneInfoType)) {
+            continue;
+        }
+
+        _zone_block *zone = ((PyZoneInfo_ZoneInfo *)obj)->zone;
+        if (zone->frozen != NULL || zone->batch_lookups) {
+            continue;
+        }
+
+        PyObject *zone_id = PyLong_FromVoidPtr(zone);
+        if (zone_id == NULL) {
+            goto cleanup;
+        }
+        int contains = PySet_Contains(seen, zone_id);
+        if (contains == 0) {
+            contains = PySet_Add(seen, zone_id);
+        }
+        Py_DECREF(zone_id);
+        if (contains < 0) {
+            goto cleanup;
+        }
+        else if (contains) {
+            continue;
+        }
+
+        if (ensure_trans_list_wall(zone) || ensure_trans_search(zone) ||
+            ensure_ttinfos(zone) || ensure_tzrule_after(zone)) {
+            goto cleanup;
+        }
+
+        blocks[num_blocks++] = zone;
+        size += frozen_zone_size(zone);
+    }
+
+    if (size == 0) {
+        rv = 0;
+        goto cleanup;
+    }
+
+    char *buf;
+#ifdef HAVE_MMAP
+    buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        goto cleanup;
+    }
+    arena = new_mapped_file(buf, size);
+#else
+    // Over-allocated so that the tables can be aligned to 8 bytes
+    arena = PyBytes_FromStringAndSize(NULL, size + 7);
+    if (arena != NULL) {
+        uintptr_t addr = (uintptr_t)PyBytes_AS_STRING(arena);
+        buf = PyBytes_AS_STRING(arena) + ((8 - addr % 8) % 8);
+    }
+#endif
+    if (arena == NULL) {
+        goto cleanup;
+    }
+
+    // Nothing below can fail, so no zone is left partially moved
+    char *p = buf;
+    for (size_t i = 0; i < num_blocks; ++i) {
+        size_t zone_size = frozen_zone_size(blocks[i]);
+        freeze_zone_block(blocks[i], p, arena);
+        p += zone_size;
+    }
+    if (num_blocks) {
+        ++TABLES_GENERATION;
+    }
+
+#ifdef HAVE_MMAP
+    // This only guards against stray writes, so failing is not an error
+    mprotect(buf, size, PROT_READ);
+#endif
+
+    rv = 0;
+cleanup:
+    Py_XDECREF(arena);
+    Py_XDECREF(seen);
+    if (blocks != NULL) {
+        PyMem_Free(blocks);
+    }
+    return rv;
+}
+
+/* Reads big-endian integers from a TZif buffer. */
+static inline uint32_t
+read_be_uint32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline int64_t
+read_be_int64(const unsigned char *p)
+{
+    uint64_t hi = read_be_uint32(p);
+    uint64_t lo = read_be_uint32(p + 4);
+    return (int64_t)((hi << 32) | lo);
+}
+
+/* A TZif header, as specified in RFC 8536 §3.1 */
+typedef struct {
+    int version;
+    uint32_t isutcnt;
+    uint32_t isstdcnt;
+    uint32_t leapcnt;
+    uint32_t timecnt;
+    uint32_t typecnt;
+    uint32_t charcnt;
+} _tzif_header;
+
+static const size_t TZIF_HEADER_SIZE = 44;
+
+/* Parses a TZif header, returning 0 on success and -1 on failure.
+ *
+ * On failure, the error message is written to `error` (see _tzif_data).
+ */
+static int
+parse_tzif_header(const unsigned char *buf, size_t len, _tzif_header *out,
+                  char *error)
+{
+    if (len < TZIF_HEADER_SIZE || memcmp(buf, "TZif", 4) != 0) {
+        PyOS_snprintf(error, TZIF_ERROR_SIZE,
+                      "Invalid TZif file: magic not found");
+        return -1;
+    }
+
+    unsigned char version = buf[4];
+    if (version == '\0') {
+        out->version = 1;
+    }
+    else if (version >= '2' && version <= '9') {
+        out->version = version - '0';
+    }
+    else {
+        PyOS_snprintf(error, TZIF_ERROR_SIZE, "Invalid TZif version: %d",
+                      (int)version);
+        return -1;
+    }
+
+    // The version is followed by 15 unused bytes
+    const unsigned char *p = buf + 20;
+    uint32_t *counts[6] = {&out->isutcnt,  &out->isstdcnt, &out->leapcnt,
+                           &out->timecnt,  &out->typecnt,  &out->charcnt};
+    for (size_t i = 0; i < 6; ++i) {
+        *(counts[i]) = read_be_uint32(p);
+        p += 4;
+    }
+
+    return 0;
+}
+
+/* Calculates the size of the data block following a TZif header. */
+static uint64_t
+tzif_data_block_size(const _tzif_header *header, uint64_t time_size)
+{
+    return (uint64_t)header->timecnt * (time_size + 1) +
+           (uint64_t)header->typecnt * 6 + (uint64_t)header->charcnt +
+           (uint64_t)header->leapcnt * (time_size + 4) +
+           (uint64_t)header->isstdcnt + (uint64_t)header->isutcnt;
+}
+
+/* Parses the contents of a TZif file (versions 1 through 4).
+ *
+ * The file's big-endian data blocks are decoded straight into C arrays. For
+ * Version 2+ files, the Version 1 data block is skipped and the 64-bit data
+ * and the TZ string footer are used instead.
+ *
+ * This does not use the Python API at all (memory is allocated with the raw
+ * allocator), so it may be called without holding the GIL. Instead of
+ * raising an exception, it records the error in `out`, and the caller must
+ * call raise_tzif_error once it holds the GIL.
+ *
+ * This returns 0 on success and -1 on failure. In either case, `out` must be
+ * freed with free_tzif_data.
+ */
+static int
+parse_tzif(const unsigned char *buf, size_t len, _tzif_data *out)
+{
+    _tzif_header header;
+    memset(out, 0, sizeof(_tzif_data));
+
+    if (parse_tzif_header(buf, len, &header, out->error)) {
+        return -1;
+    }
+
+    const unsigned char *p = buf + TZIF_HEADER_SIZE;
+    const unsigned char *end = buf + len;
+    uint64_t time_size = 4;
+
+    if (header.version >= 2) {
+        // Version 2+ also starts with a Version 1 header and data, which we
+        // need to skip now
+        uint64_t skip_bytes = tzif_data_block_size(&header, 4);
+        if (skip_bytes > (uint64_t)(end - p)) {
+            goto truncated;
+        }
+        p += skip_bytes;
+
+        if (parse_tzif_header(p, end - p, &header, out->error)) {
+            return -1;
+        }
+        p += TZIF_HEADER_SIZE;
+        time_size = 8;
+    }
+
+    if (tzif_data_block_size(&header, time_size) > (uint64_t)(end - p)) {
+        goto truncated;
+    }
+
+    size_t timecnt = header.timecnt;
+    size_t typecnt = header.typecnt;
+    size_t charcnt = header.charcnt;
+
+    out->num_transitions = timecnt;
+    out->num_ttinfos = typecnt;
+    out->num_abbr_chars = charcnt;
+
+    // PyMem_RawMalloc(0) returns a unique non-NULL pointer, so empty arrays
+    // do not need special treatment.
+    out->trans_list_utc = PyMem_RawMalloc(timecnt * sizeof(int64_t));
+    out->trans_idx = PyMem_RawMalloc(timecnt);
+    out->utcoff = PyMem_RawMalloc(typecnt * sizeof(long));
+    out->isdst = PyMem_RawMalloc(typecnt * sizeof(unsigned char));
+    out->abbr_idx = PyMem_RawMalloc(typecnt);
+    out->abbr_chars = PyMem_RawMalloc(charcnt + 1);
+    if (out->trans_list_utc == NULL || out->trans_idx == NULL ||
+        out->utcoff == NULL || out->isdst == NULL || out->abbr_idx == NULL ||
+        out->abbr_chars == NULL) {
+        return -1;
+    }
+
+    // The data portion starts with timecnt transitions and indices
+    if (time_size == 8) {
+        out->trans_list_utc_be = p;
+    }
+
+    for (size_t i = 0; i < timecnt; ++i) {
+        if (time_size == 8) {
+            out->trans_list_utc[i] = read_be_int64(p);
+        }
+        else {
+            out->trans_list_utc[i] = (int32_t)read_be_uint32(p);
+        }
+        p += time_size;
+    }
+
+    for (size_t i = 0; i < timecnt; ++i) {
+        out->trans_idx[i] = *(p++);
+        if (out->trans_idx[i] >= typecnt) {
+            PyOS_snprintf(
+                out->error, TZIF_ERROR_SIZE,
+                "Invalid transition index found while reading TZif: %d",
+                (int)out->trans_idx[i]);
+            return -1;
+        }
+    }
+
+    // Read the ttinfo structs, (utoff, isdst, abbrind)
+    for (size_t i = 0; i < typecnt; ++i) {
+        out->utcoff[i] = (int32_t)read_be_uint32(p);
+        out->isdst[i] = p[4] != 0;
+        out->abbr_idx[i] = p[5];
+        p += 6;
+
+        if (out->abbr_idx[i] > charcnt) {
+            PyOS_snprintf(out->error, TZIF_ERROR_SIZE,
+                          "Invalid abbreviation index found while reading "
+                          "TZif: %d",
+                          (int)out->abbr_idx[i]);
+            return -1;
+        }
+    }
+
+    // The abbreviations are NUL-terminated strings indexed by their position
+    // in the unsplit abbreviation string; some zones use subsets of longer
+    // abbreviations (e.g. LMT\x00AHST\x00HDT\x00 also contains "HST"), so
+    // we keep the raw block and terminate it in case the file did not.
+    memcpy(out->abbr_chars, p, charcnt);
+    out->abbr_chars[charcnt] = '\0';
+    p += charcnt;
+
+    // The remainder of the data block consists of leap seconds (currently
+    // unused) and the standard/wall and ut/local indicators, which are
+    // metadata we don't need.
+    p += (size_t)header.leapcnt * (time_size + 4) + header.isstdcnt +
+         header.isutcnt;
+
+    // In Version 2+ files, the data block is followed by the TZ string,
+    // enclosed in newlines.
+    if (header.version >= 2) {
+        if (p >= end || *p != '\n') {
+            PyOS_snprintf(out->error, TZIF_ERROR_SIZE,
+                          "Invalid TZif file: TZ string footer not found");
+            return -1;
+        }
+        p++;
+
+        const unsigned char *tz_str_end = memchr(p, '\n', end - p);
+        if (tz_str_end == NULL) {
+            goto truncated;
+        }
+
+        size_t tz_str_len = tz_str_end - p;
+        out->tz_str = PyMem_RawMalloc(tz_str_len + 1);
+        if (out->tz_str == NULL) {
+            return -1;
+        }
+        memcpy(out->tz_str, p, tz_str_len);
+        out->tz_str[tz_str_len] = '\0';
+    }
+
+    return 0;
+truncated:
+    PyOS_snprintf(out->error, TZIF_ERROR_SIZE,
+                  "Invalid TZif file: unexpected EOF");
+    return -1;
+}
+
+/* Raises the exception for a failed parse_tzif call. */
+static void
+raise_tzif_error(const _tzif_data *data)
+{
+    if (data->error[0] == '\0') {
+        PyErr_NoMemory();
+    }
+    else {
+        PyErr_SetString(PyExc_ValueError, data->error);
+    }
+}
+
+/* Destructor for _tzif_data. */
+static void
+free_tzif_data(_tzif_data *data)
+{
+    void *arrays[] = {data->trans_list_utc, data->trans_idx, data->utcoff,
+                      data->isdst,          data->abbr_idx,  data->abbr_chars,
+                      data->tz_str};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); ++i) {
+        if (arrays[i] != NULL) {
+            PyMem_RawFree(arrays[i]);
+        }
+    }
+
+    memset(data, 0, sizeof(_tzif_data));
+}
+
+/* Reads little-endian integers from a zone bundle. */
+static inline uint32_t
+read_le_uint32(const unsigned char *p)
+{
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[1] << 8) | (uint32_t)p[0];
+}
+
+static inline uint64_t
+read_le_uint64(const unsigned char *p)
+{
+    return ((uint64_t)read_le_uint32(p + 4) << 32) | read_le_uint32(p);
+}
+
+static const char BUNDLE_MAGIC[8] = "TZBUNDLE";
+static const uint32_t BUNDLE_VERSION = 1;
+static const size_t BUNDLE_HEADER_SIZE = 32;
+static const size_t BUNDLE_INDEX_ENTRY_SIZE = 16;
+static const size_t BUNDLE_RECORD_HEADER_SIZE = 16;
+
+static void
+zone_bundle_capsule_destructor(PyObject *capsule)
+{
+    _zone_bundle *bundle =
+        PyCapsule_GetPointer(capsule, ZONE_BUNDLE_CAPSULE_NAME);
+    if (bundle != NULL) {
+        Py_XDECREF(bundle->contents);
+        PyMem_Free(bundle);
+    }
+}
+
+/* Identifies the file at a path, so that a cached bundle can be invalidated
+ * when the file is replaced.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+get_file_id(PyObject *path, PyObject *path_bytes, long long *file_id)
+{
+#ifdef HAVE_MMAP
+    struct stat st;
+    int stat_failed;
+
+    Py_BEGIN_ALLOW_THREADS;
+    stat_failed = stat(PyBytes_AS_STRING(path_bytes), &st);
+    Py_END_ALLOW_THREADS;
+
+    if (stat_failed) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+        return -1;
+    }
+
+    file_id[0] = (long long)st.st_dev;
+    file_id[1] = (long long)st.st_ino;
+    file_id[2] = (long long)st.st_size;
+    file_id[3] = (long long)st.st_mtime;
+    return 0;
+#else
+    static const char *fields[] = {"st_dev", "st_ino", "st_size",
+                                   "st_mtime_ns"};
+    PyObject *os_module = PyImport_ImportModule("os");
+    if (os_module == NULL) {
+        return -1;
+    }
+
+    PyObject *st = PyObject_CallMethod(os_module, "stat", "O", path);
+    Py_DECREF(os_module);
+    if (st == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < 4; ++i) {
+        PyObject *value = PyObject_GetAttrString(st, fields[i]);
+        if (value == NULL) {
+            Py_DECREF(st);
+            return -1;
+        }
+        file_id[i] = PyLong_AsLongLong(value);
+        Py_DECREF(value);
+    }
+    Py_DECREF(st);
+
+    return PyErr_Occurred() ? -1 : 0;
+#endif
+}
+
+/* Reads the contents of a bundle file into memory.
+ *
+ * Where available, the file is mapped (bundles are written to a new file and
+ * renamed into place, never modified in place); otherwise it is read into a
+ * bytes object. The returned object owns the buffer stored in `buf`.
+ */
+static PyObject *
+read_bundle_contents(PyObject *path, PyObject *path_bytes,
+                     const unsigned char **buf, size_t *len)
+{
+#ifdef HAVE_MMAP
+    int fd;
+    int saved_errno = 0;
+    struct stat st;
+    void *addr = MAP_FAILED;
+
+    Py_BEGIN_ALLOW_THREADS;
+    fd = open(PyBytes_AS_STRING(path_bytes), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st)) {
+        saved_errno = errno;
+    }
+    else if (st.st_size > 0) {
+        addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            saved_errno = errno;
+        }
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    Py_END_ALLOW_THREADS;
+
+    if (saved_errno) {
+        errno = saved_errno;
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+        return NULL;
+    }
+
+    if (addr == MAP_FAILED) {
+        // An empty file can't be mapped, but it isn't a valid bundle anyway
+        *buf = (const unsigned char *)"";
+        *len = 0;
+        Py_RETURN_NONE;
+    }
+
+    *buf = addr;
+    *len = (size_t)st.st_size;
+    return new_mapped_file(addr, (size_t)st.st_size);
+#else
+    PyObject *file_obj = PyObject_CallFunction(io_open, "Os", path, "rb");
+    if (file_obj == NULL) {
+        return NULL;
+    }
+
+    PyObject *contents = PyObject_CallMethod(file_obj, "read", NULL);
+    PyObject *rv = PyObject_CallMethod(file_obj, "close", NULL);
+    Py_DECREF(file_obj);
+    if (rv == NULL || contents == NULL || !PyBytes_Check(contents)) {
+        if (contents != NULL && !PyBytes_Check(contents)) {
+            PyErr_SetString(PyExc_TypeError, "Expected bytes from read()");
+        }
+        Py_XDECREF(rv);
+        Py_XDECREF(contents);
+        return NULL;
+    }
+    Py_DECREF(rv);
+
+    *buf = (const unsigned char *)PyBytes_AS_STRING(contents);
+    *len = (size_t)PyBytes_GET_SIZE(contents);
+    return contents;
+#endif
+}
+
+/* Validates the header and index of a bundle held in memory.
+ *
+ * This returns 0 on success and -1 on failure.
+ */
+static int
+parse_bundle_index(_zone_bundle *bundle)
+{
+    const unsigned char *buf = bundle->buf;
+    size_t len = bundle->len;
+
+    if (len < BUNDLE_HEADER_SIZE ||
+        memcmp(buf, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0) {
+        PyErr_SetString(PyExc_ValueError, "Invalid bundle: magic not found");
+        return -1;
+    }
+
+    uint32_t version = read_le_uint32(buf + 8);
+    if (version != BUNDLE_VERSION) {
+        PyErr_Format(PyExc_ValueError, "Unsupported bundle version: %lu",
+                     (unsigned long)version);
+        return -1;
+    }
+
+    uint64_t num_zones = read_le_uint32(buf + 12);
+    uint64_t index_offset = read_le_uint64(buf + 16);
+    if (index_offset > len ||
+        (len - index_offset) / BUNDLE_INDEX_ENTRY_SIZE < num_zones) {
+        goto invalid;
+    }
+
+    bundle->num_zones = (uint32_t)num_zones;
+    bundle->index = buf + index_offset;
+
+    // Check every entry up front, so that lookups need no bounds checks
+    for (size_t i = 0; i < num_zones; ++i) {
+        const unsigned char *entry =
+            bundle->index + i * BUNDLE_INDEX_ENTRY_SIZE;
+        uint64_t zone_offset = read_le_uint64(entry);
+        uint64_t key_offset = read_le_uint32(entry + 8);
+        uint64_t key_len = read_le_uint32(entry + 12);
+
+        if (zone_offset == 0 || zone_offset % sizeof(int64_t) != 0 ||
+            zone_offset > len - BUNDLE_RECORD_HEADER_SIZE ||
+            key_offset + key_len > len) {
+            goto invalid;
+        }
+    }
+
+    return 0;
+invalid:
+    PyErr_SetString(PyExc_ValueError, "Invalid bundle: corrupt index");
+    return -1;
+}
+
+/* Retrieves a bundle from the bundle cache, loading it if necessary.
+ *
+ * The bundle is reloaded if the file at `path` has been replaced since it
+ * was cached. This returns a new reference to the bundle's capsule.
+ */
+static PyObject *
+get_zone_bundle(PyObject *path)
+{
+    PyObject *path_bytes = NULL;
+    PyObject *capsule = NULL;
+    _zone_bundle *bundle = NULL;
+    long long file_id[4];
+
+    if (!PyUnicode_FSConverter(path, &path_bytes)) {
+        return NULL;
+    }
+
+    if (get_file_id(path, path_bytes, file_id)) {
+        goto error;
+    }
+
+    capsule = PyDict_GetItemWithError(ZONE_BUNDLE_CACHE, path_bytes);
+    if (capsule != NULL) {
+        bundle = PyCapsule_GetPointer(capsule, ZONE_BUNDLE_CAPSULE_NAME);
+        if (!memcmp(bundle->file_id, file_id, sizeof(file_id))) {
+            Py_INCREF(capsule);
+            Py_DECREF(path_bytes);
+            return capsule;
+        }
+        capsule = NULL;
+    }
+    else if (PyErr_Occurred()) {
+        goto error;
+    }
+
+    bundle = PyMem_Calloc(1, sizeof(_zone_bundle));
+    if (bundle == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    memcpy(bundle->file_id, file_id, sizeof(file_id));
+
+    capsule = PyCapsule_New(bundle, ZONE_BUNDLE_CAPSULE_NAME,
+                            zone_bundle_capsule_destructor);
+    if (capsule == NULL) {
+        PyMem_Free(bundle);
+        goto error;
+    }
+
+    bundle->contents =
+        read_bundle_contents(path, path_bytes, &bundle->buf, &bundle->len);
+    if (bundle->contents == NULL || parse_bundle_index(bundle)) {
+        goto error;
+    }
+
+    if (PyDict_SetItem(ZONE_BUNDLE_CACHE, path_bytes, capsule)) {
+        goto error;
+    }
+
+    Py_DECREF(path_bytes);
+    return capsule;
+error:
+    Py_XDECREF(capsule);
+    Py_DECREF(path_bytes);
+    return NULL;
+}
+
+/* Retrieves the bundle set as the shared cache with set_shared_cache.
+ *
+ * As with from_bundle, the bundle is reloaded if the file has been replaced
+ * (e.g. rebuilt by another process). This returns a new reference to the
+ * bundle's capsule, or to None if there is no shared cache.
+ */
+static PyObject *
+get_shared_cache(void)
+{
+    PyObject *path = PyObject_GetAttrString(_bundle_mod, "SHARED_CACHE");
+    if (path == NULL || path == Py_None) {
+        return path;
+    }
+
+    PyObject *bundle_obj = get_zone_bundle(path);
+    Py_DECREF(path);
+    return bundle_obj;
+}
+
+/* Creates a ZoneInfo object from the shared cache.
+ *
+ * This returns a new reference to the object, to None if there is no shared
+ * cache or the zone is not in it, or NULL on failure.
+ */
+static PyObject *
+load_shared_zone(PyTypeObject *type, PyObject *key)
+{
+    PyObject *bundle_obj = get_shared_cache();
+    if (bundle_obj == NULL || bundle_obj == Py_None) {
+        return bundle_obj;
+    }
+
+    PyObject *rv = load_shared_bundle_zone(type, bundle_obj, key);
+    Py_DECREF(bundle_obj);
+    return rv;
+}
+
+/* Creates a ZoneInfo object for `key` from the bundle that get_shared_cache
+ * returned.
+ *
+ * This returns a new reference to the object, to None if the zone is not in
+ * the bundle, or NULL on failure.
+ */
+static PyObject *
+load_shared_bundle_zone(PyTypeObject *type, PyObject *bundle_obj,
+                        PyObject *key)
+{
+    Py_ssize_t key_len;
+    const char *key_str = NULL;
+    if (PyUnicode_Check(key)) {
+        key_str = PyUnicode_AsUTF8AndSize(key, &key_len);
+        if (key_str == NULL) {
+            // Keys that can't be encoded are not in any bundle
+            PyErr_Clear();
+        }
+    }
+
+    _zone_bundle *bundle =
+        PyCapsule_GetPointer(bundle_obj, ZONE_BUNDLE_CAPSULE_NAME);
+    uint64_t offset = 0;
+    if (key_str != NULL) {
+        offset = find_bundle_zone(bundle, key_str, (size_t)key_len);
+    }
+
+    if (offset == 0) {
+        Py_RETURN_NONE;
+    }
+
+    PyZoneInfo_ZoneInfo *self =
+        (PyZoneInfo_ZoneInfo *)(type->tp_alloc(type, 0));
+    if (self == NULL) {
+        return NULL;
+    }
+
+    if (load_bundle_zone(self, bundle, bundle_obj, offset)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    self->key = key;
+    Py_INCREF(key);
+
+    return (PyObject *)self;
+}
+
+/* Looks up a key in a bundle's index.
+ *
+ * This returns the offset of the zone record, or 0 if the key is not in the
+ * bundle (no record can start at offset 0, which holds the header).
+ */
+static uint64_t
+find_bundle_zone(const _zone_bundle *bundle, const char *key, size_t key_len)
+{
+    size_t lo = 0;
+    size_t hi = bundle->num_zones;
+
+    // The index is sorted by the encoded keys, compared bytewise
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const unsigned char *entry =
+            bundle->index + mid * BUNDLE_INDEX_ENTRY_SIZE;
+        const char *entry_key =
+            (const char *)bundle->buf + read_le_uint32(entry + 8);
+        size_t entry_key_len = read_le_uint32(entry + 12);
+
+        int cmp = memcmp(key, entry_key,
+                         key_len < entry_key_len ? key_len : entry_key_len);
+        if (cmp == 0) {
+            cmp = (key_len > entry_key_len) - (key_len < entry_key_len);
+        }
+
+        if (cmp == 0) {
+            return read_le_uint64(entry);
+        }
+        else if (cmp < 0) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Populates a ZoneInfo object from a zone record in a bundle.
+ *
+ * The record already contains the derived values (dstoff and the wall-time
+ * transitions), so nothing needs to be inferred. On little-endian platforms
+ * the transition lists are borrowed from the bundle, holding a reference to
+ * `bundle_obj`; otherwise the UTC list is copied and the wall-time lists are
+ * calculated on first use, as for TZif files.
+ *
+ * This returns 0 on success and -1 on failure.
+ *
+ * The function will never return while `self` is partially initialized —
+ * the object only needs to be freed / deallocated if this succeeds.
+ */
+static int
+load_bundle_zone(PyZoneInfo_ZoneInfo *self, const _zone_bundle *bundle,
+                 PyObject *bundle_obj, uint64_t offset)
+{
+    const unsigned char *p = bundle->buf + offset;
+    _zone_block *zone = NULL;
+
+    self->file_repr = NULL;
+
+    size_t num_transitions = read_le_uint32(p);
+    size_t num_ttinfos = read_le_uint32(p + 4);
+    size_t abbr_len = read_le_uint32(p + 8);
+    size_t tz_str_len = read_le_uint32(p + 12);
+
+    uint64_t record_size = BUNDLE_RECORD_HEADER_SIZE +
+                           (uint64_t)num_transitions * (3 * 8 + 1) +
+                           (uint64_t)num_ttinfos * (2 * 4 + 2) + abbr_len +
+                           tz_str_len + 1;
+    if (record_size > bundle->len - offset || abbr_len == 0) {
+        goto invalid;
+    }
+
+    const unsigned char *trans_lists = p + BUNDLE_RECORD_HEADER_SIZE;
+    const unsigned char *utcoff = trans_lists + num_transitions * 3 * 8;
+    const unsigned char *dstoff = utcoff + num_ttinfos * 4;
+    const unsigned char *isdst = dstoff + num_ttinfos * 4;
+    const unsigned char *abbr_idx = isdst + num_ttinfos;
+    const unsigned char *trans_idx = abbr_idx + num_ttinfos;
+    const char *abbr_chars = (const char *)(trans_idx + num_transitions);
+    const char *tz_str = abbr_chars + abbr_len;
+
+    if (abbr_chars[abbr_len - 1] != '\0' || tz_str[tz_str_len] != '\0') {
+        goto invalid;
+    }
+    for (size_t i = 0; i < num_ttinfos; ++i) {
+        if (abbr_idx[i] >= abbr_len) {
+            goto invalid;
+        }
+    }
+    for (size_t i = 0; i < num_transitions; ++i) {
+        if (trans_idx[i] >= num_ttinfos) {
+            goto invalid;
+        }
+    }
+
+    zone = new_zone_block(num_transitions, num_ttinfos);
+    if (zone == NULL) {
+        return -1;
+    }
+
+    if (num_transitions) {
+#ifndef WORDS_BIGENDIAN
+        if (((uintptr_t)trans_lists % sizeof(int64_t)) == 0) {
+            zone->trans_list_utc = (int64_t *)trans_lists;
+            zone->trans_list_wall[0] = zone->trans_list_utc + num_transitions;
+            zone->trans_list_wall[1] =
+                zone->trans_list_wall[0] + num_transitions;
+            zone->data_owner = bundle_obj;
+            zone->borrowed = BORROWED_TRANS_UTC | BORROWED_TRANS_WALL;
+            Py_INCREF(bundle_obj);
+        }
+#endif
+        if (zone->trans_list_utc == NULL) {
+            zone->trans_list_utc =
+                PyMem_Malloc(num_transitions * sizeof(int64_t));
+            if (zone->trans_list_utc == NULL) {
+                PyErr_NoMemory();
+                goto error;
+            }
+            for (size_t i = 0; i < num_transitions; ++i) {
+                zone->trans_list_utc[i] =
+                    (int64_t)read_le_uint64(trans_lists + i * 8);
+            }
+        }
+    }
+
+    if (alloc_zone_data(zone, abbr_len, tz_str_len)) {
+        goto error;
+    }
+
+    _zone_data *data = &(zone->zone_data);
+    for (size_t i = 0; i < num_ttinfos; ++i) {
+        data->utcoff[i] = (int32_t)read_le_uint32(utcoff + i * 4);
+        data->dstoff[i] = (int32_t)read_le_uint32(dstoff + i * 4);
+    }
+    memcpy(data->trans_idx, trans_idx, num_transitions);
+    memcpy(data->isdst, isdst, num_ttinfos);
+    memcpy(data->abbr_idx, abbr_idx, num_ttinfos);
+    memcpy(data->abbr_chars, abbr_chars, abbr_len);
+    memcpy(data->tz_str, tz_str, tz_str_len);
+
+    return publish_zone_block(self, zone);
+invalid:
+    PyErr_SetString(PyExc_ValueError, "Invalid bundle: corrupt zone record");
+error:
+    if (zone != NULL) {
+        release_zone_block(zone);
+    }
+    return -1;
+}
+
+/* Function to calculate the local timestamp of a transition from the year. */
+int64_t
+calendarrule_year_to_timestamp(TransitionRuleType *base_self, int year)
+{
+    CalendarRule *self = (CalendarRule *)base_self;
+
+    // We want (year, month, day of month); we have year and month, but we
+    // need to turn (week, day-of-week) into day-of-month
+    //
+    // Week 1 is the first week in which day `day` (where 0 = Sunday) appears.
+    // Week 5 represents the last occurrence of day `day`, so we need to know
+    // the first weekday of the month and the number of days in the month.
+    //
+    // Other than February, the months with 31 days are the odd months up to
+    // July and the even months from August, which are the months for which
+    // month ^ (month >> 3) is odd.
+    int8_t first_day = (ymd_to_ord(year, self->month, 1) + 6) % 7;
+    uint8_t days_in_month =
+        self->month == 2 ? 28 + is_leap_year(year)
+                         : 30 | (self->month ^ (self->month >> 3));
+
+    // This equation seems magical, so I'll break it down:
+    // 1. calendar says 0 = Monday, POSIX says 0 = Sunday so we need first_day
+    //    + 1 to get 1 = Monday -> 7 = Sunday, which is still equivalent
+    //    because this math is mod 7
+    // 2. Get first day - desired day mod 7 (adjusting by 7 for negative
+    //    numbers so that -1 % 7 = 6).
+    // 3. Add 1 because month days are a 1-based index.
+    int8_t month_day = ((int8_t)(self->day) - (first_day + 1)) % 7;
+    if (month_day < 0) {
+        month_day += 7;
+    }
+    month_day += 1;
+
+    // Now use a 0-based index version of `week` to calculate the w-th
+    // occurrence of `day`
+    month_day += ((int8_t)(self->week) - 1) * 7;
+
+    // month_day will only be > days_in_month if w was 5, and `w` means "last
+    // occurrence of `d`", so now we just check if we over-shot the end of the
+    // month and if so knock off 1 week.
+    if (month_day > days_in_month) {
+        month_day -= 7;
+    }
+
+    int64_t ordinal = ymd_to_ord(year, self->month, month_day) - EPOCHORDINAL;
+    return ((ordinal * 86400) + (int64_t)(self->hour * 3600) +
+            (int64_t)(self->minute * 60) + (int64_t)(self->second));
+}
+
+/* Constructor for CalendarRule. */
+int
+calendarrule_new(uint8_t month, uint8_t week, uint8_t day, int8_t hour,
+                 int8_t minute, int8_t second, CalendarRule *out)
+{
+    // These bounds come from the POSIX standard, which describes an Mm.n.d
+    // rule as:
+    //
+    //   The d'th day (0 <= d <= 6) of week n of month m of the year (1 <= n <=
+    //   5, 1 <= m <= 12, where week 5 means "the last d day in month m" which
+    //   may occur in either the fourth or the fifth week). Week 1 is the first
+    //   week in which the d'th day occurs. Day zero is Sunday.
+    if (month <= 0 || month > 12) {
+        PyErr_Format(PyExc_ValueError, "Month must be in (0, 12]");
+        return -1;
+    }
+
+    if (week <= 0 || week > 5) {
+        PyErr_Format(PyExc_ValueError, "Week must be in (0, 5]");
+        return -1;
+    }
+
+    // The actual bounds of day are (day >= 0 && day <= 6), but since day is an
+    // unsigned variable, day >= 0 is always true. To ensure that a bug is not
+    // introduced in the event that someone changes day to a signed type, we
+    // will assert that it is an unsigned type.
+    Py_ASSERT_VAR_UNSIGNED(day);
+    if (day > 6) {
+        PyErr_Format(PyExc_ValueError, "Day must be in [0, 6]");
+        return -1;
+    }
+
+    TransitionRuleType base = {&calendarrule_year_to_timestamp};
+
+    CalendarRule new_offset = {
+        .base = base,
+        .month = month,
+        .week = week,
+        .day = day,
+        .hour = hour,
+        .minute = minute,
+        .second = second,
+    };
+
+    *out = new_offset;
+    return 0;
+}
+
+/* Function to calculate the local timestamp of a transition from the year.
+ *
+ * This translates the day of the year into a local timestamp — either a
+ * 1-based Julian day, not including leap days, or the 0-based year-day,
+ * including leap days.
+ * */
+int64_t
+dayrule_year_to_timestamp(TransitionRuleType *base_self, int year)
+{
+    // The function signature requires a TransitionRuleType pointer, but this
+    // function is only applicable to DayRule* objects.
+    DayRule *self = (DayRule *)base_self;
+
+    // ymd_to_ord calculates the number of days since 0001-01-01, but we want
+    // to know the number of days since 1970-01-01, so we must subtract off
+    // the equivalent of ymd_to_ord(1970, 1, 1).
+    //
+    // We subtract off an additional 1 day to account for January 1st (we want
+    // the number of full days *before* the date of the transition - partial
+    // days are accounted for in the hour, minute and second portions.
+    int64_t days_before_year = ymd_to_ord(year, 1, 1) - EPOCHORDINAL - 1;
+
+    // The Julian day specification skips over February 29th in leap years,
+    // from the POSIX standard:
+    //
+    //   Leap days shall not be counted. That is, in all years-including leap
+    //   years-February 28 is day 59 and March 1 is day 60. It is impossible to
+    //   refer explicitly to the occasional February 29.
+    //
+    // This is actually more useful than you'd think — if you want a rule that
+    // always transitions on a given calendar day (other than February 29th),
+    // you would use a Julian day, e.g. J91 always refers to April 1st and J365
+    // always refers to December 31st.
+    unsigned int day = self->day;
+    if (self->julian && day >= 59 && is_leap_year(year)) {
+        day += 1;
+    }
+
+    return ((days_before_year + day) * 86400) + (self->hour * 3600) +
+           (self->minute * 60) + self->second;
+}
+
+/* Constructor for DayRule. */
+static int
+dayrule_new(uint8_t julian, unsigned int day, int8_t hour, int8_t minute,
+            int8_t second, DayRule *out)
+{
+    // The POSIX standard specifies that Julian days must be in the range (1 <=
+    // n <= 365) and that non-Julian (they call it "0-based Julian") days must
+    // be in the range (0 <= n <= 365).
+    if (day < julian || day > 365) {
+        PyErr_Format(PyExc_ValueError, "day must be in [%u, 365], not: %u",
+                     julian, day);
+        return -1;
+    }
+
+    TransitionRuleType base = {
+        &dayrule_year_to_timestamp,
+    };
+
+    DayRule tmp = {
+        .base = base,
+        .julian = julian,
+        .day = day,
+        .hour = hour,
+        .minute = minute,
+        .second = second,
+    };
+
+    *out = tmp;
+
+    return 0;
+}
+
+/* Returns the kind of a year (see NUM_YEAR_KINDS). */
+static unsigned char
+year_kind(int year)
+{
+    return (unsigned char)((ymd_to_ord(year, 1, 1) % 7) * 2 +
+                           is_leap_year(year));
+}
+
+/* Fills in YEAR_KIND and YEAR_START_DAYS. */
+static void
+init_year_table(void)
+{
+    for (int i = 0; i < 400; ++i) {
+        YEAR_KIND[i] = year_kind(400 + i);
+        YEAR_START_DAYS[i] = ymd_to_ord(400 + i, 1, 1) - EPOCHORDINAL;
+    }
+}
+
+/* Tabulates the transitions of a _tzrule for each kind of year.
+ *
+ * Each kind of year occurs within the first 28 years of the 400-year cycle,
+ * so those are enough to find the offsets of the transitions into every
+ * kind of year.
+ */
+static void
+tabulate_tzrule(_tzrule *rule)
+{
+    for (int i = 0; i < 28; ++i) {
+        int year = 400 + i;
+        unsigned char kind = YEAR_KIND[i];
+        int64_t year_start = (int64_t)YEAR_START_DAYS[i] * 86400;
+
+        rule->start_in_year[kind] = (int32_t)(
+            rule->start->year_to_timestamp(rule->start, year) - year_start);
+        rule->end_in_year[kind] = (int32_t)(
+            rule->end->year_to_timestamp(rule->end, year) - year_start);
+    }
+}
+
+/* Returns the timestamp of the start of a year (which may be 10000). */
+static int64_t
+year_start_timestamp(int year)
+{
+    assert(year >= 1);
+    int cycle = year / 400;
+    int idx = year % 400;
+
+    return ((cycle - 1) * DAYS_IN_400_YEARS + YEAR_START_DAYS[idx]) * 86400;
+}
+
+/* Calculate the start and end rules for a _tzrule in the given year.
+ *
+ * Rather than working out the dates of the transitions, this looks up the
+ * start of the year and its kind in the 400-year table and adds the offsets
+ * tabulated for that kind of year by tabulate_tzrule.
+ */
+static void
+tzrule_transitions(_tzrule *rule, int year, int64_t *start, int64_t *end)
+{
+    int64_t year_start = year_start_timestamp(year);
+    unsigned char kind = YEAR_KIND[year % 400];
+
+    *start = year_start + rule->start_in_year[kind];
+    *end = year_start + rule->end_in_year[kind];
+}
+
+/* Shrinks the interval [*lo, *hi) around `ts` so that it does not contain
+ * `boundary`, unless `boundary` is its start.
+ */
+static void
+narrow_interval(int64_t ts, int64_t boundary, int64_t *lo, int64_t *hi)
+{
+    if (boundary <= ts) {
+        if (boundary > *lo) {
+            *lo = boundary;
+        }
+    }
+    else if (boundary < *hi) {
+        *hi = boundary;
+    }
+}
+
+/* Narrows [*lo, *hi) to the year containing `ts`, since a _tzrule's
+ * transitions are found for one year at a time.
+ */
+static void
+narrow_to_year(int64_t ts, int year, int64_t *lo, int64_t *hi)
+{
+    narrow_interval(ts, year_start_timestamp(year), lo, hi);
+    narrow_interval(ts, year_start_timestamp(year + 1), lo, hi);
+}
+
+/* Calculate the _ttinfo that applies at a given local time from a _tzrule.
+ *
+ * This takes a local timestamp and fold for disambiguation purposes; the year
+ * could technically be calculated from the timestamp, but given that
+ * get_local_timestamp already provides it (from the datetime struct where it
+ * can), it is taken as an additional parameter to reduce unncessary
+ * calculation. It must be the year that `ts` falls in.
+ *
+ * The interval [*lo, *hi), which must contain `ts`, is narrowed to one in
+ * which the same _ttinfo applies.
+ * */
+static _ttinfo *
+find_tzrule_ttinfo(_tzrule *rule, int64_t ts, unsigned char fold, int year,
+                   int64_t *lo, int64_t *hi)
+{
+    if (rule->std_only) {
+        return &(rule->std);
+    }
+
+    int64_t start, end;
+    uint8_t isdst;
+
+    tzrule_transitions(rule, year, &start, &end);
+
+    // With fold = 0, the period (denominated in local time) with the smaller
+    // offset starts at the end of the gap and ends at the end of the fold;
+    // with fold = 1, it runs from the start of the gap to the beginning of the
+    // fold.
+    //
+    // So in order to determine the DST boundaries we need to know both the
+    // fold and whether DST is positive or negative (rare), and it turns out
+    // that this boils down to fold XOR is_positive.
+    if (fold == (rule->dst_diff >= 0)) {
+        end -= rule->dst_diff;
+    }
+    else {
+        start += rule->dst_diff;
+    }
+
+    narrow_to_year(ts, year, lo, hi);
+    narrow_interval(ts, start, lo, hi);
+    narrow_interval(ts, end, lo, hi);
+
+    if (start < end) {
+        isdst = (ts >= start) && (ts < end);
+    }
+    else {
+        isdst = (ts < end) || (ts >= start);
+    }
+
+    if (isdst) {
+        return &(rule->dst);
+    }
+    else {
+        return &(rule->std);
+    }
+}
+
+/* Calculate the ttinfo and fold that applies for a _tzrule at an epoch time.
+ *
+ * This function can determine the _ttinfo that applies at a given epoch time,
+ * (analogous to trans_list_utc), and whether or not the datetime is in a fold.
+ * This is to be used in the .fromutc() function.
+ *
+ * The year is technically a redundant parameter, because it can be calculated
+ * from the timestamp, but callers usually have it from get_local_timestamp
+ * anyway, so taking it as a parameter saves unnecessary calculation.
+ *
+ * Like find_tzrule_ttinfo, this narrows [*lo, *hi) to an interval in which
+ * the same _ttinfo and fold apply.
+ **/
+static _ttinfo *
+find_tzrule_ttinfo_fromutc(_tzrule *rule, int64_t ts, int year,
+                           unsigned char *fold, int64_t *lo, int64_t *hi)
+{
+    if (rule->std_only) {
+        *fold = 0;
+        return &(rule->std);
+    }
+
+    int64_t start, end;
+    uint8_t isdst;
+    tzrule_transitions(rule, year, &start, &end);
+    start -= rule->std.utcoff_seconds;
+    end -= rule->dst.utcoff_seconds;
+
+    if (start < end) {
+        isdst = (ts >= start) && (ts < end);
+    }
+    else {
+        isdst = (ts < end) || (ts >= start);
+    }
+
+    // For positive DST, the ambiguous period is one dst_diff after the end of
+    // DST; for negative DST, the ambiguous period is one dst_diff before the
+    // start of DST.
+    int64_t ambig_start, ambig_end;
+    if (rule->dst_diff > 0) {
+        ambig_start = end;
+        ambig_end = end + rule->dst_diff;
+    }
+    else {
+        ambig_start = start;
+        ambig_end = start - rule->dst_diff;
+    }
+
+    *fold = (ts >= ambig_start) && (ts < ambig_end);
+
+    narrow_to_year(ts, year, lo, hi);
+    narrow_interval(ts, start, lo, hi);
+    narrow_interval(ts, end, lo, hi);
+    narrow_interval(ts, ambig_start, lo, hi);
+    narrow_interval(ts, ambig_end, lo, hi);
+
+    if (isdst) {
+        return &(rule->dst);
+    }
+    else {
+        return &(rule->std);
+    }
+}
+
+/* Parse a TZ string in the format specified by the POSIX standard:
+ *
+ *  std offset[dst[offset],start[/time],end[/time]]
+ *
+ *  std and dst must be 3 or more characters long and must not contain a
+ *  leading colon, embedded digits, commas, nor a plus or minus signs; The
+ *  spaces between "std" and "offset" are only for display and are not actually
+ *  present in the string.
+ *
+ *  The format of the offset is ``[+|-]hh[:mm[:ss]]``
+ *
+ * See the POSIX.1 spec: IEE Std 1003.1-2018 §8.3:
+ *
+ * https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/V1_chap08.html
+ *
+ * This only decodes the string into C values; tzstr_to_tzrule builds the
+ * corresponding _tzrule.
+ */
+static int
+parse_tz_str(const char *tz_str, _tzstr *out)
+{
+    const char *std_abbr = NULL;
+    const char *dst_abbr = NULL;
+    Py_ssize_t std_abbr_len = 0;
+    Py_ssize_t dst_abbr_len = 0;
+    TransitionRuleType *start = NULL;
+    TransitionRuleType *end = NULL;
+    // Initialize offsets to invalid value (> 24 hours)
+    long std_offset = 1 << 20;
+    long dst_offset = 1 << 20;
+
+    const char *p = tz_str;
+
+    // Read the `std` abbreviation, which must be at least 3 characters long.
+    Py_ssize_t num_chars = parse_abbr(p, &std_abbr, &std_abbr_len);
+    if (num_chars < 1) {
+        PyErr_Format(PyExc_ValueError, "Invalid STD format in '%s'", tz_str);
+        goto error;
+    }
+
+    p += num_chars;
+
+    // Now read the STD offset, which is required
+    num_chars = parse_tz_delta(p, &std_offset);
+    if (num_chars < 0) {
+        PyErr_Format(PyExc_ValueError, "Invalid STD offset in '%s'", tz_str);
+        goto error;
+    }
+    p += num_chars;
+
+    // If the string ends here, there is no DST, otherwise we must parse the
+    // DST abbreviation and start and end dates and times.
+    if (*p == '\0') {
+        goto complete;
+    }
+
+    num_chars = parse_abbr(p, &dst_abbr, &dst_abbr_len);
+    if (num_chars < 1) {
+        PyErr_Format(PyExc_ValueError, "Invalid DST format in '%s'", tz_str);
+        goto error;
+    }
+    p += num_chars;
+
+    if (*p == ',') {
+        // From the POSIX standard:
+        //
+        // If no offset follows dst, the alternative time is assumed to be one
+        // hour ahead of standard time.
+        dst_offset = std_offset + 3600;
+    }
+    else {
+        num_chars = parse_tz_delta(p, &dst_offset);
+        if (num_chars < 0) {
+            PyErr_Format(PyExc_ValueError, "Invalid DST offset in '%s'",
+                         tz_str);
+            goto error;
+        }
+
+        p += num_chars;
+    }
+
+    TransitionRuleType **transitions[2] = {&start, &end};
+    for (size_t i = 0; i < 2; ++i) {
+        if (*p != ',') {
+            PyErr_Format(PyExc_ValueError,
+                         "Missing transition rules in TZ string: '%s'",
+                         tz_str);
+            goto error;
+        }
+        p++;
+
+        num_chars = parse_transition_rule(p, transitions[i]);
+        if (num_chars < 0) {
+            PyErr_Format(PyExc_ValueError,
+                         "Malformed transition rule in TZ string: '%s'",
+                         tz_str);
+            goto error;
+        }
+        p += num_chars;
+    }
+
+    if (*p != '\0') {
+        PyErr_Format(PyExc_ValueError,
+                     "Extraneous characters at end of TZ string: '%s'",
+                     tz_str);
+        goto error;
+    }
+
+complete:
+    out->std_abbr = std_abbr;
+    out->std_abbr_len = std_abbr_len;
+    out->dst_abbr = dst_abbr;
+    out->dst_abbr_len = dst_abbr_len;
+    out->std_offset = std_offset;
+    out->dst_offset = dst_offset;
+    out->start = start;
+    out->end = end;
+
+    return 0;
+error:
+    if (start != NULL) {
+        PyMem_Free(start);
+    }
+
+    if (end != NULL) {
+        PyMem_Free(end);
+    }
+
+    return -1;
+}
+
+/* Destructor for _tzstr. */
+static void
+free_tzstr(_tzstr *tzstr)
+{
+    if (tzstr->start != NULL) {
+        PyMem_Free(tzstr->start);
+        tzstr->start = NULL;
+    }
+
+    if (tzstr->end != NULL) {
+        PyMem_Free(tzstr->end);
+        tzstr->end = NULL;
+    }
+}
+
+/* Builds the _tzrule for a parsed TZ string.
+ *
+ * The rule shares the transition rules with `tzstr` rather than copying
+ * them, so only one of the two may free them.
+ */
+static int
+tzstr_to_tzrule(const _tzstr *tzstr, _tzrule *out)
+{
+    PyObject *dst_abbr = NULL;
+    PyObject *std_abbr = load_tzname(tzstr->std_abbr, tzstr->std_abbr_len);
+    if (std_abbr == NULL) {
+        return -1;
+    }
+
+    if (tzstr->dst_abbr != NULL) {
+        dst_abbr = load_tzname(tzstr->dst_abbr, tzstr->dst_abbr_len);
+        if (dst_abbr == NULL) {
+            Py_DECREF(std_abbr);
+            return -1;
+        }
+    }
+
+    int rv = build_tzrule(std_abbr, dst_abbr, tzstr->std_offset,
+                          tzstr->dst_offset, tzstr->start, tzstr->end, out);
+    Py_DECREF(std_abbr);
+    Py_XDECREF(dst_abbr);
+
+    return rv;
+}
+
+static int
+parse_uint(const char *const p, uint8_t *value)
+{
+    if (!isdigit(*p)) {
+        return -1;
+    }
+
+    *value = (*p) - '0';
+    return 0;
+}
+
+/* Parse the STD and DST abbreviations from a TZ string.
+ *
+ * The abbreviation is returned as a pointer into the TZ string and a length.
+ */
+static Py_ssize_t
+parse_abbr(const char *const p, const char **abbr, Py_ssize_t *abbr_len)
+{
+    const char *ptr = p;
+    char buff = *ptr;
+    const char *str_start;
+    const char *str_end;
+
+    if (*ptr == '<') {
+        ptr++;
+        str_start = ptr;
+        while ((buff = *ptr) != '>') {
+            // From the POSIX standard:
+            //
+            //   In the quoted form, the first character shall be the less-than
+            //   ( '<' ) character and the last character shall be the
+            //   greater-than ( '>' ) character. All characters between these
+            //   quoting characters shall be alphanumeric characters from the
+            //   portable character set in the current locale, the plus-sign (
+            //   '+' ) character, or the minus-sign ( '-' ) character. The std
+            //   and dst fields in this case shall not include the quoting
+            //   characters.
+            if (!isalpha(buff) && !isdigit(buff) && buff != '+' &&
+                buff != '-') {
+                return -1;
+            }
+            ptr++;
+        }
+        str_end = ptr;
+        ptr++;
+    }
+    else {
+        str_start = p;
+        // From the POSIX standard:
+        //
+        //   In the unquoted form, all characters in these fields shall be
+        //   alphabetic characters from the portable character set in the
+        //   current locale.
+        while (isalpha(*ptr)) {
+            ptr++;
+        }
+        str_end = ptr;
+    }
+
+    *abbr = str_start;
+    *abbr_len = str_end - str_start;
+
+    return ptr - p;
+}
+
+/* Parse a UTC offset from a TZ str. */
+static Py_ssize_t
+parse_tz_delta(const char *const p, long *total_seconds)
+{
+    // From the POSIX spec:
+    //
+    //   Indicates the value added to the local time to arrive at Coordinated
+    //   Universal Time. The offset has the form:
+    //
+    //   hh[:mm[:ss]]
+    //
+    //   One or more digits may be used; the value is always interpreted as a
+    //   decimal number.
+    //
+    // The POSIX spec says that the values for `hour` must be between 0 and 24
+    // hours, but RFC 8536 §3.3.1 specifies that the hours part of the
+    // transition times may be signed and range from -167 to 167.
+    long sign = -1;
+    long hours = 0;
+    long minutes = 0;
+    long seconds = 0;
+
+    const char *ptr = p;
+    char buff = *ptr;
+    if (buff == '-' || buff == '+') {
+        // Negative numbers correspond to *positive* offsets, from the spec:
+        //
+        //   If preceded by a '-', the timezone shall be east of the Prime
+        //   Meridian; otherwise, it shall be west (which may be indicated by
+        //   an optional preceding '+' ).
+        if (buff == '-') {
+            sign = 1;
+        }
+
+        ptr++;
+    }
+
+    // The hour can be 1 or 2 numeric characters
+    for (size_t i = 0; i < 2; ++i) {
+        buff = *ptr;
+        if (!isdigit(buff)) {
+            if (i == 0) {
+                return -1;
+            }
+            else {
+                break;
+            }
+        }
+
+        hours *= 10;
+        hours += buff - '0';
+        ptr++;
+    }
+
+    if (hours > 24 || hours < 0) {
+        return -1;
+    }
+
+    // Minutes and seconds always of the format ":dd"
+    long *outputs[2] = {&minutes, &seconds};
+    for (size_t i = 0; i < 2; ++i) {
+        if (*ptr != ':') {
+            goto complete;
+        }
+        ptr++;
+
+        for (size_t j = 0; j < 2; ++j) {
+            buff = *ptr;
+            if (!isdigit(buff)) {
+                return -1;
+            }
+            *(outputs[i]) *= 10;
+            *(outputs[i]) += buff - '0';
+            ptr++;
+        }
+    }
+
+complete:
+    *total_seconds = sign * ((hours * 3600) + (minutes * 60) + seconds);
+
+    return ptr - p;
+}
+
+/* Parse the date portion of a transition rule. */
+static Py_ssize_t
+parse_transition_rule(const char *const p, TransitionRuleType **out)
+{
+    // The full transition rule indicates when to change back and forth between
+    // STD and DST, and has the form:
+    //
+    //   date[/time],date[/time]
+    //
+    // This function parses an individual date[/time] section, and returns
+    // the number of characters that contributed to the transition rule. This
+    // does not include the ',' at the end of the first rule.
+    //
+    // The POSIX spec states that if *time* is not given, the default is 02:00.
+    const char *ptr = p;
+    int8_t hour = 2;
+    int8_t minute = 0;
+    int8_t second = 0;
+
+    // Rules come in one of three flavors:
+    //
+    //   1. Jn: Julian day n, with no leap days.
+    //   2. n: Day of year (0-based, with leap days)
+    //   3. Mm.n.d: Specifying by month, week and day-of-week.
+
+    if (*ptr == 'M') {
+        uint8_t month, week, day;
+        ptr++;
+        if (parse_uint(ptr, &month)) {
+            return -1;
+        }
+        ptr++;
+        if (*ptr != '.') {
+            uint8_t tmp;
+            if (parse_uint(ptr, &tmp)) {
+                return -1;
+            }
+
+            month *= 10;
+            month += tmp;
+            ptr++;
+        }
+
+        uint8_t *values[2] = {&week, &day};
+        for (size_t i = 0; i < 2; ++i) {
+            if (*ptr != '.') {
+                return -1;
+            }
+            ptr++;
+
+            if (parse_uint(ptr, values[i])) {
+                return -1;
+            }
+            ptr++;
+        }
+
+        if (*ptr == '/') {
+            ptr++;
+            Py_ssize_t num_chars =
+                parse_transition_time(ptr, &hour, &minute, &second);
+            if (num_chars < 0) {
+                return -1;
+            }
+            ptr += num_chars;
+        }
+
+        CalendarRule *rv = PyMem_Calloc(1, sizeof(CalendarRule));
+        if (rv == NULL) {
+            return -1;
+        }
+
+        if (calendarrule_new(month, week, day, hour, minute, second, rv)) {
+            PyMem_Free(rv);
+            return -1;
+        }
+
+        *out = (TransitionRuleType *)rv;
+    }
+    else {
+        uint8_t julian = 0;
+        unsigned int day = 0;
+        if (*ptr == 'J') {
+            julian = 1;
+            ptr++;
+        }
+
+        for (size_t i = 0; i < 3; ++i) {
+            if (!isdigit(*ptr)) {
+                if (i == 0) {
+                    return -1;
+                }
+                break;
+            }
+            day *= 10;
+            day += (*ptr) - '0';
+            ptr++;
+        }
+
+        if (*ptr == '/') {
+            ptr++;
+            Py_ssize_t num_chars =
+                parse_transition_time(ptr, &hour, &minute, &second);
+            if (num_chars < 0) {
+                return -1;
+            }
+            ptr += num_chars;
+        }
+
+        DayRule *rv = PyMem_Calloc(1, sizeof(DayRule));
+        if (rv == NULL) {
+            return -1;
+        }
+
+        if (dayrule_new(julian, day, hour, minute, second, rv)) {
+            PyMem_Free(rv);
+            return -1;
+        }
+        *out = (TransitionRuleType *)rv;
+    }
+
+    return ptr - p;
+}
+
+/* Parse the time portion of a transition rule (e.g. following an /) */
+static Py_ssize_t
+parse_transition_time(const char *const p, int8_t *hour, int8_t *minute,
+                      int8_t *second)
+{
+    // From the spec:
+    //
+    //   The time has the same format as offset except that no leading sign
+    //   ( '-' or '+' ) is allowed.
+    //
+    // The format for the offset is:
+    //
+    //   h[h][:mm[:ss]]
+    //
+    // RFC 8536 also allows transition times to be signed and to range from
+    // -167 to +167, but the current version only supports [0, 99].
+    //
+    // TODO: Support the full range of transition hours.
+    int8_t *components[3] = {hour, minute, second};
+    const char *ptr = p;
+    int8_t sign = 1;
+
+    if (*ptr == '-' || *ptr == '+') {
+        if (*ptr == '-') {
+            sign = -1;
+        }
+        ptr++;
+    }
+
+    for (size_t i = 0; i < 3; ++i) {
+        if (i > 0) {
+            if (*ptr != ':') {
+                break;
+            }
+            ptr++;
+        }
+
+        uint8_t buff = 0;
+        for (size_t j = 0; j < 2; j++) {
+            if (!isdigit(*ptr)) {
+                if (i == 0 && j > 0) {
+                    break;
+                }
+                return -1;
+            }
+
+            buff *= 10;
+            buff += (*ptr) - '0';
+            ptr++;
+        }
+
+        *(components[i]) = sign * buff;
+    }
+
+    return ptr - p;
+}
+
+/* Constructor for a _tzrule.
+ *
+ * If `dst_abbr` is NULL, this will construct an "STD-only" _tzrule, in which
+ * case `dst_offset` will be ignored and `start` and `end` are expected to be
+ * NULL as well.
+ *
+ * Returns 0 on success.
+ */
+static int
+build_tzrule(PyObject *std_abbr, PyObject *dst_abbr, long std_offset,
+             long dst_offset, TransitionRuleType *start,
+             TransitionRuleType *end, _tzrule *out)
+{
+    _tzrule rv = {{0}};
+
+    rv.start = start;
+    rv.end = end;
+
+    if (build_ttinfo(std_offset, 0, std_abbr, &rv.std)) {
+        goto error;
+    }
+
+    if (dst_abbr != NULL) {
+        rv.dst_diff = dst_offset - std_offset;
+        if (build_ttinfo(dst_offset, rv.dst_diff, dst_abbr, &rv.dst)) {
+            goto error;
+        }
+    }
+    else {
+        rv.std_only = 1;
+    }
+
+    if (rv.start != NULL && rv.end != NULL) {
+        tabulate_tzrule(&rv);
+    }
+
+    *out = rv;
+
+    return 0;
+error:
+    xdecref_ttinfo(&rv.std);
+    xdecref_ttinfo(&rv.dst);
+    return -1;
+}
+
+/* Destructor for _tzrule. */
+static void
+free_tzrule(_tzrule *tzrule)
+{
+    xdecref_ttinfo(&(tzrule->std));
+    if (!tzrule->std_only) {
+        xdecref_ttinfo(&(tzrule->dst));
+    }
+
+    if (tzrule->start != NULL) {
+        PyMem_Free(tzrule->start);
+    }
+
+    if (tzrule->end != NULL) {
+        PyMem_Free(tzrule->end);
+    }
+}
+
+/* Calculate DST offsets from transitions and UTC offsets
+ *
+ * This is necessary because each C `ttinfo` only contains the UTC offset,
+ * time zone abbreviation and an isdst boolean - it does not include the
+ * amount of the DST offset, but we need the amount for the dst() function.
+ *
+ * Thus function uses heuristics to infer what the offset should be, so it
+ * is not guaranteed that this will work for all zones. If we cannot assign
+ * a value for a given DST offset, we'll assume it's 1H rather than 0H, so
+ * bool(dt.dst()) will always match ttinfo.isdst.
+ */
+static void
+utcoff_to_dstoff(const unsigned char *trans_idx, const long *utcoffs,
+                 long *dstoffs, const unsigned char *isdsts,
+                 size_t num_transitions, size_t num_ttinfos)
+{
+    size_t dst_count = 0;
+    size_t dst_found = 0;
+    for (size_t i = 0; i < num_ttinfos; ++i) {
+        dst_count++;
+    }
+
+    for (size_t i = 1; i < num_transitions; ++i) {
+        if (dst_count == dst_found) {
+            break;
+        }
+
+        size_t idx = trans_idx[i];
+        size_t comp_idx = trans_idx[i - 1];
+
+        // Only look at DST offsets that have nto been assigned already
+        if (!isdsts[idx] || dstoffs[idx] != 0) {
+            continue;
+        }
+
+        long dstoff = 0;
+        long utcoff = utcoffs[idx];
+
+        if (!isdsts[comp_idx]) {
+            dstoff = utcoff - utcoffs[comp_idx];
+        }
+
+        if (!dstoff && idx < (num_ttinfos - 1)) {
+            comp_idx = trans_idx[i + 1];
+
+            // If the following transition is also DST and we couldn't find
+            // the DST offset by this point, we're going to have to skip it
+            // and hope this transition gets assigned later
+            if (isdsts[comp_idx]) {
+                continue;
+            }
+
+            dstoff = utcoff - utcoffs[comp_idx];
+        }
+
+        if (dstoff) {
+            dst_found++;
+            dstoffs[idx] = dstoff;
+        }
+    }
+
+    if (dst_found < dst_count) {
+        // If there are time zones we didn't find a value for, we'll end up
+        // with dstoff = 0 for something where isdst=1. This is obviously
+        // wrong — one hour will be a much better guess than 0.
+        for (size_t idx = 0; idx < num_ttinfos; ++idx) {
+            if (isdsts[idx] && !dstoffs[idx]) {
+                dstoffs[idx] = 3600;
+            }
+        }
+    }
+}
+
+#define _swap(x, y, buffer) \
+    buffer = x;             \
+    x = y;                  \
+    y = buffer;
+
+/* Calculate transitions in local time from UTC time and offsets.
+ *
+ * We want to know when each transition occurs, denominated in the number of
+ * nominal wall-time seconds between 1970-01-01T00:00:00 and the transition in
+ * *local time* (note: this is *not* equivalent to the output of
+ * datetime.timestamp, which is the total number of seconds actual elapsed
+ * since 1970-01-01T00:00:00Z in UTC).
+ *
+ * This is an ambiguous question because "local time" can be ambiguous — but it
+ * is disambiguated by the `fold` parameter, so we allocate two arrays:
+ *
+ *  trans_local[0]: The wall-time transitions for fold=0
+ *  trans_local[1]: The wall-time transitions for fold=1
+ *
+ * This returns 0 on success and a negative number of failure. The trans_local
+ * arrays must be freed if they are not NULL.
+ */
+static int
+ts_to_local(const unsigned char *trans_idx, const int64_t *trans_utc,
+            const long *utcoff, int64_t *trans_local[2], size_t num_ttinfos,
+            size_t num_transitions)
+{
+    if (num_transitions == 0) {
+        return 0;
+    }
+
+    // Copy the UTC transitions into each array to be modified in place later
+    for (size_t i = 0; i < 2; ++i) {
+        trans_local[i] = PyMem_Malloc(num_transitions * sizeof(int64_t));
+        if (trans_local[i] == NULL) {
+            return -1;
+        }
+
+        memcpy(trans_local[i], trans_utc, num_transitions * sizeof(int64_t));
+    }
+
+    int64_t offset_0, offset_1, buff;
+    if (num_ttinfos > 1) {
+        offset_0 = utcoff[0];
+        offset_1 = utcoff[trans_idx[0]];
+
+        if (offset_1 > offset_0) {
+            _swap(offset_0, offset_1, buff);
+        }
+    }
+    else {
+        offset_0 = utcoff[0];
+        offset_1 = utcoff[0];
+    }
+
+    trans_local[0][0] += offset_0;
+    trans_local[1][0] += offset_1;
+
+    for (size_t i = 1; i < num_transitions; ++i) {
+        offset_0 = utcoff[trans_idx[i - 1]];
+        offset_1 = utcoff[trans_idx[i]];
+
+        if (offset_1 > offset_0) {
+            _swap(offset_1, offset_0, buff);
+        }
+
+        trans_local[0][i] += offset_0;
+        trans_local[1][i] += offset_1;
+    }
+
+    return 0;
+}
+
+/* Simple bisect_right binary search implementation */
+static size_t
+_bisect(const int64_t value, const int64_t *arr, size_t size)
+{
+    size_t lo = 0;
+    size_t hi = size;
+    size_t m;
+
+    while (lo < hi) {
+        m = (lo + hi) / 2;
+        if (arr[m] > value) {
+            hi = m;
+        }
+        else {
+            lo = m + 1;
+        }
+    }
+
+    return hi;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr)
+#endif
+
+/* bisect_right over a list stored as an Eytzinger tree (see _trans_search).
+ *
+ * Each step down the tree is a comparison whose result is added to the index
+ * rather than branched on, and the elements four levels down (which are
+ * contiguous) are prefetched while the current level is compared. When the
+ * descent falls off the tree, the index of the first element greater than
+ * `value` is found by undoing the right turns taken after the last left
+ * turn; if there were no left turns, every element is less than or equal to
+ * `value`.
+ */
+static size_t
+_eytzinger_bisect(const int64_t value, const int64_t *tree,
+                  const uint32_t *rank, size_t size)
+{
+    size_t k = 1;
+    while (k <= size) {
+        PREFETCH(tree + 16 * k);
+        k = 2 * k + (tree[k] <= value);
+    }
+
+    // Strip the trailing ones and then the last zero
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+
+    return k ? rank[k] : size;
+}
+
+/* bisect_right over one of the transition lists of a zone, `arr`, using its
+ * Eytzinger-ordered copy `tree` if there is one.
+ */
+static size_t
+bisect_transitions(const _zone_block *zone, const int64_t value,
+                   const int64_t *arr, const int64_t *tree)
+{
+    if (tree == NULL) {
+        return _bisect(value, arr, zone->num_transitions);
+    }
+
+    return _eytzinger_bisect(value, tree, zone->trans_search.rank,
+                             zone->num_transitions);
+}
+
+/* Find the ttinfo rules that apply at a given local datetime. */
+static _ttinfo *
+find_ttinfo(PyZoneInfo_ZoneInfo *self, PyObject *dt)
+{
+    unsigned char fold = 0;
+    if (dt != Py_None && get_fold(dt, &fold)) {
+        return NULL;
+    }
+
+    return self->zone->lookup->find_ttinfo(self, dt, fold);
+}
+
+/* Returns the ttinfo of the last interval found in a zone if it contains
+ * `ts`, or NULL.
+ */
+static _ttinfo *
+find_last_interval(const _last_interval *last, int64_t ts)
+{
+    if (ts >= last->start && ts < last->end &&
+        last->generation == TABLES_GENERATION) {
+        return last->ttinfo;
+    }
+
+    return NULL;
+}
+
+static void
+set_last_interval(_last_interval *last, int64_t lo, int64_t hi,
+                  _ttinfo *ttinfo, unsigned char fold)
+{
+    last->start = lo;
+    last->end = hi;
+    last->ttinfo = ttinfo;
+    last->fold = fold;
+    last->generation = TABLES_GENERATION;
+}
+
+/* find_ttinfo for zones whose offset never changes.
+ *
+ * The result does not depend on the datetime, so no timestamp is
+ * calculated. Objects that are not datetimes are passed on to the general
+ * lookup, which raises the appropriate error if they lack the attributes
+ * of a datetime.
+ */
+static _ttinfo *
+find_fixed_offset_ttinfo(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                         unsigned char fold)
+{
+    if (dt != Py_None && !PyDateTime_Check(dt)) {
+        return TRANSITIONS_LOOKUP.find_ttinfo(self, dt, fold);
+    }
+
+    if (ensure_tzrule_after(self->zone)) {
+        return NULL;
+    }
+    return &(self->zone->tzrule_after.std);
+}
+
+/* find_ttinfo for zones without transitions, which only have a rule. */
+static _ttinfo *
+find_rule_only_ttinfo(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                      unsigned char fold)
+{
+    // datetime.time has a .tzinfo attribute that passes None as the dt
+    // argument; it only really has meaning for fixed-offset zones.
+    if (dt == Py_None) {
+        return &NO_TTINFO;
+    }
+
+    int64_t ts;
+    int year;
+    if (get_local_timestamp(dt, &ts, &year)) {
+        return NULL;
+    }
+
+    assert(fold < 2);
+    _last_interval *last = &(self->last_wall[fold]);
+    _ttinfo *tti = find_last_interval(last, ts);
+    if (tti != NULL) {
+        return tti;
+    }
+
+    _zone_block *zone = self->zone;
+    if (ensure_tzrule_after(zone)) {
+        return NULL;
+    }
+
+    int64_t lo = INT64_MIN;
+    int64_t hi = INT64_MAX;
+    tti = find_tzrule_ttinfo(&(zone->tzrule_after), ts, fold, year, &lo,
+                             &hi);
+    set_last_interval(last, lo, hi, tti, 0);
+    return tti;
+}
+
+/* Finds the ttinfo that applies at a local timestamp (in `year`) with the
+ * given fold in a zone, narrowing [*lo, *hi) to an interval in which it does
+ * not change.
+ *
+ * Like find_utc_ttinfo, this reads the tables built by ensure_lookup_tables
+ * and uses no Python objects, so it can be called without the GIL.
+ */
+static _ttinfo *
+find_local_ttinfo(_zone_block *zone, int64_t ts, unsigned char fold,
+                  int year, int64_t *lo, int64_t *hi)
+{
+    size_t num_trans = zone->num_transitions;
+
+    if (!num_trans || ts > zone->zone_data.last_trans_wall[fold]) {
+        if (num_trans) {
+            *lo = zone->zone_data.last_trans_wall[fold] + 1;
+        }
+        return find_tzrule_ttinfo(&(zone->tzrule_after), ts, fold, year, lo,
+                                  hi);
+    }
+
+    int64_t *local_transitions = zone->trans_list_wall[fold];
+    if (ts < local_transitions[0]) {
+        *hi = local_transitions[0];
+        return zone->ttinfo_before;
+    }
+
+    size_t idx = bisect_transitions(zone, ts, local_transitions,
+                                    zone->trans_search.wall[fold]) -
+                 1;
+    assert(idx < num_trans);
+    *lo = local_transitions[idx];
+    *hi = idx + 1 < num_trans ? local_transitions[idx + 1]
+                              : zone->zone_data.last_trans_wall[fold] + 1;
+    return zone->trans_ttinfos[idx];
+}
+
+/* find_ttinfo for zones with transitions, followed by tzrule_after. */
+static _ttinfo *
+find_transitions_ttinfo(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                        unsigned char fold)
+{
+    _zone_block *zone = self->zone;
+
+    if (dt == Py_None) {
+        if (zone->fixed_offset) {
+            if (ensure_tzrule_after(zone)) {
+                return NULL;
+            }
+            return &(zone->tzrule_after.std);
+        }
+        else {
+            return &NO_TTINFO;
+        }
+    }
+
+    int64_t ts;
+    int year;
+    if (get_local_timestamp(dt, &ts, &year)) {
+        return NULL;
+    }
+
+    assert(fold < 2);
+    _last_interval *last = &(self->last_wall[fold]);
+    _ttinfo *tti = find_last_interval(last, ts);
+    if (tti != NULL) {
+        return tti;
+    }
+
+    // Only the tables for the part of the zone that the timestamp falls in
+    // are built
+    if (!zone->num_transitions ||
+        ts > zone->zone_data.last_trans_wall[fold]) {
+        if (ensure_tzrule_after(zone)) {
+            return NULL;
+        }
+    }
+    else if (ensure_trans_list_wall(zone) || ensure_trans_search(zone) ||
+             ensure_ttinfos(zone)) {
+        return NULL;
+    }
+
+    int64_t lo = INT64_MIN;
+    int64_t hi = INT64_MAX;
+    tti = find_local_ttinfo(zone, ts, fold, year, &lo, &hi);
+    set_last_interval(last, lo, hi, tti, 0);
+    return tti;
+}
+
+/* find_ttinfo_fromutc for zones whose offset never changes. */
+static _ttinfo *
+find_fixed_offset_ttinfo_fromutc(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                                 unsigned char *fold)
+{
+    if (ensure_tzrule_after(self->zone)) {
+        return NULL;
+    }
+
+    *fold = 0;
+    return &(self->zone->tzrule_after.std);
+}
+
+/* find_ttinfo_fromutc for zones without transitions. */
+static _ttinfo *
+find_rule_only_ttinfo_fromutc(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                              unsigned char *fold)
+{
+    int64_t timestamp;
+    int year;
+    if (get_local_timestamp(dt, &timestamp, &year)) {
+        return NULL;
+    }
+
+    _last_interval *last = &(self->last_utc);
+    _ttinfo *tti = find_last_interval(last, timestamp);
+    if (tti != NULL) {
+        *fold = last->fold;
+        return tti;
+    }
+
+    _zone_block *zone = self->zone;
+    if (ensure_tzrule_after(zone)) {
+        return NULL;
+    }
+
+    int64_t lo = INT64_MIN;
+    int64_t hi = INT64_MAX;
+    tti = find_tzrule_ttinfo_fromutc(&(zone->tzrule_after), timestamp, year,
+                                     fold, &lo, &hi);
+    set_last_interval(last, lo, hi, tti, *fold);
+    return tti;
+}
+
+/* Finds the ttinfo and fold that apply at a UTC timestamp (in `year`) in a
+ * zone, narrowing [*lo, *hi) to an interval in which they do not change.
+ *
+ * This reads the tables built by ensure_lookup_tables (only those for the
+ * part of the zone that `timestamp` falls in are needed) and uses no Python
+ * objects, so it can be called without the GIL.
+ */
+static _ttinfo *
+find_utc_ttinfo(_zone_block *zone, int64_t timestamp, int year,
+                unsigned char *fold, int64_t *lo, int64_t *hi)
+{
+    size_t num_trans = zone->num_transitions;
+    _ttinfo *tti;
+    *fold = 0;
+
+    if (num_trans >= 1 && timestamp < zone->trans_list_utc[0]) {
+        tti = zone->ttinfo_before;
+        *hi = zone->trans_list_utc[0];
+    }
+    else if (num_trans == 0 ||
+             timestamp > zone->trans_list_utc[num_trans - 1]) {
+        if (num_trans) {
+            *lo = zone->trans_list_utc[num_trans - 1] + 1;
+        }
+        tti = find_tzrule_ttinfo_fromutc(&(zone->tzrule_after), timestamp,
+                                         year, fold, lo, hi);
+
+        // Immediately after the last manual transition, the fold/gap is
+        // between zone->trans_ttinfos[num_transitions - 1] and whatever
+        // ttinfo applies immediately after the last transition, not between
+        // the STD and DST rules in the tzrule_after, so we may need to
+        // adjust the fold value. Only the offset of the earlier ttinfo is
+        // needed, so this reads it from the zone data.
+        if (num_trans) {
+            const _zone_data *data = &(zone->zone_data);
+            size_t idx_prev;
+            if (num_trans == 1) {
+                idx_prev = data->ttinfo_before;
+            }
+            else {
+                idx_prev = data->trans_idx[num_trans - 2];
+            }
+            int64_t diff = data->utcoff[idx_prev] - tti->utcoff_seconds;
+            if (diff > 0) {
+                int64_t fold_end = zone->trans_list_utc[num_trans - 1] + diff;
+                if (timestamp < fold_end) {
+                    *fold = 1;
+                }
+                narrow_interval(timestamp, fold_end, lo, hi);
+            }
+        }
+    }
+    else {
+        size_t idx = bisect_transitions(zone, timestamp, zone->trans_list_utc,
+                                        zone->trans_search.utc);
+        _ttinfo *tti_prev = NULL;
+
+        if (idx >= 2) {
+            tti_prev = zone->trans_ttinfos[idx - 2];
+            tti = zone->trans_ttinfos[idx - 1];
+        }
+        else {
+            tti_prev = zone->ttinfo_before;
+            tti = zone->trans_ttinfos[0];
+        }
+
+        // Detect fold
+        int64_t shift =
+            (int64_t)(tti_prev->utcoff_seconds - tti->utcoff_seconds);
+        if (shift > (timestamp - zone->trans_list_utc[idx - 1])) {
+            *fold = 1;
+        }
+
+        *lo = zone->trans_list_utc[idx - 1];
+        *hi = idx < num_trans ? zone->trans_list_utc[idx]
+                              : zone->trans_list_utc[num_trans - 1] + 1;
+        if (shift > 0) {
+            narrow_interval(timestamp, *lo + shift, lo, hi);
+        }
+    }
+
+    return tti;
+}
+
+/* find_ttinfo_fromutc for zones with transitions. */
+static _ttinfo *
+find_transitions_ttinfo_fromutc(PyZoneInfo_ZoneInfo *self, PyObject *dt,
+                                unsigned char *fold)
+{
+    _zone_block *zone = self->zone;
+
+    int64_t timestamp;
+    int year;
+    if (get_local_timestamp(dt, &timestamp, &year)) {
+        return NULL;
+    }
+    size_t num_trans = zone->num_transitions;
+
+    _last_interval *last = &(self->last_utc);
+    _ttinfo *tti = find_last_interval(last, timestamp);
+    if (tti != NULL) {
+        *fold = last->fold;
+        return tti;
+    }
+
+    // Only the tables for the part of the zone that the timestamp falls in
+    // are built
+    if (timestamp > zone->trans_list_utc[num_trans - 1]) {
+        if (ensure_tzrule_after(zone)) {
+            return NULL;
+        }
+    }
+    else if (ensure_trans_search(zone) || ensure_ttinfos(zone)) {
+        return NULL;
+    }
+
+    int64_t lo = INT64_MIN;
+    int64_t hi = INT64_MAX;
+    tti = find_utc_ttinfo(zone, timestamp, year, fold, &lo, &hi);
+    set_last_interval(last, lo, hi, tti, *fold);
+    return tti;
+}
+
+static const _zone_lookup FIXED_OFFSET_LOOKUP = {
+    find_fixed_offset_ttinfo, find_fixed_offset_ttinfo_fromutc};
+static const _zone_lookup RULE_ONLY_LOOKUP = {find_rule_only_ttinfo,
+                                              find_rule_only_ttinfo_fromutc};
+static const _zone_lookup TRANSITIONS_LOOKUP = {
+    find_transitions_ttinfo, find_transitions_ttinfo_fromutc};
+
+/* Constants for the civil date functions below, which follow Neri and
+ * Schneider, "Euclidean affine functions and their application to calendar
+ * algorithms" (2022).
+ *
+ * The calculations are done in a calendar whose years start on March 1st,
+ * so that the leap day is the last day of the year, and which is shifted by
+ * CIVIL_SHIFT_CYCLES 400-year cycles so that every date a datetime can
+ * represent has a non-negative day and year number and all the arithmetic can
+ * be done on unsigned 32-bit integers. The remaining divisions are all by
+ * constants, which compilers turn into multiplications and shifts.
+ */
+#define CIVIL_SHIFT_CYCLES 82
+// The shift in years, and the day number of 1970-01-01 in the shifted calendar
+#define CIVIL_YEAR_SHIFT (400 * CIVIL_SHIFT_CYCLES)
+#define CIVIL_DAY_SHIFT (719468 + 146097 * CIVIL_SHIFT_CYCLES)
+
+static int
+is_leap_year(int year)
+{
+    // A multiple of 100 is a multiple of 400 if it is a multiple of 16, and
+    // a multiple of 4 is a multiple of 100 if it is a multiple of 25.
+    const unsigned int ayear = (unsigned int)year;
+    return (ayear & (ayear % 25 ? 3 : 15)) == 0;
+}
+
+/* Calculates the number of days from 1970-01-01 to a date. */
+static int32_t
+days_from_civil(int y, int m, int d)
+{
+    // January and February are the months 13 and 14 of the previous year
+    const uint32_t jan_feb = (uint32_t)m <= 2;
+    const uint32_t year = (uint32_t)(y + CIVIL_YEAR_SHIFT) - jan_feb;
+    const uint32_t month = (uint32_t)m + 12 * jan_feb;
+    const uint32_t century = year / 100;
+
+    const uint32_t year_days = 1461 * year / 4 - century + century / 4;
+    const uint32_t month_days = (979 * month - 2919) / 32;
+
+    return (int32_t)(year_days + month_days + (uint32_t)d - 1) -
+           CIVIL_DAY_SHIFT;
+}
+
+/* Calculates the date of a number of days from 1970-01-01, the inverse of
+ * days_from_civil.
+ */
+static void
+civil_from_days(int32_t days, int *y, int *m, int *d)
+{
+    const uint32_t n = (uint32_t)(days + CIVIL_DAY_SHIFT);
+
+    // The century and the day of the century
+    const uint32_t n_1 = 4 * n + 3;
+    const uint32_t century = n_1 / 146097;
+    const uint32_t n_c = n_1 % 146097 / 4;
+
+    // The year of the century and the day of the year
+    const uint32_t n_2 = 4 * n_c + 3;
+    const uint64_t p_2 = UINT64_C(2939745) * n_2;
+    const uint32_t z = (uint32_t)(p_2 >> 32);
+    const uint32_t n_y = (uint32_t)p_2 / 2939745 / 4;
+
+    // The month (from 3 to 14) and the day of the month
+    const uint32_t n_3 = 2141 * n_y + 197913;
+    const uint32_t month = n_3 >> 16;
+    const uint32_t day = (n_3 & 0xFFFF) / 2141;
+
+    // Days from January 1st on are in the next year of the usual calendar
+    const uint32_t jan_feb = n_y >= 306;
+    *y = (int)(100 * century + z + jan_feb) - CIVIL_YEAR_SHIFT;
+    *m = (int)(month - 12 * jan_feb);
+    *d = (int)day + 1;
+}
+
+/* Calculates ordinal datetime from year, month and day. */
+static int
+ymd_to_ord(int y, int m, int d)
+{
+    return days_from_civil(y, m, d) + EPOCHORDINAL;
+}
+
+/* Calculates the year, month and day of an ordinal, the inverse of
+ * ymd_to_ord.
+ */
+static void
+ord_to_ymd(int ord, int *y, int *m, int *d)
+{
+    assert(ord >= 1);
+
+    civil_from_days(ord - EPOCHORDINAL, y, m, d);
+}
+
+/* The straightforward implementations of is_leap_year, ymd_to_ord and
+ * ord_to_ymd, which _check_civil_dates compares them against.
+ */
+static int
+is_leap_year_reference(int year)
+{
+    const unsigned int ayear = (unsigned int)year;
+    return ayear % 4 == 0 && (ayear % 100 != 0 || ayear % 400 == 0);
+}
+
+static int
+ymd_to_ord_reference(int y, int m, int d)
+{
+    y -= 1;
+    int days_before_year = (y * 365) + (y / 4) - (y / 100) + (y / 400);
+    int yearday = DAYS_BEFORE_MONTH[m];
+    if (m > 2 && is_leap_year_reference(y + 1)) {
+        yearday += 1;
+    }
+
+    return days_before_year + yearday + d;
+}
+
+/* This follows ord_to_ymd in CPython's _datetimemodule.c. */
+static void
+ord_to_ymd_reference(int ord, int *y, int *m, int *d)
+{
+    assert(ord >= 1);
+
+    // The days in 100 years that do not end in a leap year, and in 4 years
+    const int days_in_100_years = 36524;
+    const int days_in_4_years = 1461;
+
+    int n = ord - 1;
+    int n400 = n / (int)DAYS_IN_400_YEARS;
+    n %= (int)DAYS_IN_400_YEARS;
+    int n100 = n / days_in_100_years;
+    n %= days_in_100_years;
+    int n4 = n / days_in_4_years;
+    n %= days_in_4_years;
+    int n1 = n / 365;
+    n %= 365;
+
+    *y = n400 * 400 + n100 * 100 + n4 * 4 + n1 + 1;
+
+    // The last day of a leap year (of the 4- or 400-year cycle)
+    if (n1 == 4 || n100 == 4) {
+        *y -= 1;
+        *m = 12;
+        *d = 31;
+        return;
+    }
+
+    // n is now the 0-based day of the year. Estimate the month, which may be
+    // one too large.
+    int leap = n1 == 3 && (n4 != 24 || n100 == 3);
+    *m = (n + 50) >> 5;
+    int preceding = DAYS_BEFORE_MONTH[*m] + (*m > 2 && leap);
+    if (preceding > n) {
+        *m -= 1;
+        preceding = DAYS_BEFORE_MONTH[*m] + (*m > 2 && leap);
+    }
+
+    *d = n - preceding + 1;
+}
+
+/* Compares is_leap_year, ymd_to_ord and ord_to_ymd with their reference
+ * implementations for every date from 0001-01-01 to 9999-12-31, raising
+ * AssertionError at the first difference.
+ */
+static PyObject *
+zoneinfo_check_civil_dates(PyObject *module, PyObject *unused)
+{
+    for (int year = 1; year <= 9999; ++year) {
+        if (is_leap_year(year) != is_leap_year_reference(year)) {
+            PyErr_Format(PyExc_AssertionError,
+                         "is_leap_year(%d) does not match the reference",
+                         year);
+            return NULL;
+        }
+    }
+
+    for (int ord = 1; ord <= MAX_ORDINAL; ++ord) {
+        int y, m, d;
+        int ref_y, ref_m, ref_d;
+        ord_to_ymd(ord, &y, &m, &d);
+        ord_to_ymd_reference(ord, &ref_y, &ref_m, &ref_d);
+        if (y != ref_y || m != ref_m || d != ref_d) {
+            PyErr_Format(PyExc_AssertionError,
+                         "ord_to_ymd(%d) is %04d-%02d-%02d, not "
+                         "%04d-%02d-%02d",
+                         ord, y, m, d, ref_y, ref_m, ref_d);
+            return NULL;
+        }
+
+        int ref_ord = ymd_to_ord_reference(y, m, d);
+        if (ymd_to_ord(y, m, d) != ord || ref_ord != ord) {
+            PyErr_Format(PyExc_AssertionError,
+                         "ymd_to_ord(%d, %d, %d) is %d (reference %d), not "
+                         "%d",
+                         y, m, d, ymd_to_ord(y, m, d), ref_ord, ord);
+            return NULL;
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+/* Returns 1 if the fields of instances of a datetime subclass must be read
+ * through its attributes, 0 if they can be read from the underlying datetime
+ * struct and -1 on error.
+ *
+ * Subclasses that override toordinal() or the hour, minute or second
+ * attributes opt in to having them used by setting the class attribute
+ * __zoneinfo_use_attributes__ to a true value.
+ */
+static int
+uses_datetime_attributes(PyTypeObject *type)
+{
+    // _PyType_Lookup goes through the type attribute cache, so this is much
+    // cheaper than getattr() when (as usual) the attribute is not set.
+    PyObject *flag = _PyType_Lookup(type, USE_ATTRIBUTES_STR);
+    if (flag == NULL) {
+        return 0;
+    }
+
+    return PyObject_IsTrue(flag);
+}
+
+/* Returns 1 if the fields of `dt` must be read through its attributes, 0 if
+ * they can be read from the underlying datetime struct and -1 on error.
+ *
+ * The fields of datetimes (and subclasses that do not opt out, see
+ * uses_datetime_attributes) are read directly, anything else must provide
+ * toordinal() and the hour, minute and second attributes. Every field that
+ * a lookup uses must be read from the same source, or the timestamp, year
+ * and fold would describe different times.
+ */
+static int
+reads_datetime_attributes(PyObject *dt)
+{
+    if (PyDateTime_CheckExact(dt)) {
+        return 0;
+    }
+    else if (PyDateTime_Check(dt)) {
+        return uses_datetime_attributes(Py_TYPE(dt));
+    }
+
+    return 1;
+}
+
+/* Gets the fold of a datetime (or an object with the attributes of one),
+ * from the same source as get_local_timestamp. Objects without a fold
+ * attribute are treated as having fold=0.
+ */
+static int
+get_fold(PyObject *dt, unsigned char *fold)
+{
+    int use_attributes = reads_datetime_attributes(dt);
+    if (use_attributes < 0) {
+        return -1;
+    }
+    else if (!use_attributes) {
+        *fold = PyDateTime_DATE_GET_FOLD(dt);
+        return 0;
+    }
+
+    PyObject *num = PyObject_GetAttrString(dt, "fold");
+    if (num == NULL) {
+        if (!PyErr_ExceptionMatches(PyExc_AttributeError)) {
+            return -1;
+        }
+        PyErr_Clear();
+        *fold = 0;
+        return 0;
+    }
+
+    int rv = PyObject_IsTrue(num);
+    Py_DECREF(num);
+    if (rv < 0) {
+        return -1;
+    }
+    *fold = (unsigned char)rv;
+    return 0;
+}
+
+/* Calculate the number of seconds since 1970-01-01 in local time, and the
+ * year that it falls in.
+ *
+ * This gets a datetime in the same "units" as zone->trans_list_wall so that we
+ * can easily determine which transitions a datetime falls between. See the
+ * comment above ts_to_local for more information.
+ *
+ * The fields are read as described in reads_datetime_attributes. When they
+ * are read through the attributes, the year is calculated from the
+ * timestamp rather than read separately, so that the two always agree.
+ * */
+static int
+get_local_timestamp(PyObject *dt, int64_t *local_ts, int *year)
+{
+    assert(local_ts != NULL);
+
+    int hour, minute, second;
+    int32_t days;
+    int use_attributes = reads_datetime_attributes(dt);
+    if (use_attributes < 0) {
+        return -1;
+    }
+
+    if (!use_attributes) {
+        int y = PyDateTime_GET_YEAR(dt);
+        int m = PyDateTime_GET_MONTH(dt);
+        int d = PyDateTime_GET_DAY(dt);
+        hour = PyDateTime_DATE_GET_HOUR(dt);
+        minute = PyDateTime_DATE_GET_MINUTE(dt);
+        second = PyDateTime_DATE_GET_SECOND(dt);
+
+        days = days_from_civil(y, m, d);
+        *year = y;
+    }
+    else {
+        PyObject *num = PyObject_CallMethod(dt, "toordinal", NULL);
+        if (num == NULL) {
+            return -1;
+        }
+
+        long ord = PyLong_AsLong(num);
+        Py_DECREF(num);
+        if (ord == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+        days = (int32_t)(ord - EPOCHORDINAL);
+
+        num = PyObject_GetAttrString(dt, "hour");
+        if (num == NULL) {
+            return -1;
+        }
+        hour = PyLong_AsLong(num);
+        Py_DECREF(num);
+        if (hour == -1) {
+            return -1;
+        }
+
+        num = PyObject_GetAttrString(dt, "minute");
+        if (num == NULL) {
+            return -1;
+        }
+        minute = PyLong_AsLong(num);
+        Py_DECREF(num);
+        if (minute == -1) {
+            return -1;
+        }
+
+        num = PyObject_GetAttrString(dt, "second");
+        if (num == NULL) {
+            return -1;
+        }
+        second = PyLong_AsLong(num);
+        Py_DECREF(num);
+        if (second == -1) {
+            return -1;
+        }
+    }
+
+    *local_ts = (int64_t)days * 86400 +
+                (int64_t)(hour * 3600 + minute * 60 + second);
+    if (use_attributes) {
+        *year = timestamp_year(*local_ts);
+    }
+
+    return 0;
+}
+
+/////
+// Functions for TZPATH handling
+
+#ifdef NATIVE_TZPATH
+/* Validates a key, following _tzpath._validate_tzfile_path.
+ *
+ * `path` is the key encoded with the filesystem encoding. With POSIX path
+ * semantics, a key is valid if it is a relative path that os.path.normpath
+ * leaves unchanged and that does not start with "..". This returns 0 if the
+ * key is valid and -1 (with a ValueError set) if it is not.
+ */
+static int
+validate_tzfile_path(PyObject *key, const char *path, size_t len)
+{
+    if (len && path[0] == '/') {
+        PyErr_Format(PyExc_ValueError,
+                     "ZoneInfo keys may not be absolute paths, got: %U", key);
+        return -1;
+    }
+
+    // normpath turns "" into "." and leaves "." alone; otherwise, it removes
+    // empty and "." components and ".." components that follow any other
+    // component.
+    int normalized = len > 0;
+    int is_dot = len == 1 && path[0] == '.';
+    int escapes = is_dot;
+    int leading = 1;  // Whether all the components so far were ".."
+    for (size_t start = 0; normalized && !is_dot && start <= len;) {
+        const char *sep = memchr(path + start, '/', len - start);
+        size_t end = sep == NULL ? len : (size_t)(sep - path);
+        size_t comp_len = end - start;
+
+        if (comp_len == 0 || (comp_len == 1 && path[start] == '.')) {
+            normalized = 0;
+        }
+        else if (comp_len == 2 && !memcmp(path + start, "..", 2)) {
+            normalized = leading;
+            escapes = leading;
+        }
+        else {
+            leading = 0;
+        }
+
+        start = end + 1;
+    }
+
+    if (!normalized) {
+        PyErr_Format(PyExc_ValueError,
+                     "ZoneInfo keys must be normalized relative paths, got: "
+                     "%U",
+                     key);
+        return -1;
+    }
+    else if (escapes) {
+        PyErr_Format(PyExc_ValueError,
+                     "ZoneInfo keys must refer to subdirectories of TZPATH, "
+                     "got: %U",
+                     key);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Joins a TZPATH entry and the first `len` bytes of a key, like
+ * os.path.join. */
+static PyObject *
+join_tzpath(PyObject *root, const char *key, size_t len)
+{
+    const char *root_str = PyBytes_AS_STRING(root);
+    size_t root_len = (size_t)PyBytes_GET_SIZE(root);
+    size_t sep_len = root_len && root_str[root_len - 1] != '/';
+
+    PyObject *path =
+        PyBytes_FromStringAndSize(NULL, root_len + sep_len + len);
+    if (path == NULL) {
+        return NULL;
+    }
+
+    char *p = PyBytes_AS_STRING(path);
+    memcpy(p, root_str, root_len);
+    if (sep_len) {
+        p[root_len] = '/';
+    }
+    memcpy(p + root_len + sep_len, key, len);
+    return path;
+}
+
+/* Returns whether `path` (a bytes object) is a regular file, following
+ * symlinks, like os.path.isfile. */
+static int
+is_tzfile(PyObject *path)
+{
+    struct stat st;
+    int rv;
+
+    Py_BEGIN_ALLOW_THREADS;
+    rv = !stat(PyBytes_AS_STRING(path), &st) && S_ISREG(st.st_mode);
+    Py_END_ALLOW_THREADS;
+
+    return rv;
+}
+
+/* Lists a directory on the TZPATH.
+ *
+ * Returns a dict mapping the name of each entry to True if it is a regular
+ * file, False if it is a directory and None if that is not known yet (i.e.
+ * it is a symlink, or the file system does not report entry types). If the
+ * directory can't be read, the dict is empty.
+ */
+static PyObject *
+list_tzpath_dir(PyObject *dir_path)
+{
+    PyObject *entries = PyDict_New();
+    if (entries == NULL) {
+        return NULL;
+    }
+
+    DIR *dir;
+    Py_BEGIN_ALLOW_THREADS;
+    dir = opendir(PyBytes_AS_STRING(dir_path));
+    Py_END_ALLOW_THREADS;
+    if (dir == NULL) {
+        return entries;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, "..")) {
+            continue;
+        }
+
+        PyObject *is_file = Py_None;
+#ifdef DT_UNKNOWN
+        if (entry->d_type == DT_REG) {
+            is_file = Py_True;
+        }
+        else if (entry->d_type == DT_DIR) {
+            is_file = Py_False;
         }
+#endif
 
-        if (dayrule_new(julian, day, hour, minute, second, rv)) {
-            PyMem_Free(rv);
-            return -1;
+        PyObject *name_obj = PyBytes_FromString(name);
+        if (name_obj == NULL ||
+            PyDict_SetItem(entries, name_obj, is_file) < 0) {
+            Py_XDECREF(name_obj);
+            Py_CLEAR(entries);
+            break;
         }
-        *out = (TransitionRuleType *)rv;
+        Py_DECREF(name_obj);
     }
 
-    return ptr - p;
+    closedir(dir);
+    return entries;
 }
 
-/* Parse the time portion of a transition rule (e.g. following an /) */
-static Py_ssize_t
-parse_transition_time(const char *const p, int8_t *hour, int8_t *minute,
-                      int8_t *second)
+/* Looks up a file in the TZPATH_INDEX listing of its directory.
+ *
+ * Returns 1 if the file is a regular file, 0 if it isn't (or isn't listed)
+ * and -1 on error.
+ */
+static int
+find_indexed_tzfile(PyObject *dir_path, PyObject *name, PyObject *path)
 {
-    // From the spec:
-    //
-    //   The time has the same format as offset except that no leading sign
-    //   ( '-' or '+' ) is allowed.
-    //
-    // The format for the offset is:
-    //
-    //   h[h][:mm[:ss]]
-    //
-    // RFC 8536 also allows transition times to be signed and to range from
-    // -167 to +167, but the current version only supports [0, 99].
-    //
-    // TODO: Support the full range of transition hours.
-    int8_t *components[3] = {hour, minute, second};
-    const char *ptr = p;
-    int8_t sign = 1;
-
-    if (*ptr == '-' || *ptr == '+') {
-        if (*ptr == '-') {
-            sign = -1;
-        }
-        ptr++;
+    PyObject *entries = PyDict_GetItemWithError(TZPATH_INDEX, dir_path);
+    if (entries != NULL) {
+        Py_INCREF(entries);
     }
-
-    for (size_t i = 0; i < 3; ++i) {
-        if (i > 0) {
-            if (*ptr != ':') {
-                break;
-            }
-            ptr++;
+    else if (PyErr_Occurred()) {
+        return -1;
+    }
+    else {
+        entries = list_tzpath_dir(dir_path);
+        if (entries == NULL ||
+            PyDict_SetItem(TZPATH_INDEX, dir_path, entries) < 0) {
+            Py_XDECREF(entries);
+            return -1;
         }
+    }
 
-        uint8_t buff = 0;
-        for (size_t j = 0; j < 2; j++) {
-            if (!isdigit(*ptr)) {
-                if (i == 0 && j > 0) {
-                    break;
-                }
-                return -1;
-            }
-
-            buff *= 10;
-            buff += (*ptr) - '0';
-            ptr++;
+    int rv = 0;
+    PyObject *is_file = PyDict_GetItemWithError(entries, name);
+    if (is_file == Py_None) {
+        // Resolve (and remember) the type of a symlink or unknown entry
+        rv = is_tzfile(path);
+        if (PyDict_SetItem(entries, name, rv ? Py_True : Py_False) < 0) {
+            rv = -1;
         }
-
-        *(components[i]) = sign * buff;
+    }
+    else if (is_file != NULL) {
+        rv = is_file == Py_True;
+    }
+    else if (PyErr_Occurred()) {
+        rv = -1;
     }
 
-    return ptr - p;
+    Py_DECREF(entries);
+    return rv;
 }
 
-/* Constructor for a _tzrule.
+/* Retrieves the path to a TZif file from a key, like _tzpath.find_tzfile.
  *
- * If `dst_abbr` is NULL, this will construct an "STD-only" _tzrule, in which
- * case `dst_offset` will be ignored and `start` and `end` are expected to be
- * NULL as well.
+ * The first time a directory on the TZPATH is searched, it is listed (see
+ * list_tzpath_dir), so finding a file that exists costs a dictionary lookup
+ * rather than a stat() call. Keys that are not found in the listing of a
+ * TZPATH entry are checked with stat() before the next entry is searched,
+ * like the pure Python implementation does, so that files added since a
+ * directory was listed (or that match a key case-insensitively) are found
+ * in the right entry. Files removed since then are handled by the callers,
+ * which discard the listings (see forget_tzpath_dirs) and search again if
+ * a file that was found does not exist. The listings are also discarded
+ * when the TZPATH is reset.
  *
- * Returns 0 on success.
+ * Keys and TZPATH entries that are not plain strings, or that can't be
+ * encoded, are handed off to _tzpath.find_tzfile.
+ *
+ * Returns a new reference to the path (a str), None if the file was not
+ * found, or NULL on error.
  */
-static int
-build_tzrule(PyObject *std_abbr, PyObject *dst_abbr, long std_offset,
-             long dst_offset, TransitionRuleType *start,
-             TransitionRuleType *end, _tzrule *out)
+static PyObject *
+find_tzfile(PyObject *key)
 {
-    _tzrule rv = {{0}};
+    PyObject *roots = TZPATH_ROOTS;
+    PyObject *key_bytes = NULL;
+    PyObject *name = NULL;
+    PyObject *path = NULL;
 
-    rv.start = start;
-    rv.end = end;
+    if (roots == NULL || roots == Py_None || !PyUnicode_CheckExact(key)) {
+        return PyObject_CallFunctionObjArgs(_tzpath_find_tzfile, key, NULL);
+    }
 
-    if (build_ttinfo(std_offset, 0, std_abbr, &rv.std)) {
+    key_bytes = PyUnicode_EncodeFSDefault(key);
+    if (key_bytes == NULL ||
+        strlen(PyBytes_AS_STRING(key_bytes)) !=
+            (size_t)PyBytes_GET_SIZE(key_bytes)) {
+        PyErr_Clear();
+        Py_XDECREF(key_bytes);
+        return PyObject_CallFunctionObjArgs(_tzpath_find_tzfile, key, NULL);
+    }
+
+    const char *key_str = PyBytes_AS_STRING(key_bytes);
+    size_t key_len = (size_t)PyBytes_GET_SIZE(key_bytes);
+    if (validate_tzfile_path(key, key_str, key_len)) {
+        Py_DECREF(key_bytes);
+        return NULL;
+    }
+
+    // The callback may replace TZPATH_ROOTS while the GIL is released
+    Py_INCREF(roots);
+
+    const char *sep = strrchr(key_str, '/');
+    size_t dir_len = sep == NULL ? 0 : (size_t)(sep - key_str);
+    name = PyBytes_FromString(sep == NULL ? key_str : sep + 1);
+    if (name == NULL) {
         goto error;
     }
 
-    if (dst_abbr != NULL) {
-        rv.dst_diff = dst_offset - std_offset;
-        if (build_ttinfo(dst_offset, rv.dst_diff, dst_abbr, &rv.dst)) {
+    Py_ssize_t num_roots = PyTuple_GET_SIZE(roots);
+    for (Py_ssize_t i = 0; i < num_roots; ++i) {
+        PyObject *root = PyTuple_GET_ITEM(roots, i);
+        path = join_tzpath(root, key_str, key_len);
+        PyObject *dir_path = join_tzpath(root, key_str, dir_len);
+        if (path == NULL || dir_path == NULL) {
+            Py_XDECREF(dir_path);
             goto error;
         }
-    }
-    else {
-        rv.std_only = 1;
-    }
 
-    *out = rv;
+        int found = find_indexed_tzfile(dir_path, name, path);
+        Py_DECREF(dir_path);
+        if (!found) {
+            found = is_tzfile(path);
+        }
 
-    return 0;
+        if (found < 0) {
+            goto error;
+        }
+        else if (found) {
+            PyObject *out = PyUnicode_DecodeFSDefaultAndSize(
+                PyBytes_AS_STRING(path), PyBytes_GET_SIZE(path));
+            Py_DECREF(path);
+            Py_DECREF(name);
+            Py_DECREF(roots);
+            Py_DECREF(key_bytes);
+            return out;
+        }
+        Py_CLEAR(path);
+    }
+
+    Py_DECREF(name);
+    Py_DECREF(roots);
+    Py_DECREF(key_bytes);
+    Py_RETURN_NONE;
 error:
-    xdecref_ttinfo(&rv.std);
-    xdecref_ttinfo(&rv.dst);
-    return -1;
+    Py_XDECREF(path);
+    Py_XDECREF(name);
+    Py_DECREF(roots);
+    Py_DECREF(key_bytes);
+    return NULL;
 }
 
-/* Destructor for _tzrule. */
-static void
-free_tzrule(_tzrule *tzrule)
+/* Discards the TZPATH_INDEX listings of the directory that `key` is in, in
+ * every TZPATH entry, so that they are read again the next time that they
+ * are searched.
+ *
+ * Returns the number of listings discarded, or -1 on error.
+ */
+static int
+forget_tzpath_dirs(PyObject *key)
 {
-    xdecref_ttinfo(&(tzrule->std));
-    if (!tzrule->std_only) {
-        xdecref_ttinfo(&(tzrule->dst));
+    PyObject *roots = TZPATH_ROOTS;
+    if (TZPATH_INDEX == NULL || roots == NULL || roots == Py_None ||
+        !PyUnicode_CheckExact(key)) {
+        // find_tzfile leaves these keys to _tzpath.find_tzfile
+        return 0;
     }
 
-    if (tzrule->start != NULL) {
-        PyMem_Free(tzrule->start);
+    PyObject *key_bytes = PyUnicode_EncodeFSDefault(key);
+    if (key_bytes == NULL) {
+        PyErr_Clear();
+        return 0;
     }
 
-    if (tzrule->end != NULL) {
-        PyMem_Free(tzrule->end);
+    const char *key_str = PyBytes_AS_STRING(key_bytes);
+    const char *sep = strrchr(key_str, '/');
+    size_t dir_len = sep == NULL ? 0 : (size_t)(sep - key_str);
+
+    int forgotten = 0;
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(roots); ++i) {
+        PyObject *dir_path =
+            join_tzpath(PyTuple_GET_ITEM(roots, i), key_str, dir_len);
+        if (dir_path == NULL) {
+            forgotten = -1;
+            break;
+        }
+
+        int listed = PyDict_Contains(TZPATH_INDEX, dir_path);
+        if (listed > 0) {
+            listed = PyDict_DelItem(TZPATH_INDEX, dir_path) ? -1 : 1;
+        }
+        Py_DECREF(dir_path);
+        if (listed < 0) {
+            forgotten = -1;
+            break;
+        }
+        forgotten += listed;
     }
+
+    Py_DECREF(key_bytes);
+    return forgotten;
 }
 
-/* Calculate DST offsets from transitions and UTC offsets
- *
- * This is necessary because each C `ttinfo` only contains the UTC offset,
- * time zone abbreviation and an isdst boolean - it does not include the
- * amount of the DST offset, but we need the amount for the dst() function.
- *
- * Thus function uses heuristics to infer what the offset should be, so it
- * is not guaranteed that this will work for all zones. If we cannot assign
- * a value for a given DST offset, we'll assume it's 1H rather than 0H, so
- * bool(dt.dst()) will always match ttinfo.isdst.
+/* Discards the TZPATH_INDEX listings of the directories of some keys, whose
+ * files have changed. Called by the TZPATH watcher (see _watch.py).
  */
-static void
-utcoff_to_dstoff(size_t *trans_idx, long *utcoffs, long *dstoffs,
-                 unsigned char *isdsts, size_t num_transitions,
-                 size_t num_ttinfos)
+static PyObject *
+zoneinfo__forget_tzpath_dirs(PyObject *module, PyObject *keys)
 {
-    size_t dst_count = 0;
-    size_t dst_found = 0;
-    for (size_t i = 0; i < num_ttinfos; ++i) {
-        dst_count++;
+    PyObject *iter = PyObject_GetIter(keys);
+    if (iter == NULL) {
+        return NULL;
     }
 
-    for (size_t i = 1; i < num_transitions; ++i) {
-        if (dst_count == dst_found) {
+    PyObject *key;
+    while ((key = PyIter_Next(iter))) {
+        int rv = forget_tzpath_dirs(key);
+        Py_DECREF(key);
+        if (rv < 0) {
             break;
         }
+    }
+    Py_DECREF(iter);
 
-        size_t idx = trans_idx[i];
-        size_t comp_idx = trans_idx[i - 1];
-
-        // Only look at DST offsets that have nto been assigned already
-        if (!isdsts[idx] || dstoffs[idx] != 0) {
-            continue;
-        }
-
-        long dstoff = 0;
-        long utcoff = utcoffs[idx];
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
 
-        if (!isdsts[comp_idx]) {
-            dstoff = utcoff - utcoffs[comp_idx];
-        }
+    Py_RETURN_NONE;
+}
 
-        if (!dstoff && idx < (num_ttinfos - 1)) {
-            comp_idx = trans_idx[i + 1];
+/* Sets TZPATH_ROOTS from a new TZPATH and discards the TZPATH_INDEX. */
+static int
+set_tzpath(PyObject *tzpath)
+{
+    PyObject *entries = PySequence_Fast(tzpath, "TZPATH must be a sequence");
+    if (entries == NULL) {
+        return -1;
+    }
 
-            // If the following transition is also DST and we couldn't find
-            // the DST offset by this point, we're going to have to skip it
-            // and hope this transition gets assigned later
-            if (isdsts[comp_idx]) {
-                continue;
-            }
+    Py_ssize_t num_entries = PySequence_Fast_GET_SIZE(entries);
+    PyObject *roots = PyTuple_New(num_entries);
+    if (roots == NULL) {
+        Py_DECREF(entries);
+        return -1;
+    }
 
-            dstoff = utcoff - utcoffs[comp_idx];
+    for (Py_ssize_t i = 0; i < num_entries; ++i) {
+        PyObject *entry = PySequence_Fast_GET_ITEM(entries, i);
+        PyObject *root = NULL;
+        if (PyUnicode_CheckExact(entry)) {
+            root = PyUnicode_EncodeFSDefault(entry);
         }
 
-        if (dstoff) {
-            dst_found++;
-            dstoffs[idx] = dstoff;
+        if (root == NULL || strlen(PyBytes_AS_STRING(root)) !=
+                                (size_t)PyBytes_GET_SIZE(root)) {
+            // Leave anything unusual to _tzpath.find_tzfile
+            PyErr_Clear();
+            Py_XDECREF(root);
+            Py_DECREF(roots);
+            roots = Py_None;
+            Py_INCREF(roots);
+            break;
         }
+
+        PyTuple_SET_ITEM(roots, i, root);
     }
+    Py_DECREF(entries);
 
-    if (dst_found < dst_count) {
-        // If there are time zones we didn't find a value for, we'll end up
-        // with dstoff = 0 for something where isdst=1. This is obviously
-        // wrong — one hour will be a much better guess than 0.
-        for (size_t idx = 0; idx < num_ttinfos; ++idx) {
-            if (isdsts[idx] && !dstoffs[idx]) {
-                dstoffs[idx] = 3600;
-            }
-        }
+    Py_XSETREF(TZPATH_ROOTS, roots);
+    if (TZPATH_INDEX != NULL) {
+        PyDict_Clear(TZPATH_INDEX);
     }
+
+    return 0;
 }
 
-#define _swap(x, y, buffer) \
-    buffer = x;             \
-    x = y;                  \
-    y = buffer;
+/* Called by _tzpath.reset_tzpath with the new TZPATH. */
+static PyObject *
+tzpath_callback(PyObject *unused, PyObject *tzpath)
+{
+    if (TZPATH_INDEX != NULL && set_tzpath(tzpath)) {
+        return NULL;
+    }
 
-/* Calculate transitions in local time from UTC time and offsets.
- *
- * We want to know when each transition occurs, denominated in the number of
- * nominal wall-time seconds between 1970-01-01T00:00:00 and the transition in
- * *local time* (note: this is *not* equivalent to the output of
- * datetime.timestamp, which is the total number of seconds actual elapsed
- * since 1970-01-01T00:00:00Z in UTC).
- *
- * This is an ambiguous question because "local time" can be ambiguous — but it
- * is disambiguated by the `fold` parameter, so we allocate two arrays:
- *
- *  trans_local[0]: The wall-time transitions for fold=0
- *  trans_local[1]: The wall-time transitions for fold=1
- *
- * This returns 0 on success and a negative number of failure. The trans_local
- * arrays must be freed if they are not NULL.
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef tzpath_callback_def = {
+    "_czoneinfo_tzpath_callback", (PyCFunction)tzpath_callback, METH_O,
+    PyDoc_STR("Update the C TZPATH index after reset_tzpath().")};
+
+/* Reads the current TZPATH and registers tzpath_callback with reset_tzpath.
  */
 static int
-ts_to_local(size_t *trans_idx, int64_t *trans_utc, long *utcoff,
-            int64_t *trans_local[2], size_t num_ttinfos,
-            size_t num_transitions)
+initialize_tzpath(PyObject *tzpath_module)
 {
-    if (num_transitions == 0) {
-        return 0;
+    if (TZPATH_INDEX == NULL) {
+        TZPATH_INDEX = PyDict_New();
+    }
+    else {
+        Py_INCREF(TZPATH_INDEX);
     }
 
-    // Copy the UTC transitions into each array to be modified in place later
-    for (size_t i = 0; i < 2; ++i) {
-        trans_local[i] = PyMem_Malloc(num_transitions * sizeof(int64_t));
-        if (trans_local[i] == NULL) {
+    if (TZPATH_INDEX == NULL) {
+        return -1;
+    }
+
+    PyObject *tzpath = PyObject_GetAttrString(tzpath_module, "TZPATH");
+    if (tzpath == NULL) {
+        return -1;
+    }
+    int rv = set_tzpath(tzpath);
+    Py_DECREF(tzpath);
+    if (rv) {
+        return -1;
+    }
+
+    if (TZPATH_CALLBACK == NULL) {
+        TZPATH_CALLBACK = PyCFunction_New(&tzpath_callback_def, NULL);
+        if (TZPATH_CALLBACK == NULL) {
             return -1;
         }
+    }
+
+    // If the module is executed again with a fresh copy of _tzpath (which
+    // also replaces _tzpath_find_tzfile), only the new copy should update
+    // the TZPATH we search.
+    PyObject *callbacks =
+        PyObject_GetAttrString(tzpath_module, "TZPATH_CALLBACKS");
+    if (callbacks == NULL) {
+        return -1;
+    }
+    else if (callbacks == TZPATH_CALLBACK_LIST) {
+        Py_DECREF(callbacks);
+        return 0;
+    }
+
+    if (PyList_Append(callbacks, TZPATH_CALLBACK) < 0) {
+        Py_DECREF(callbacks);
+        return -1;
+    }
 
-        memcpy(trans_local[i], trans_utc, num_transitions * sizeof(int64_t));
+    if (TZPATH_CALLBACK_LIST != NULL) {
+        PyObject *tmp = PyObject_CallMethod(TZPATH_CALLBACK_LIST, "remove",
+                                            "O", TZPATH_CALLBACK);
+        Py_XDECREF(tmp);
+        PyErr_Clear();
     }
+    Py_XSETREF(TZPATH_CALLBACK_LIST, callbacks);
 
-    int64_t offset_0, offset_1, buff;
-    if (num_ttinfos > 1) {
-        offset_0 = utcoff[0];
-        offset_1 = utcoff[trans_idx[0]];
+    return 0;
+}
 
-        if (offset_1 > offset_0) {
-            _swap(offset_0, offset_1, buff);
-        }
+/* Releases the TZPATH index.
+ *
+ * The callback stays registered (reset_tzpath holds a reference to it), but
+ * it does nothing once the last module instance has been freed.
+ */
+static void
+free_tzpath(void)
+{
+    if (TZPATH_INDEX != NULL && Py_REFCNT(TZPATH_INDEX) > 1) {
+        Py_DECREF(TZPATH_INDEX);
     }
     else {
-        offset_0 = utcoff[0];
-        offset_1 = utcoff[0];
+        Py_CLEAR(TZPATH_INDEX);
+        Py_CLEAR(TZPATH_ROOTS);
     }
+}
 
-    trans_local[0][0] += offset_0;
-    trans_local[1][0] += offset_1;
-
-    for (size_t i = 1; i < num_transitions; ++i) {
-        offset_0 = utcoff[trans_idx[i - 1]];
-        offset_1 = utcoff[trans_idx[i]];
+// A growable list of paths (with a value for each), allocated with
+// PyMem_RawMalloc so that it can be used without the GIL.
+typedef struct {
+    char **paths;
+    int64_t *values;
+    size_t len;
+    size_t capacity;
+} _path_list;
 
-        if (offset_1 > offset_0) {
-            _swap(offset_1, offset_0, buff);
+/* Appends a path to a _path_list, which takes ownership of it.
+ *
+ * On failure, `path` is freed and -1 is returned.
+ */
+static int
+path_list_append(_path_list *list, char *path, int64_t value)
+{
+    if (list->len == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        char **paths =
+            PyMem_RawRealloc(list->paths, capacity * sizeof(char *));
+        if (paths != NULL) {
+            list->paths = paths;
+        }
+        int64_t *values =
+            PyMem_RawRealloc(list->values, capacity * sizeof(int64_t));
+        if (values != NULL) {
+            list->values = values;
         }
 
-        trans_local[0][i] += offset_0;
-        trans_local[1][i] += offset_1;
+        if (paths == NULL || values == NULL) {
+            PyMem_RawFree(path);
+            return -1;
+        }
+        list->capacity = capacity;
     }
 
+    list->paths[list->len] = path;
+    list->values[list->len] = value;
+    list->len++;
     return 0;
 }
 
-/* Simple bisect_right binary search implementation */
-static size_t
-_bisect(const int64_t value, const int64_t *arr, size_t size)
+static void
+path_list_free(_path_list *list)
 {
-    size_t lo = 0;
-    size_t hi = size;
-    size_t m;
-
-    while (lo < hi) {
-        m = (lo + hi) / 2;
-        if (arr[m] > value) {
-            hi = m;
-        }
-        else {
-            lo = m + 1;
-        }
+    for (size_t i = 0; i < list->len; ++i) {
+        PyMem_RawFree(list->paths[i]);
     }
+    PyMem_RawFree(list->paths);
+    PyMem_RawFree(list->values);
+    memset(list, 0, sizeof(_path_list));
+}
 
-    return hi;
+/* Returns the modification time of a file, matching os.stat().st_mtime_ns */
+static int64_t
+stat_mtime_ns(const struct stat *st)
+{
+    int64_t nsec = 0;
+#if defined(HAVE_STAT_TV_NSEC)
+    nsec = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STAT_TV_NSEC2)
+    nsec = st->st_mtimespec.tv_nsec;
+#endif
+    return (int64_t)st->st_mtime * 1000000000 + nsec;
 }
 
-/* Find the ttinfo rules that apply at a given local datetime. */
-static _ttinfo *
-find_ttinfo(PyZoneInfo_ZoneInfo *self, PyObject *dt)
+/* Collects the files under a TZPATH directory, like the os.walk call in
+ * _tzpath.available_timezones: symlinks to directories are not followed,
+ * and the right/ and posix/ directories at the top level are skipped.
+ *
+ * Each directory that is walked is added to `dirs` with its modification
+ * time, and each file to `files`. Directories that can't be read are
+ * ignored, as os.walk does. This does not use the Python API, and returns
+ * -1 only if it runs out of memory.
+ */
+static int
+walk_tzpath_dir(const char *dir_path, int top, _path_list *dirs,
+                _path_list *files)
 {
-    // datetime.time has a .tzinfo attribute that passes None as the dt
-    // argument; it only really has meaning for fixed-offset zones.
-    if (dt == Py_None) {
-        if (self->fixed_offset) {
-            return &(self->tzrule_after.std);
-        }
-        else {
-            return &NO_TTINFO;
-        }
+    DIR *dir = opendir(dir_path);
+    struct stat st;
+    if (dir == NULL) {
+        return 0;
     }
 
-    int64_t ts;
-    if (get_local_timestamp(dt, &ts)) {
-        return NULL;
+    char *dir_copy = NULL;
+    if (fstat(dirfd(dir), &st) ||
+        (dir_copy = PyMem_RawMalloc(strlen(dir_path) + 1)) == NULL) {
+        closedir(dir);
+        return dir_copy == NULL ? -1 : 0;
+    }
+    strcpy(dir_copy, dir_path);
+    if (path_list_append(dirs, dir_copy, stat_mtime_ns(&st))) {
+        closedir(dir);
+        return -1;
     }
 
-    unsigned char fold = PyDateTime_DATE_GET_FOLD(dt);
-    assert(fold < 2);
-    int64_t *local_transitions = self->trans_list_wall[fold];
-    size_t num_trans = self->num_transitions;
+    int rv = 0;
+    size_t dir_len = strlen(dir_path);
+    size_t sep_len = dir_len && dir_path[dir_len - 1] != '/';
+    struct dirent *entry;
+    while (rv == 0 && (entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, "..")) {
+            continue;
+        }
 
-    if (num_trans && ts < local_transitions[0]) {
-        return self->ttinfo_before;
-    }
-    else if (!num_trans || ts > local_transitions[self->num_transitions - 1]) {
-        return find_tzrule_ttinfo(&(self->tzrule_after), ts, fold,
-                                  PyDateTime_GET_YEAR(dt));
-    }
-    else {
-        size_t idx = _bisect(ts, local_transitions, self->num_transitions) - 1;
-        assert(idx < self->num_transitions);
-        return self->trans_ttinfos[idx];
+        size_t name_len = strlen(name);
+        char *path = PyMem_RawMalloc(dir_len + sep_len + name_len + 1);
+        if (path == NULL) {
+            rv = -1;
+            break;
+        }
+        memcpy(path, dir_path, dir_len);
+        path[dir_len] = '/';
+        memcpy(path + dir_len + sep_len, name, name_len + 1);
+
+        int is_dir = 0;
+        int is_link = 0;
+#ifdef DT_UNKNOWN
+        if (entry->d_type == DT_DIR) {
+            is_dir = 1;
+        }
+        else if (entry->d_type != DT_REG)
+#endif
+        {
+            if (!stat(path, &st) && S_ISDIR(st.st_mode)) {
+                is_dir = 1;
+                is_link = !lstat(path, &st) && S_ISLNK(st.st_mode);
+            }
+        }
+
+        if (!is_dir) {
+            rv = path_list_append(files, path, 0);
+            continue;
+        }
+
+        if (!is_link &&
+            !(top && (!strcmp(name, "right") || !strcmp(name, "posix")))) {
+            rv = walk_tzpath_dir(path, 0, dirs, files);
+        }
+        PyMem_RawFree(path);
     }
-}
 
-static int
-is_leap_year(int year)
-{
-    const unsigned int ayear = (unsigned int)year;
-    return ayear % 4 == 0 && (ayear % 100 != 0 || ayear % 400 == 0);
+    closedir(dir);
+    return rv;
 }
 
-/* Calculates ordinal datetime from year, month and day. */
-static int
-ymd_to_ord(int y, int m, int d)
+/* Checks whether a file collected by walk_tzpath_dir starts with the TZif
+ * magic (see run_parallel). */
+static void
+check_tzif_magic(void *arg, size_t i)
 {
-    y -= 1;
-    int days_before_year = (y * 365) + (y / 4) - (y / 100) + (y / 400);
-    int yearday = DAYS_BEFORE_MONTH[m];
-    if (m > 2 && is_leap_year(y + 1)) {
-        yearday += 1;
+    _path_list *files = arg;
+    char magic[4];
+    ssize_t n = -1;
+
+    int fd = open(files->paths[i], O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        do {
+            n = read(fd, magic, sizeof(magic));
+        } while (n < 0 && errno == EINTR);
+        close(fd);
     }
 
-    return days_before_year + yearday + d;
+    files->values[i] = n == sizeof(magic) && !memcmp(magic, "TZif", 4);
 }
 
-/* Calculate the number of seconds since 1970-01-01 in local time.
+/* Finds the TZif files under a TZPATH entry, for available_timezones.
  *
- * This gets a datetime in the same "units" as self->trans_list_wall so that we
- * can easily determine which transitions a datetime falls between. See the
- * comment above ts_to_local for more information.
- * */
-static int
-get_local_timestamp(PyObject *dt, int64_t *local_ts)
+ * The directory tree is walked and the files are checked for the TZif magic
+ * without holding the GIL, the latter on several threads. Returns a tuple of
+ * the list of keys found and a dict mapping each directory that was walked
+ * to its st_mtime_ns, so that the caller can tell when to walk it again.
+ */
+static PyObject *
+zoneinfo_walk_tzpath(PyObject *module, PyObject *tz_root)
 {
-    assert(local_ts != NULL);
+    PyObject *root_bytes = NULL;
+    PyObject *keys = NULL;
+    PyObject *dir_mtimes = NULL;
+    PyObject *out = NULL;
+    _path_list dirs = {0};
+    _path_list files = {0};
+    int walk_failed;
+
+    if (!PyUnicode_FSConverter(tz_root, &root_bytes)) {
+        return NULL;
+    }
 
-    int hour, minute, second;
-    int ord;
-    if (PyDateTime_CheckExact(dt)) {
-        int y = PyDateTime_GET_YEAR(dt);
-        int m = PyDateTime_GET_MONTH(dt);
-        int d = PyDateTime_GET_DAY(dt);
-        hour = PyDateTime_DATE_GET_HOUR(dt);
-        minute = PyDateTime_DATE_GET_MINUTE(dt);
-        second = PyDateTime_DATE_GET_SECOND(dt);
+    // Strip any trailing slashes so that keys are relative to the root
+    const char *root = PyBytes_AS_STRING(root_bytes);
+    size_t root_len = (size_t)PyBytes_GET_SIZE(root_bytes);
+    while (root_len > 1 && root[root_len - 1] == '/') {
+        root_len--;
+    }
+    PyObject *tmp = PyBytes_FromStringAndSize(root, root_len);
+    Py_SETREF(root_bytes, tmp);
+    if (root_bytes == NULL) {
+        return NULL;
+    }
 
-        ord = ymd_to_ord(y, m, d);
+    Py_BEGIN_ALLOW_THREADS;
+    walk_failed = walk_tzpath_dir(PyBytes_AS_STRING(root_bytes), 1, &dirs,
+                                  &files);
+    Py_END_ALLOW_THREADS;
+
+    if (walk_failed) {
+        PyErr_NoMemory();
+        goto cleanup;
     }
-    else {
-        PyObject *num = PyObject_CallMethod(dt, "toordinal", NULL);
-        if (num == NULL) {
-            return -1;
-        }
 
-        ord = PyLong_AsLong(num);
-        Py_DECREF(num);
-        if (ord == -1 && PyErr_Occurred()) {
-            return -1;
-        }
+    if (files.len && run_parallel(check_tzif_magic, &files, files.len,
+                                  default_num_workers())) {
+        goto cleanup;
+    }
 
-        num = PyObject_GetAttrString(dt, "hour");
-        if (num == NULL) {
-            return -1;
-        }
-        hour = PyLong_AsLong(num);
-        Py_DECREF(num);
-        if (hour == -1) {
-            return -1;
-        }
+    keys = PyList_New(0);
+    dir_mtimes = PyDict_New();
+    if (keys == NULL || dir_mtimes == NULL) {
+        goto cleanup;
+    }
 
-        num = PyObject_GetAttrString(dt, "minute");
-        if (num == NULL) {
-            return -1;
-        }
-        minute = PyLong_AsLong(num);
-        Py_DECREF(num);
-        if (minute == -1) {
-            return -1;
+    // A root of "/" leaves no separator to skip
+    size_t prefix_len = root_len + (root_len > 1 || root[0] != '/');
+    for (size_t i = 0; i < files.len; ++i) {
+        if (!files.values[i]) {
+            continue;
         }
 
-        num = PyObject_GetAttrString(dt, "second");
-        if (num == NULL) {
-            return -1;
+        const char *key = files.paths[i] + prefix_len;
+        PyObject *key_obj = PyUnicode_DecodeFSDefault(key);
+        if (key_obj == NULL || PyList_Append(keys, key_obj) < 0) {
+            Py_XDECREF(key_obj);
+            goto cleanup;
         }
-        second = PyLong_AsLong(num);
-        Py_DECREF(num);
-        if (second == -1) {
-            return -1;
+        Py_DECREF(key_obj);
+    }
+
+    for (size_t i = 0; i < dirs.len; ++i) {
+        PyObject *dir_path = PyUnicode_DecodeFSDefault(dirs.paths[i]);
+        PyObject *mtime = PyLong_FromLongLong(dirs.values[i]);
+        int failed = dir_path == NULL || mtime == NULL ||
+                     PyDict_SetItem(dir_mtimes, dir_path, mtime) < 0;
+        Py_XDECREF(dir_path);
+        Py_XDECREF(mtime);
+        if (failed) {
+            goto cleanup;
         }
     }
 
-    *local_ts = (int64_t)(ord - EPOCHORDINAL) * 86400 +
-                (int64_t)(hour * 3600 + minute * 60 + second);
-
-    return 0;
+    out = PyTuple_Pack(2, keys, dir_mtimes);
+cleanup:
+    path_list_free(&dirs);
+    path_list_free(&files);
+    Py_XDECREF(keys);
+    Py_XDECREF(dir_mtimes);
+    Py_DECREF(root_bytes);
+    return out;
+}
+#else
+static PyObject *
+find_tzfile(PyObject *key)
+{
+    return PyObject_CallFunctionObjArgs(_tzpath_find_tzfile, key, NULL);
 }
+#endif
 
 /////
 // Functions for cache handling
@@ -2512,25 +7349,38 @@ new_weak_cache()
 static int
 initialize_caches()
 {
-    if (TIMEDELTA_CACHE == NULL) {
-        TIMEDELTA_CACHE = PyDict_New();
+    SHARED_TABLES_USERS++;
+
+    if (ZONEINFO_WEAK_CACHE == NULL) {
+        ZONEINFO_WEAK_CACHE = new_weak_cache();
     }
     else {
-        Py_INCREF(TIMEDELTA_CACHE);
+        Py_INCREF(ZONEINFO_WEAK_CACHE);
     }
 
-    if (TIMEDELTA_CACHE == NULL) {
+    if (ZONEINFO_WEAK_CACHE == NULL) {
         return -1;
     }
 
-    if (ZONEINFO_WEAK_CACHE == NULL) {
-        ZONEINFO_WEAK_CACHE = new_weak_cache();
+    if (ZONE_BUNDLE_CACHE == NULL) {
+        ZONE_BUNDLE_CACHE = PyDict_New();
     }
     else {
-        Py_INCREF(ZONEINFO_WEAK_CACHE);
+        Py_INCREF(ZONE_BUNDLE_CACHE);
     }
 
-    if (ZONEINFO_WEAK_CACHE == NULL) {
+    if (ZONE_BUNDLE_CACHE == NULL) {
+        return -1;
+    }
+
+    if (ZONE_BLOCK_CACHE == NULL) {
+        ZONE_BLOCK_CACHE = PyDict_New();
+    }
+    else {
+        Py_INCREF(ZONE_BLOCK_CACHE);
+    }
+
+    if (ZONE_BLOCK_CACHE == NULL) {
         return -1;
     }
 
@@ -2562,6 +7412,18 @@ static PyMethodDef zoneinfo_methods[] = {
     {"from_file", (PyCFunction)(void (*)(void))zoneinfo_from_file,
      METH_VARARGS | METH_KEYWORDS | METH_CLASS,
      PyDoc_STR("Create a ZoneInfo file from a file object.")},
+    {"from_bundle", (PyCFunction)(void (*)(void))zoneinfo_from_bundle,
+     METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+     PyDoc_STR("Create a ZoneInfo object from a zone in a compiled bundle.")},
+    {"preload", (PyCFunction)(void (*)(void))zoneinfo_preload,
+     METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+     PyDoc_STR("Load many zones concurrently, returning a list of them.")},
+    {"watch_tzpath", (PyCFunction)(void (*)(void))zoneinfo_watch_tzpath,
+     METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+     PyDoc_STR("Start evicting zones from the cache when their files on the "
+               "TZPATH change.")},
+    {"_evict_keys", (PyCFunction)zoneinfo__evict_keys, METH_O | METH_CLASS,
+     PyDoc_STR("Private method used to evict changed zones.")},
     {"utcoffset", (PyCFunction)zoneinfo_utcoffset, METH_O,
      PyDoc_STR("Retrieve a timedelta representing the UTC offset in a zone at "
                "the given datetime.")},
@@ -2571,6 +7433,28 @@ static PyMethodDef zoneinfo_methods[] = {
     {"tzname", (PyCFunction)zoneinfo_tzname, METH_O,
      PyDoc_STR("Retrieve a string containing the abbreviation for the time "
                "zone that applies in a zone at a given datetime.")},
+    {"lookup", (PyCFunction)zoneinfo_lookup, METH_O,
+     PyDoc_STR("Retrieve the UTC offset, DST adjustment and abbreviation in a "
+               "zone at the given datetime, and whether it is in a fold or a "
+               "gap.")},
+    {"utcoffsets", (PyCFunction)(void (*)(void))zoneinfo_utcoffsets,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Write the UTC offsets in seconds at an array of UTC "
+               "timestamps to an array of 32-bit integers, and optionally "
+               "whether DST is in effect at each to an array of bytes.")},
+    {"fromutc_timestamps",
+     (PyCFunction)(void (*)(void))zoneinfo_fromutc_timestamps,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Write the local timestamps corresponding to an array of UTC "
+               "timestamps to an array of 64-bit integers, and optionally "
+               "their folds to an array of bytes.")},
+    {"toutc_timestamps",
+     (PyCFunction)(void (*)(void))zoneinfo_toutc_timestamps,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Write the UTC timestamps corresponding to an array of local "
+               "timestamps to an array of 64-bit integers, resolving those in "
+               "gaps and folds by the given policies, and optionally which "
+               "were in gaps and folds to arrays of bytes.")},
     {"fromutc", (PyCFunction)zoneinfo_fromutc, METH_O,
      PyDoc_STR("Given a datetime with local time in UTC, retrieve an adjusted "
                "datetime in local time.")},
@@ -2609,28 +7493,103 @@ static PyTypeObject PyZoneInfo_ZoneInfoType = {
     .tp_dealloc = zoneinfo_dealloc,
 };
 
+#ifdef HAVE_INOTIFY
+static PyObject *
+zoneinfo_inotify_init(PyObject *module, PyObject *unused)
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    return PyLong_FromLong(fd);
+}
+
+/* Adds a watch for `path` to the inotify instance `fd`.
+ *
+ * Only the fact that something changed is used (see _watch.py), so the
+ * watch covers every change to the directory's entries and their contents,
+ * and the events are not decoded.
+ */
+static PyObject *
+zoneinfo_inotify_add_watch(PyObject *module, PyObject *args)
+{
+    int fd;
+    PyObject *path = NULL;
+    if (!PyArg_ParseTuple(args, "iO&", &fd, PyUnicode_FSConverter, &path)) {
+        return NULL;
+    }
+
+    uint32_t mask = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                    IN_DELETE_SELF | IN_MOVE_SELF | IN_MOVED_FROM |
+                    IN_MOVED_TO | IN_ONLYDIR;
+    int wd = inotify_add_watch(fd, PyBytes_AS_STRING(path), mask);
+    if (wd < 0) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+        Py_DECREF(path);
+        return NULL;
+    }
+
+    Py_DECREF(path);
+    return PyLong_FromLong(wd);
+}
+#endif
+
 /////
 // Specify the zoneinfo._czoneinfo module
-static PyMethodDef module_methods[] = {{NULL, NULL}};
+static PyMethodDef module_methods[] = {
+    {"_timedelta_cache_info", (PyCFunction)zoneinfo_timedelta_cache_info,
+     METH_NOARGS,
+     PyDoc_STR("Report the size and hit counts of the timedelta cache.")},
+    {"_check_civil_dates", (PyCFunction)zoneinfo_check_civil_dates,
+     METH_NOARGS,
+     PyDoc_STR("Compare the civil date functions with their references.")},
+#ifdef NATIVE_TZPATH
+    {"_walk_tzpath", (PyCFunction)zoneinfo_walk_tzpath, METH_O,
+     PyDoc_STR("Find the TZif files under a TZPATH entry.")},
+    {"_forget_tzpath_dirs", (PyCFunction)zoneinfo__forget_tzpath_dirs,
+     METH_O,
+     PyDoc_STR("Discard the cached listings of the directories of keys.")},
+#endif
+#ifdef HAVE_INOTIFY
+    {"_inotify_init", (PyCFunction)zoneinfo_inotify_init, METH_NOARGS,
+     PyDoc_STR("Create a non-blocking inotify file descriptor.")},
+    {"_inotify_add_watch", (PyCFunction)zoneinfo_inotify_add_watch,
+     METH_VARARGS,
+     PyDoc_STR("Watch a directory for changes to the files in it.")},
+#endif
+    {NULL, NULL}};
 static void
 module_free()
 {
     Py_XDECREF(_tzpath_find_tzfile);
     _tzpath_find_tzfile = NULL;
 
+    Py_XDECREF(_bundle_mod);
+    _bundle_mod = NULL;
+
+    Py_XDECREF(_watch_mod);
+    _watch_mod = NULL;
+
+
+#ifdef NATIVE_TZPATH
+    free_tzpath();
+#endif
+
     Py_XDECREF(_common_mod);
     _common_mod = NULL;
 
     Py_XDECREF(io_open);
     io_open = NULL;
 
+    Py_CLEAR(USE_ATTRIBUTES_STR);
+    Py_CLEAR(EMPTY_TUPLE);
+    Py_CLEAR(FOLD_KWARGS);
+
     xdecref_ttinfo(&NO_TTINFO);
 
-    if (TIMEDELTA_CACHE != NULL && Py_REFCNT(TIMEDELTA_CACHE) > 1) {
-        Py_DECREF(TIMEDELTA_CACHE);
-    }
-    else {
-        Py_CLEAR(TIMEDELTA_CACHE);
+    if (SHARED_TABLES_USERS > 0 && --SHARED_TABLES_USERS == 0) {
+        clear_shared_tables();
     }
 
     if (ZONEINFO_WEAK_CACHE != NULL && Py_REFCNT(ZONEINFO_WEAK_CACHE) > 1) {
@@ -2640,6 +7599,20 @@ module_free()
         Py_CLEAR(ZONEINFO_WEAK_CACHE);
     }
 
+    if (ZONE_BUNDLE_CACHE != NULL && Py_REFCNT(ZONE_BUNDLE_CACHE) > 1) {
+        Py_DECREF(ZONE_BUNDLE_CACHE);
+    }
+    else {
+        Py_CLEAR(ZONE_BUNDLE_CACHE);
+    }
+
+    if (ZONE_BLOCK_CACHE != NULL && Py_REFCNT(ZONE_BLOCK_CACHE) > 1) {
+        Py_DECREF(ZONE_BLOCK_CACHE);
+    }
+    else {
+        Py_CLEAR(ZONE_BLOCK_CACHE);
+    }
+
     clear_strong_cache(&PyZoneInfo_ZoneInfoType);
 }
 
@@ -2658,6 +7631,14 @@ zoneinfomodule_exec(PyObject *m)
     Py_INCREF(&PyZoneInfo_ZoneInfoType);
     PyModule_AddObject(m, "ZoneInfo", (PyObject *)&PyZoneInfo_ZoneInfoType);
 
+    if (LookupResultType.tp_name == NULL &&
+        PyStructSequence_InitType2(&LookupResultType, &lookup_result_desc)) {
+        goto error;
+    }
+
+    Py_INCREF(&LookupResultType);
+    PyModule_AddObject(m, "LookupResult", (PyObject *)&LookupResultType);
+
     /* Populate imports */
     PyObject *_tzpath_module =
         PyImport_ImportModule("backports.zoneinfo._tzpath");
@@ -2667,6 +7648,11 @@ zoneinfomodule_exec(PyObject *m)
 
     _tzpath_find_tzfile =
         PyObject_GetAttrString(_tzpath_module, "find_tzfile");
+#ifdef NATIVE_TZPATH
+    if (_tzpath_find_tzfile != NULL && initialize_tzpath(_tzpath_module)) {
+        Py_CLEAR(_tzpath_find_tzfile);
+    }
+#endif
     Py_DECREF(_tzpath_module);
     if (_tzpath_find_tzfile == NULL) {
         goto error;
@@ -2688,7 +7674,41 @@ zoneinfomodule_exec(PyObject *m)
         goto error;
     }
 
+    _bundle_mod = PyImport_ImportModule("backports.zoneinfo._bundle");
+    if (_bundle_mod == NULL) {
+        goto error;
+    }
+
+    _watch_mod = PyImport_ImportModule("backports.zoneinfo._watch");
+    if (_watch_mod == NULL) {
+        goto error;
+    }
+
+    if (USE_ATTRIBUTES_STR == NULL) {
+        USE_ATTRIBUTES_STR =
+            PyUnicode_InternFromString("__zoneinfo_use_attributes__");
+        if (USE_ATTRIBUTES_STR == NULL) {
+            goto error;
+        }
+    }
+
+    if (EMPTY_TUPLE == NULL) {
+        EMPTY_TUPLE = PyTuple_New(0);
+        if (EMPTY_TUPLE == NULL) {
+            goto error;
+        }
+    }
+
+    if (FOLD_KWARGS == NULL) {
+        FOLD_KWARGS = Py_BuildValue("{s:i}", "fold", 1);
+        if (FOLD_KWARGS == NULL) {
+            goto error;
+        }
+    }
+
     if (NO_TTINFO.utcoff == NULL) {
+        init_year_table();
+
         NO_TTINFO.utcoff = Py_None;
         NO_TTINFO.dstoff = Py_None;
         NO_TTINFO.tzname = Py_None;
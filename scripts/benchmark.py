@@ -1,6 +1,7 @@
 import statistics
 import sys
 import timeit
+from array import array
 from datetime import datetime, timezone
 
 import click
@@ -38,6 +39,35 @@ BENCHMARKS = {
         *args, **kwargs, from_utc=True
     ),
     "utcoffset": lambda *args, **kwargs: bench_utcoffset(*args, **kwargs),
+    "utcoffset_historical": lambda *args, **kwargs: bench_utcoffset_many(
+        *args, **kwargs, datetimes=HISTORICAL_DATETIMES
+    ),
+    "from_utc_historical": lambda *args, **kwargs: bench_from_utc_many(
+        *args, **kwargs, datetimes=HISTORICAL_DATETIMES
+    ),
+    "utcoffset_subclass": lambda *args, **kwargs: bench_utcoffset_many(
+        *args, **kwargs, datetimes=SUBCLASS_DATETIMES
+    ),
+    "from_utc_subclass": lambda *args, **kwargs: bench_from_utc_many(
+        *args, **kwargs, datetimes=SUBCLASS_DATETIMES
+    ),
+    "utcoffset_dst_tzname": lambda *args, **kwargs: bench_utcoffset_dst_tzname(
+        *args, **kwargs
+    ),
+    "lookup": lambda *args, **kwargs: bench_lookup(*args, **kwargs),
+    "utcoffsets": lambda *args, **kwargs: bench_utcoffsets(*args, **kwargs),
+    "from_utc_timestamps": lambda *args, **kwargs: bench_from_utc_timestamps(
+        *args, **kwargs
+    ),
+    "to_utc_timestamps": lambda *args, **kwargs: bench_to_utc_timestamps(
+        *args, **kwargs
+    ),
+    "utcoffset_future": lambda *args, **kwargs: bench_utcoffset_many(
+        *args, **kwargs, datetimes=FUTURE_DATETIMES
+    ),
+    "from_utc_future": lambda *args, **kwargs: bench_from_utc_many(
+        *args, **kwargs, datetimes=FUTURE_DATETIMES
+    ),
     "constructor": lambda *args, **kwargs: bench_constructor(
         *args, **kwargs, cache=True
     ),
@@ -84,6 +114,154 @@ def bench_utcoffset(source, zone_key):
     return func
 
 
+# One date in each of the years 1900-2019, in a scrambled order so that
+# successive lookups do not hit the same part of the transition list
+HISTORICAL_DATETIMES = [
+    datetime(1900 + (i * 67) % 120, 1 + i % 12, 15) for i in range(120)
+]
+
+# The same for 2040-2159, which are mostly after the last transition in the
+# file, where the offsets come from the zone's TZ string
+FUTURE_DATETIMES = [
+    dt.replace(year=dt.year + 140) for dt in HISTORICAL_DATETIMES
+]
+
+
+
+class DatetimeSubclass(datetime):
+    """A datetime subclass that does not override any fields, like those of
+    pandas, pendulum or arrow."""
+
+
+# The historical dates as instances of a datetime subclass
+SUBCLASS_DATETIMES = [
+    DatetimeSubclass(dt.year, dt.month, dt.day)
+    for dt in HISTORICAL_DATETIMES
+]
+
+
+def bench_utcoffset_many(source, zone_key, datetimes):
+    zone = get_zone(source, zone_key)
+    if source != "pytz":
+        dts = [dt.replace(tzinfo=zone) for dt in datetimes]
+    else:
+        dts = [zone.localize(dt) for dt in datetimes]
+
+    def func(dts=dts):
+        for dt in dts:
+            dt.utcoffset()
+
+    return func
+
+
+def bench_utcoffset_dst_tzname(source, zone_key):
+    zone = get_zone(source, zone_key)
+    if source != "pytz":
+        dts = [dt.replace(tzinfo=zone) for dt in HISTORICAL_DATETIMES]
+    else:
+        dts = [zone.localize(dt) for dt in HISTORICAL_DATETIMES]
+
+    def func(dts=dts):
+        for dt in dts:
+            dt.utcoffset()
+            dt.dst()
+            dt.tzname()
+
+    return func
+
+
+def bench_lookup(source, zone_key):
+    if source not in ("c_zoneinfo", "py_zoneinfo"):
+        raise UnsupportedOperation(f"Source {source} has no lookup method.")
+
+    zone = get_zone(source, zone_key)
+    dts = [dt.replace(tzinfo=zone) for dt in HISTORICAL_DATETIMES]
+
+    def func(dts=dts, lookup=zone.lookup):
+        for dt in dts:
+            lookup(dt)
+
+    return func
+
+
+# The historical dates as timestamps, for the batch methods (which read them
+# as UTC or, for toutc_timestamps, as local times)
+HISTORICAL_TIMESTAMPS = array(
+    "q",
+    [
+        int(dt.replace(tzinfo=timezone.utc).timestamp())
+        for dt in HISTORICAL_DATETIMES
+    ],
+)
+
+
+def bench_utcoffsets(source, zone_key):
+    if source not in ("c_zoneinfo", "py_zoneinfo"):
+        raise UnsupportedOperation(f"Source {source} has no utcoffsets method.")
+
+    zone = get_zone(source, zone_key)
+    timestamps = HISTORICAL_TIMESTAMPS
+    offsets = array("i", [0]) * len(timestamps)
+
+    def func(timestamps=timestamps, offsets=offsets, zone=zone):
+        zone.utcoffsets(timestamps, offsets)
+
+    return func
+
+
+def bench_from_utc_timestamps(source, zone_key):
+    if source not in ("c_zoneinfo", "py_zoneinfo"):
+        raise UnsupportedOperation(
+            f"Source {source} has no fromutc_timestamps method."
+        )
+
+    zone = get_zone(source, zone_key)
+    timestamps = HISTORICAL_TIMESTAMPS
+    local = array("q", [0]) * len(timestamps)
+    fold = bytearray(len(timestamps))
+
+    def func(timestamps=timestamps, local=local, fold=fold, zone=zone):
+        zone.fromutc_timestamps(timestamps, local, fold)
+
+    return func
+
+
+def bench_to_utc_timestamps(source, zone_key):
+    if source not in ("c_zoneinfo", "py_zoneinfo"):
+        raise UnsupportedOperation(
+            f"Source {source} has no toutc_timestamps method."
+        )
+
+    zone = get_zone(source, zone_key)
+    local = HISTORICAL_TIMESTAMPS
+    utc = array("q", [0]) * len(local)
+    in_gap = bytearray(len(local))
+    in_fold = bytearray(len(local))
+
+    def func(local=local, utc=utc, in_gap=in_gap, in_fold=in_fold, zone=zone):
+        zone.toutc_timestamps(
+            local,
+            utc,
+            nonexistent="shift_forward",
+            ambiguous="earliest",
+            in_gap=in_gap,
+            in_fold=in_fold,
+        )
+
+    return func
+
+
+def bench_from_utc_many(source, zone_key, datetimes):
+    zone = get_zone(source, zone_key)
+    dts = [dt.replace(tzinfo=timezone.utc) for dt in datetimes]
+
+    def func(dts=dts, zone=zone):
+        for dt in dts:
+            dt.astimezone(zone)
+
+    return func
+
+
 def bench_constructor(source, zone_key, cache=False):
     if cache:
         zone_cache = get_zone(source, zone_key)
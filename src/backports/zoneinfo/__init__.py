@@ -1,6 +1,7 @@
 __all__ = [
     "ZoneInfo",
     "reset_tzpath",
+    "set_shared_cache",
     "available_timezones",
     "TZPATH",
     "ZoneInfoNotFoundError",
@@ -8,7 +9,7 @@ __all__ = [
 ]
 import sys
 
-from . import _tzpath
+from . import _bundle, _tzpath
 from ._common import ZoneInfoNotFoundError
 from ._version import __version__
 
@@ -18,6 +19,7 @@ except ImportError:  # pragma: nocover
     from ._zoneinfo import ZoneInfo
 
 reset_tzpath = _tzpath.reset_tzpath
+set_shared_cache = _bundle.set_shared_cache
 available_timezones = _tzpath.available_timezones
 InvalidTZPathWarning = _tzpath.InvalidTZPathWarning
 
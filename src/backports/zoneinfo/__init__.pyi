@@ -1,9 +1,11 @@
 import os
 import typing
-from datetime import datetime, tzinfo
+from datetime import datetime, timedelta, tzinfo
 from typing import (
     Any,
     Iterable,
+    List,
+    NamedTuple,
     Optional,
     Protocol,
     Sequence,
@@ -13,6 +15,9 @@ from typing import (
 )
 
 _T = typing.TypeVar("_T", bound="ZoneInfo")
+# Any object that supports the buffer protocol, such as an array.array
+_Buffer = Any
+_W = typing.TypeVar("_W", bound="_TZPathWatcher")
 
 class _IOBytes(Protocol):
     def read(self, __size: int) -> bytes: ...
@@ -29,7 +34,59 @@ class ZoneInfo(tzinfo):
         cls: Type[_T], __fobj: _IOBytes, key: Optional[str] = ...
     ) -> _T: ...
     @classmethod
+    def from_bundle(
+        cls: Type[_T], path: Union[os.PathLike, str], key: str
+    ) -> _T: ...
+    @classmethod
+    def preload(
+        cls: Type[_T],
+        keys: Iterable[str],
+        workers: Optional[int] = ...,
+        *,
+        freeze: bool = ...,
+    ) -> List[_T]: ...
+    @classmethod
     def clear_cache(cls, *, only_keys: Iterable[str] = ...) -> None: ...
+    @classmethod
+    def watch_tzpath(
+        cls, *, reload: bool = ..., interval: Optional[float] = ...
+    ) -> _TZPathWatcher: ...
+    def lookup(self, __dt: datetime) -> _LookupResult: ...
+    def utcoffsets(
+        self,
+        timestamps: _Buffer,
+        offsets: _Buffer,
+        isdst: Optional[_Buffer] = ...,
+    ) -> None: ...
+    def fromutc_timestamps(
+        self,
+        timestamps: _Buffer,
+        local: _Buffer,
+        fold: Optional[_Buffer] = ...,
+    ) -> None: ...
+    def toutc_timestamps(
+        self,
+        local: _Buffer,
+        utc: _Buffer,
+        *,
+        nonexistent: str = ...,
+        ambiguous: Union[str, _Buffer] = ...,
+        in_gap: Optional[_Buffer] = ...,
+        in_fold: Optional[_Buffer] = ...,
+    ) -> None: ...
+
+class _LookupResult(NamedTuple):
+    utcoffset: timedelta
+    dst: timedelta
+    tzname: str
+    in_fold: bool
+    in_gap: bool
+
+class _TZPathWatcher:
+    def check(self) -> Set[str]: ...
+    def stop(self) -> None: ...
+    def __enter__(self: _W) -> _W: ...
+    def __exit__(self, *exc_info: Any) -> None: ...
 
 # Note: Both here and in clear_cache, the types allow the use of `str` where
 # a sequence of strings is required. This should be remedied if a solution
@@ -37,6 +94,7 @@ class ZoneInfo(tzinfo):
 def reset_tzpath(
     to: Optional[Sequence[Union[os.PathLike, str]]] = ...
 ) -> None: ...
+def set_shared_cache(path: Optional[Union[os.PathLike, str]]) -> None: ...
 def available_timezones() -> Set[str]: ...
 
 TZPATH: Sequence[str]
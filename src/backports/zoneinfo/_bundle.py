@@ -0,0 +1,466 @@
+"""Compiled zone bundles.
+
+A bundle is a single file containing any number of zones in a pre-decoded
+form, so that loading a zone from it (see ``ZoneInfo.from_bundle``) requires
+no path search and no TZif parsing. The C extension maps bundles into memory
+and uses the transition tables in place.
+
+All integers are little-endian, and every section that contains 64-bit
+integers is aligned to 8 bytes. A bundle consists of:
+
+Header::
+
+    8s  magic (b"TZBUNDLE")
+    I   version (1)
+    I   number of zones
+    Q   offset of the index
+    Q   stamp identifying the data the bundle was compiled from (0 if none)
+
+Index (one entry per zone, sorted by the UTF-8 encoded key)::
+
+    Q   offset of the zone record
+    I   offset of the key
+    I   length of the key
+
+Keys, encoded as UTF-8 and concatenated.
+
+Zone records, each of which starts with a header::
+
+    I   number of transitions (n)
+    I   number of ttinfos (m)
+    I   length of the abbreviation block, including terminating NULs
+    I   length of the TZ string, not including its terminating NUL
+
+Followed by::
+
+    q[n]    transition times in UTC
+    q[n]    transition times in local time, for fold=0
+    q[n]    transition times in local time, for fold=1
+    l[m]    UTC offset of each ttinfo, in seconds
+    l[m]    DST offset of each ttinfo, in seconds
+    B[m]    isdst flag for each ttinfo
+    B[m]    offset of each ttinfo's abbreviation in the abbreviation block
+    B[n]    index of the ttinfo that applies after each transition
+    s       NUL-terminated abbreviations
+    s       NUL-terminated TZ string (empty if there is none)
+
+The local transition times and DST offsets are derived exactly as they are
+when loading a TZif file.
+
+To build a bundle from the command line, run::
+
+    python -m backports.zoneinfo._bundle OUTPUT [KEY ...]
+
+A bundle can also be used as a cache of all of the zones on TZPATH that is
+shared between processes (see ``set_shared_cache``), in which case the stamp
+is derived from the TZPATH and the modification times of its directories.
+"""
+
+import os
+import struct
+import sys
+
+from . import _common, _tzpath
+
+BUNDLE_MAGIC = b"TZBUNDLE"
+BUNDLE_VERSION = 1
+
+_HEADER = struct.Struct("<8sIIQQ")
+_INDEX_ENTRY = struct.Struct("<QII")
+_RECORD_HEADER = struct.Struct("<IIII")
+
+SOURCES = ("auto", "tzpath", "tzdata")
+
+# The path of the bundle used as a shared cache (see set_shared_cache)
+SHARED_CACHE = None
+
+
+def build_bundle(keys=None, source="auto", stamp=0):
+    """Compile the zones with the specified keys into a bundle.
+
+    If ``keys`` is None, all available zones are included. ``source``
+    determines where the zone data comes from: "tzpath" uses only
+    ``TZPATH``, "tzdata" uses only the tzdata package, and "auto" uses the
+    same search order as the ``ZoneInfo`` constructor. ``stamp`` is stored
+    in the header.
+
+    Returns the contents of the bundle as bytes.
+    """
+    if source not in SOURCES:
+        raise ValueError(f"source must be one of {SOURCES}, not {source!r}")
+
+    if keys is None:
+        keys = _available_keys(source)
+
+    encoded_keys = sorted({key.encode(): key for key in keys}.items())
+
+    index_offset = _HEADER.size
+    keys_offset = index_offset + _INDEX_ENTRY.size * len(encoded_keys)
+    records_offset = _align(
+        keys_offset + sum(len(key) for key, _ in encoded_keys)
+    )
+
+    index = []
+    records = []
+    key_offset = keys_offset
+    record_offset = records_offset
+    for encoded_key, key in encoded_keys:
+        record = _compile_zone(_load_zone(key, source))
+
+        index.append(
+            _INDEX_ENTRY.pack(record_offset, key_offset, len(encoded_key))
+        )
+        records.append(record)
+
+        key_offset += len(encoded_key)
+        record_offset += len(record)
+
+    header = _HEADER.pack(
+        BUNDLE_MAGIC, BUNDLE_VERSION, len(encoded_keys), index_offset, stamp
+    )
+    key_block = b"".join(key for key, _ in encoded_keys)
+    padding = b"\x00" * (records_offset - keys_offset - len(key_block))
+
+    return b"".join([header] + index + [key_block, padding] + records)
+
+
+def write_bundle(path, keys=None, source="auto", stamp=0):
+    """Compile a bundle (see build_bundle) and write it to ``path``.
+
+    The bundle is written to a temporary file which then replaces ``path``,
+    because processes that have loaded zones from an existing bundle may
+    still have it mapped into memory.
+    """
+    contents = build_bundle(keys, source=source, stamp=stamp)
+
+    tmp_path = f"{os.fspath(path)}.{os.getpid()}.tmp"
+    try:
+        with open(tmp_path, "wb") as f:
+            f.write(contents)
+        os.replace(tmp_path, path)
+    except BaseException:
+        if os.path.exists(tmp_path):
+            os.remove(tmp_path)
+        raise
+
+
+def load_zone_data(path, key):
+    """Retrieve the data for one zone from a bundle.
+
+    The return value has the same format as that of ``_common.load_data``.
+    """
+    contents, index = _open_bundle(path)
+
+    offset = index.get(key.encode(), None)
+    if offset is None:
+        raise _common.ZoneInfoNotFoundError(
+            f"No time zone found with key {key} in bundle {path!r}"
+        )
+
+    return _read_zone(contents, offset)
+
+
+def set_shared_cache(path):
+    """Use a compiled bundle of the zones on TZPATH, shared between processes.
+
+    If the bundle at ``path`` is missing or was compiled from a different
+    TZPATH (or before one of the directories on it was modified), it is
+    rebuilt. Every process that calls this with the same path uses the same
+    file, which is mapped into memory rather than read, so the zone data is
+    shared through the operating system's page cache; a path on a
+    memory-backed file system such as ``/dev/shm`` avoids disk I/O entirely.
+
+    Passing ``None`` stops using the shared cache. It is also disabled by
+    ``reset_tzpath``.
+    """
+    global SHARED_CACHE
+
+    if path is not None:
+        path = os.fspath(path)
+        ensure_shared_cache(path)
+
+    SHARED_CACHE = path
+
+
+def load_shared_zone_data(key):
+    """Retrieve the data for one zone from the shared cache, if it is in use.
+
+    Returns None if there is no shared cache or the zone is not in it.
+    """
+    path = SHARED_CACHE
+    if path is None or not isinstance(key, str):
+        return None
+
+    try:
+        encoded_key = key.encode()
+    except UnicodeEncodeError:
+        return None
+
+    contents, index = _open_bundle(path)
+    offset = index.get(encoded_key, None)
+    if offset is None:
+        return None
+
+    return _read_zone(contents, offset)
+
+
+def ensure_shared_cache(path):
+    """Make sure that ``path`` contains a bundle of the zones on TZPATH.
+
+    The bundle is rebuilt if its stamp does not match the current TZPATH.
+    Where file locking is available, processes starting at the same time
+    wait for the first one to build the bundle rather than all building it.
+    """
+    stamp = _tzpath_stamp()
+    if _read_stamp(path) == stamp:
+        return
+
+    try:
+        import fcntl
+    except ImportError:  # pragma: nocover
+        fcntl = None
+
+    lock_path = f"{os.fspath(path)}.lock"
+    with open(lock_path, "ab") as lock_file:
+        if fcntl is not None:
+            fcntl.flock(lock_file, fcntl.LOCK_EX)
+
+        try:
+            # Another process may have built it while we were waiting
+            if _read_stamp(path) != stamp:
+                keys = {
+                    key for key in _tzpath._tzpath_zones() if _is_utf8(key)
+                }
+                write_bundle(path, keys, source="tzpath", stamp=stamp)
+        finally:
+            if fcntl is not None:
+                fcntl.flock(lock_file, fcntl.LOCK_UN)
+
+
+def _tzpath_stamp():
+    _tzpath._tzpath_zones()
+    tzpath, dir_mtimes, _ = _tzpath._TZPATH_ZONES_CACHE
+
+    import hashlib
+
+    digest = hashlib.blake2b(
+        repr((tzpath, sorted(dir_mtimes.items()))).encode(
+            errors="surrogateescape"
+        ),
+        digest_size=8,
+    ).digest()
+
+    # 0 means that a bundle has no stamp
+    return int.from_bytes(digest, "little") or 1
+
+
+def _read_stamp(path):
+    try:
+        with open(path, "rb") as f:
+            header = f.read(_HEADER.size)
+    except FileNotFoundError:
+        return None
+
+    if len(header) != _HEADER.size:
+        return None
+
+    magic, version, _, _, stamp = _HEADER.unpack(header)
+    if magic != BUNDLE_MAGIC or version != BUNDLE_VERSION:
+        return None
+
+    return stamp
+
+
+def _is_utf8(key):
+    try:
+        key.encode()
+    except UnicodeEncodeError:
+        return False
+    return True
+
+
+def _tzpath_callback(tzpath):
+    global SHARED_CACHE
+
+    # The shared cache was compiled from the previous TZPATH
+    SHARED_CACHE = None
+
+
+def _read_zone(contents, offset):
+    n, m, abbr_len, tz_len = _RECORD_HEADER.unpack_from(contents, offset)
+    offset += _RECORD_HEADER.size
+    trans_list_utc = struct.unpack_from(f"<{n}q", contents, offset)
+    offset += 24 * n  # UTC and both local transition lists
+
+    utcoff = struct.unpack_from(f"<{m}l", contents, offset)
+    offset += 8 * m  # UTC and DST offsets
+    isdst = tuple(contents[offset : offset + m])
+    abbr_idx = contents[offset + m : offset + 2 * m]
+    offset += 2 * m
+    trans_idx = tuple(contents[offset : offset + n])
+    offset += n
+
+    abbr_chars = contents[offset : offset + abbr_len]
+    abbr = tuple(
+        abbr_chars[idx : abbr_chars.index(b"\x00", idx)].decode()
+        for idx in abbr_idx
+    )
+    offset += abbr_len
+
+    tz_str = contents[offset : offset + tz_len] if tz_len else None
+
+    return trans_idx, trans_list_utc, utcoff, isdst, abbr, tz_str
+
+
+_BUNDLE_CACHE = {}
+
+
+def _open_bundle(path):
+    path = os.fspath(path)
+    st = os.stat(path)
+    stat_key = (st.st_dev, st.st_ino, st.st_size, st.st_mtime_ns)
+
+    cached = _BUNDLE_CACHE.get(path, None)
+    if cached is not None and cached[0] == stat_key:
+        return cached[1:]
+
+    with open(path, "rb") as f:
+        contents = f.read()
+
+    magic, version, num_zones, index_offset, _ = _HEADER.unpack_from(
+        contents
+    )
+    if magic != BUNDLE_MAGIC:
+        raise ValueError("Invalid bundle: magic not found")
+
+    if version != BUNDLE_VERSION:
+        raise ValueError(f"Unsupported bundle version: {version}")
+
+    index = {}
+    for i in range(num_zones):
+        record_offset, key_offset, key_len = _INDEX_ENTRY.unpack_from(
+            contents, index_offset + i * _INDEX_ENTRY.size
+        )
+        index[contents[key_offset : key_offset + key_len]] = record_offset
+
+    _BUNDLE_CACHE[path] = (stat_key, contents, index)
+    return contents, index
+
+
+def _available_keys(source):
+    if source == "tzdata":
+        try:
+            from importlib import resources
+        except ImportError:
+            import importlib_resources as resources
+
+        with resources.open_text("tzdata", "zones") as f:
+            return {zone.strip() for zone in f if zone.strip()}
+
+    keys = _tzpath.available_timezones()
+    if source == "tzpath":
+        keys = {key for key in keys if _tzpath.find_tzfile(key) is not None}
+
+    return keys
+
+
+def _load_zone(key, source):
+    file_path = None
+    if source != "tzdata":
+        file_path = _tzpath.find_tzfile(key)
+
+    if file_path is not None:
+        file_obj = open(file_path, "rb")
+    elif source == "tzpath":
+        raise _common.ZoneInfoNotFoundError(
+            f"No time zone found with key {key} on TZPATH"
+        )
+    else:
+        file_obj = _common.load_tzdata(key)
+
+    with file_obj as f:
+        return _common.load_data(f)
+
+
+def _compile_zone(data):
+    # Imported here because _zoneinfo imports this module
+    from ._zoneinfo import ZoneInfo
+
+    trans_idx, trans_list_utc, utcoff, isdst, abbr, tz_str = data
+
+    dstoff = ZoneInfo._utcoff_to_dstoff(trans_idx, utcoff, isdst)
+    trans_list_wall = ZoneInfo._ts_to_local(trans_idx, trans_list_utc, utcoff)
+
+    abbr_offsets = {}
+    abbr_chars = bytearray()
+    for tzname in abbr:
+        if tzname not in abbr_offsets:
+            abbr_offsets[tzname] = len(abbr_chars)
+            abbr_chars += tzname.encode() + b"\x00"
+
+    abbr_idx = [abbr_offsets[tzname] for tzname in abbr]
+    if any(idx > 255 for idx in abbr_idx):
+        raise ValueError("Too many distinct abbreviations to bundle zone")
+
+    if not abbr_chars:
+        abbr_chars += b"\x00"
+
+    tz_str = tz_str or b""
+    n = len(trans_list_utc)
+    m = len(utcoff)
+
+    record = b"".join(
+        [
+            _RECORD_HEADER.pack(n, m, len(abbr_chars), len(tz_str)),
+            struct.pack(f"<{n}q", *trans_list_utc),
+            struct.pack(f"<{n}q", *trans_list_wall[0]),
+            struct.pack(f"<{n}q", *trans_list_wall[1]),
+            struct.pack(f"<{m}l", *utcoff),
+            struct.pack(f"<{m}l", *dstoff),
+            bytes(map(bool, isdst)),
+            bytes(abbr_idx),
+            bytes(trans_idx),
+            bytes(abbr_chars),
+            tz_str + b"\x00",
+        ]
+    )
+
+    return record + b"\x00" * (_align(len(record)) - len(record))
+
+
+def _align(size, alignment=8):
+    return (size + alignment - 1) // alignment * alignment
+
+
+_tzpath.TZPATH_CALLBACKS.append(_tzpath_callback)
+
+
+def main(argv=None):
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        prog="python -m backports.zoneinfo._bundle",
+        description="Compile time zones into a bundle that can be loaded "
+        + "with ZoneInfo.from_bundle().",
+    )
+    parser.add_argument("output", help="Path to write the bundle to")
+    parser.add_argument(
+        "keys",
+        nargs="*",
+        help="Keys of the zones to include (default: all available zones)",
+    )
+    parser.add_argument(
+        "--source",
+        choices=SOURCES,
+        default="auto",
+        help="Where to load the zones from: TZPATH, the tzdata package, or "
+        + "both, in the same order as the ZoneInfo constructor (default)",
+    )
+    args = parser.parse_args(argv)
+
+    write_bundle(args.output, keys=args.keys or None, source=args.source)
+    return 0
+
+
+if __name__ == "__main__":  # pragma: nocover
+    sys.exit(main())
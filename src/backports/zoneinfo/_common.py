@@ -1,31 +1,192 @@
+import io
+import os
 import struct
+import sys
 
 
 def load_tzdata(key):
-    try:
-        import importlib.resources as importlib_resources
-    except ImportError:
-        import importlib_resources
-
-    components = key.split("/")
-    package_name = ".".join(["tzdata.zoneinfo"] + components[:-1])
-    resource_name = components[-1]
-
-    try:
-        return importlib_resources.open_binary(package_name, resource_name)
-    except (ImportError, FileNotFoundError, UnicodeEncodeError):
-        # There are three types of exception that can be raised that all amount
-        # to "we cannot find this key":
-        #
-        # ImportError: If package_name doesn't exist (e.g. if tzdata is not
-        #   installed, or if there's an error in the folder name like
-        #   Amrica/New_York)
-        # FileNotFoundError: If resource_name doesn't exist in the package
-        #   (e.g. Europe/Krasnoy)
-        # UnicodeEncodeError: If package_name or resource_name are not UTF-8,
-        #   such as keys containing a surrogate character.
+    data = find_tzdata(key)
+    if isinstance(data, str):
+        return open(data, "rb")
+    else:
+        return io.BytesIO(data)
+
+
+def find_tzdata(key):
+    """Find the TZif data for a key in the tzdata package.
+
+    If the package is installed as a directory, this returns the path to the
+    file; otherwise, it returns the contents of the file as a bytes-like
+    object.
+    """
+    source = _get_tzdata_source()
+    if source is None:
         raise ZoneInfoNotFoundError(f"No time zone found with key {key}")
 
+    return source.find(key)
+
+
+# The tzdata source for the most recently seen tzdata module, as a tuple of
+# the module and the source
+_TZDATA_SOURCE = (None, None)
+
+
+def _get_tzdata_source():
+    global _TZDATA_SOURCE
+
+    # Setting sys.modules["tzdata"] to None blocks the import (the tests use
+    # this to simulate the package not being installed)
+    module = sys.modules.get("tzdata", False)
+    if module is False:
+        try:
+            import tzdata as module
+        except ImportError:
+            return None
+    elif module is None:
+        return None
+
+    cached_module, source = _TZDATA_SOURCE
+    if cached_module is not module:
+        source = _TZDataSource.from_module(module)
+        _TZDATA_SOURCE = (module, source)
+
+    return source
+
+
+class _TZDataSource:
+    """Loads zones from the tzdata package with importlib.resources."""
+
+    @staticmethod
+    def from_module(module):
+        # The package directory (or archive) is resolved once, so that loading
+        # a zone doesn't need to go through the import system.
+        loader = getattr(module, "__loader__", None)
+        path = getattr(module, "__path__", None)
+        if path:
+            path = list(path)[0]
+
+        archive = getattr(loader, "archive", None)
+        if archive is not None and type(loader).__name__ == "zipimporter":
+            try:
+                return _TZDataArchiveSource(archive, loader.prefix)
+            except Exception:  # pragma: nocover
+                pass
+        elif path is not None:
+            zoneinfo_dir = os.path.join(path, "zoneinfo")
+            if os.path.isdir(zoneinfo_dir):
+                return _TZDataDirectorySource(zoneinfo_dir)
+
+        return _TZDataSource()  # pragma: nocover
+
+    def find(self, key):
+        try:
+            import importlib.resources as importlib_resources
+        except ImportError:
+            import importlib_resources
+
+        components = key.split("/")
+        package_name = ".".join(["tzdata.zoneinfo"] + components[:-1])
+        resource_name = components[-1]
+
+        try:
+            return importlib_resources.read_binary(package_name, resource_name)
+        except (ImportError, FileNotFoundError, UnicodeEncodeError):
+            # There are three types of exception that can be raised that all
+            # amount to "we cannot find this key":
+            #
+            # ImportError: If package_name doesn't exist (e.g. if tzdata is not
+            #   installed, or if there's an error in the folder name like
+            #   Amrica/New_York)
+            # FileNotFoundError: If resource_name doesn't exist in the package
+            #   (e.g. Europe/Krasnoy)
+            # UnicodeEncodeError: If package_name or resource_name are not
+            #   UTF-8, such as keys containing a surrogate character.
+            raise ZoneInfoNotFoundError(f"No time zone found with key {key}")
+
+    @staticmethod
+    def _valid_key(key):
+        # Each directory in a key is a package in tzdata, so keys that could
+        # not be imported that way are not found.
+        components = key.split("/")
+        return all(
+            component and "." not in component for component in components[:-1]
+        ) and components[-1] not in ("", ".", "..")
+
+
+class _TZDataDirectorySource(_TZDataSource):
+    """Loads zones from a tzdata package installed as a directory."""
+
+    def __init__(self, zoneinfo_dir):
+        self._zoneinfo_dir = zoneinfo_dir
+
+    def find(self, key):
+        if self._valid_key(key):
+            path = os.path.join(self._zoneinfo_dir, *key.split("/"))
+            try:
+                if os.path.isfile(path):
+                    return path
+            except ValueError:  # pragma: nocover
+                pass
+
+        raise ZoneInfoNotFoundError(f"No time zone found with key {key}")
+
+
+class _TZDataArchiveSource(_TZDataSource):
+    """Loads zones from a tzdata package installed as a zip archive.
+
+    The archive is read into memory and indexed once; zones are then sliced
+    out of it (and decompressed, if necessary) by offset.
+    """
+
+    def __init__(self, archive, prefix):
+        import zipfile
+
+        with open(archive, "rb") as f:
+            contents = f.read()
+
+        package_dir = prefix + "tzdata/zoneinfo/"
+        self._contents = memoryview(contents)
+        self._members = {}
+        with zipfile.ZipFile(io.BytesIO(contents)) as zf:
+            for info in zf.infolist():
+                name = info.filename
+                if not name.startswith(package_dir) or name.endswith("/"):
+                    continue
+
+                if info.compress_type not in (
+                    zipfile.ZIP_STORED,
+                    zipfile.ZIP_DEFLATED,
+                ):  # pragma: nocover
+                    raise ValueError("Unsupported compression in tzdata")
+
+                # The data follows the local file header, whose name and
+                # extra fields may differ from the central directory's.
+                offset = info.header_offset
+                name_len, extra_len = struct.unpack_from(
+                    "<HH", contents, offset + 26
+                )
+                start = offset + 30 + name_len + extra_len
+
+                self._members[name[len(package_dir) :]] = (
+                    start,
+                    info.compress_size,
+                    info.compress_type == zipfile.ZIP_DEFLATED,
+                )
+
+    def find(self, key):
+        member = self._members.get(key, None) if self._valid_key(key) else None
+        if member is None:
+            raise ZoneInfoNotFoundError(f"No time zone found with key {key}")
+
+        start, size, deflated = member
+        data = self._contents[start : start + size]
+        if deflated:
+            import zlib
+
+            data = zlib.decompress(data, -zlib.MAX_WBITS)
+
+        return data
+
 
 def load_data(fobj):
     header = _TZifHeader.from_file(fobj)
@@ -138,6 +138,9 @@ def available_timezones():
         This may attempt to open a large number of files, since the best way to
         determine if a given file on the time zone search path is to open it
         and check for the "magic string" at the beginning.
+
+        The zones found on the time zone search path are cached until the
+        search path is changed or one of the directories on it is modified.
     """
     try:
         from importlib import resources
@@ -157,6 +160,68 @@ def available_timezones():
     except (ImportError, FileNotFoundError):
         pass
 
+    valid_zones.update(_tzpath_zones())
+
+    if "posixrules" in valid_zones:
+        # posixrules is a special symlink-only time zone where it exists, it
+        # should not be included in the output
+        valid_zones.remove("posixrules")
+
+    return valid_zones
+
+
+# The zones found on TZPATH, as a tuple of the TZPATH they were found on, the
+# modification times of the directories that were walked (None for TZPATH
+# entries that did not exist) and the set of zones.
+_TZPATH_ZONES_CACHE = None
+
+
+def _tzpath_zones():
+    global _TZPATH_ZONES_CACHE
+
+    cached = _TZPATH_ZONES_CACHE
+    if (
+        cached is not None
+        and cached[0] == TZPATH
+        and not _dirs_modified(cached[1])
+    ):
+        return cached[2]
+
+    try:
+        from ._czoneinfo import _walk_tzpath
+    except ImportError:  # pragma: nocover
+        _walk_tzpath = _walk_tzpath_py
+
+    tzpath = TZPATH
+    valid_zones = set()
+    dir_mtimes = {}
+    for tz_root in tzpath:
+        if not os.path.exists(tz_root):
+            dir_mtimes[tz_root] = None
+            continue
+
+        keys, root_dir_mtimes = _walk_tzpath(tz_root)
+        valid_zones.update(keys)
+        dir_mtimes.update(root_dir_mtimes)
+
+    valid_zones = frozenset(valid_zones)
+    _TZPATH_ZONES_CACHE = (tzpath, dir_mtimes, valid_zones)
+    return valid_zones
+
+
+def _dirs_modified(dir_mtimes):
+    for path, mtime in dir_mtimes.items():
+        try:
+            if os.stat(path).st_mtime_ns != mtime:
+                return True
+        except OSError:
+            if mtime is not None:
+                return True
+
+    return False
+
+
+def _walk_tzpath_py(tz_root):
     def valid_key(fpath):
         try:
             with open(fpath, "rb") as f:
@@ -164,38 +229,33 @@ def available_timezones():
         except Exception:  # pragma: nocover
             return False
 
-    for tz_root in TZPATH:
-        if not os.path.exists(tz_root):
-            continue
-
-        for root, dirnames, files in os.walk(tz_root):
-            if root == tz_root:
-                # right/ and posix/ are special directories and shouldn't be
-                # included in the output of available zones
-                if "right" in dirnames:
-                    dirnames.remove("right")
-                if "posix" in dirnames:
-                    dirnames.remove("posix")
+    valid_zones = []
+    dir_mtimes = {}
+    for root, dirnames, files in os.walk(tz_root):
+        try:
+            dir_mtimes[root] = os.stat(root).st_mtime_ns
+        except OSError:  # pragma: nocover
+            pass
 
-            for file in files:
-                fpath = os.path.join(root, file)
+        if root == tz_root:
+            # right/ and posix/ are special directories and shouldn't be
+            # included in the output of available zones
+            if "right" in dirnames:
+                dirnames.remove("right")
+            if "posix" in dirnames:
+                dirnames.remove("posix")
 
-                key = os.path.relpath(fpath, start=tz_root)
-                if os.sep != "/":  # pragma: nocover
-                    key = key.replace(os.sep, "/")
+        for file in files:
+            fpath = os.path.join(root, file)
 
-                if not key or key in valid_zones:
-                    continue
+            key = os.path.relpath(fpath, start=tz_root)
+            if os.sep != "/":  # pragma: nocover
+                key = key.replace(os.sep, "/")
 
-                if valid_key(fpath):
-                    valid_zones.add(key)
+            if key and valid_key(fpath):
+                valid_zones.append(key)
 
-    if "posixrules" in valid_zones:
-        # posixrules is a special symlink-only time zone where it exists, it
-        # should not be included in the output
-        valid_zones.remove("posixrules")
-
-    return valid_zones
+    return valid_zones, dir_mtimes
 
 
 class InvalidTZPathWarning(RuntimeWarning):
@@ -0,0 +1,275 @@
+"""Evicting zones from the cache when their files on TZPATH change.
+
+A watcher (see ``ZoneInfo.watch_tzpath``) keeps a snapshot of the files on
+TZPATH, and compares it with a new one whenever something may have changed:
+on Linux, whenever inotify reports a change in one of the directories on
+TZPATH, and elsewhere every ``interval`` seconds. Comparing snapshots rather
+than interpreting the events means that zones which are links to a modified
+file are evicted along with it, and that no event needs to be understood.
+"""
+
+import os
+import threading
+
+from . import _bundle, _tzpath
+
+DEFAULT_INTERVAL = 60.0
+
+# Changes usually come in bursts (e.g. from a package update), so the watcher
+# waits until there have been no events for this long before it looks for
+# them.
+_SETTLE_TIME = 0.1
+
+
+class TZPathWatcher:
+    """Evicts changed zones from the caches of a ZoneInfo class.
+
+    The zones are evicted from the caches of the class and all of its
+    subclasses. If ``reload`` is true, the zones that were evicted are then
+    loaded again, so that the next lookup is not a cache miss.
+    """
+
+    def __init__(self, cls, *, reload=False, interval=None):
+        if interval is None:
+            interval = DEFAULT_INTERVAL
+        elif interval <= 0:
+            raise ValueError("interval must be greater than 0")
+
+        self._cls = cls
+        self._reload = reload
+        self._interval = interval
+        self._lock = threading.Lock()
+        self._stopped = threading.Event()
+
+        self._inotify = _get_inotify()
+        self._inotify_fd = None
+        self._wake_fds = None
+        if self._inotify is not None:
+            inotify_init, _ = self._inotify
+            self._inotify_fd = inotify_init()
+            self._wake_fds = os.pipe()
+            for fd in self._wake_fds:
+                os.set_blocking(fd, False)
+
+        self._tzpath = None
+        self._snapshot = {}
+        self._watch_descriptors = set()
+        self.check()
+
+        _tzpath.TZPATH_CALLBACKS.append(self._tzpath_callback)
+        self._thread = threading.Thread(
+            target=self._run, name="zoneinfo-tzpath-watcher", daemon=True
+        )
+        self._thread.start()
+
+    def check(self):
+        """Looks for changes immediately, evicting any changed zones.
+
+        Returns the keys whose files changed since the last check.
+        """
+        with self._lock:
+            while True:
+                tzpath = _tzpath.TZPATH
+                snapshot, dirs = _take_snapshot(tzpath)
+
+                # If new directories are watched, files may have been added
+                # to them before the watches were, so take another snapshot
+                if not self._watch_dirs(dirs):
+                    break
+
+            if tzpath != self._tzpath:
+                # Changing TZPATH does not invalidate the cache (see
+                # reset_tzpath), so there is nothing to compare with
+                changed = set()
+            else:
+                changed = {
+                    key
+                    for key in snapshot.keys() | self._snapshot.keys()
+                    if snapshot.get(key) != self._snapshot.get(key)
+                }
+
+            self._tzpath = tzpath
+            self._snapshot = snapshot
+
+            if changed:
+                self._evict(changed)
+
+            return changed
+
+    def stop(self):
+        """Stops watching TZPATH."""
+        if self._stopped.is_set():
+            return
+
+        self._stopped.set()
+        try:
+            _tzpath.TZPATH_CALLBACKS.remove(self._tzpath_callback)
+        except ValueError:  # pragma: nocover
+            pass
+
+        self._wake()
+
+        if self._thread is not threading.current_thread():
+            self._thread.join()
+
+        if self._inotify_fd is not None:
+            os.close(self._inotify_fd)
+            os.close(self._wake_fds[0])
+            os.close(self._wake_fds[1])
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.stop()
+
+    def _evict(self, keys):
+        # A shared cache must be rebuilt first, since zones are loaded from it
+        # in preference to the files, and so must the C extension's listings
+        # of the directories the files are in.
+        shared_cache = _bundle.SHARED_CACHE
+        if shared_cache is not None:
+            _bundle.set_shared_cache(shared_cache)
+
+        forget_tzpath_dirs = _get_forget_tzpath_dirs()
+        if forget_tzpath_dirs is not None:
+            forget_tzpath_dirs(keys)
+
+        classes = [self._cls]
+        for cls in classes:
+            classes.extend(cls.__subclasses__())
+
+            evicted = cls._evict_keys(keys)
+            if self._reload:
+                for key in evicted:
+                    try:
+                        cls(key)
+                    except Exception:
+                        # The zone may have been removed
+                        pass
+
+    def _watch_dirs(self, dirs):
+        if self._inotify_fd is None:
+            return False
+
+        # Adding a watch for a directory that is already watched returns the
+        # existing watch descriptor, so this also catches directories that
+        # were removed and created again
+        _, inotify_add_watch = self._inotify
+        new_dirs = False
+        for path in dirs:
+            try:
+                wd = inotify_add_watch(self._inotify_fd, path)
+            except OSError:
+                # It was removed after the snapshot was taken
+                continue
+
+            if wd not in self._watch_descriptors:
+                self._watch_descriptors.add(wd)
+                new_dirs = True
+
+        return new_dirs
+
+    def _tzpath_callback(self, tzpath):
+        self._wake()
+
+    def _wake(self):
+        if self._wake_fds is not None:
+            try:
+                os.write(self._wake_fds[1], b"\x00")
+            except BlockingIOError:
+                # The watcher has already been woken
+                pass
+
+    def _run(self):
+        while not self._stopped.is_set():
+            if self._inotify_fd is None:
+                if self._stopped.wait(self._interval):
+                    break
+            else:
+                self._wait_for_events()
+                if self._stopped.is_set():
+                    break
+
+            self.check()
+
+    def _wait_for_events(self):
+        import select
+
+        fds = [self._inotify_fd, self._wake_fds[0]]
+        readable, _, _ = select.select(fds, [], [])
+        while readable:
+            for fd in readable:
+                _drain(fd)
+
+            if self._stopped.is_set():
+                return
+
+            readable, _, _ = select.select(fds, [], [], _SETTLE_TIME)
+
+
+def _get_inotify():
+    # This is imported lazily because the C extension imports this module
+    try:
+        from ._czoneinfo import _inotify_add_watch, _inotify_init
+    except ImportError:
+        return None
+
+    return _inotify_init, _inotify_add_watch
+
+
+def _get_forget_tzpath_dirs():
+    # This is imported lazily for the same reason as in _get_inotify
+    try:
+        from ._czoneinfo import _forget_tzpath_dirs
+    except ImportError:
+        return None
+
+    return _forget_tzpath_dirs
+
+
+def _take_snapshot(tzpath):
+    """Finds the files on TZPATH.
+
+    Returns a dict mapping the key of each file found to its identity (the
+    TZPATH entry it was found in, which is the first that contains it, and
+    the results of stat), and the list of the directories that were walked.
+    """
+    files = {}
+    dirs = []
+    for tz_root in tzpath:
+        for root, _, filenames in os.walk(tz_root):
+            dirs.append(root)
+            for filename in filenames:
+                path = os.path.join(root, filename)
+
+                key = os.path.relpath(path, start=tz_root)
+                if os.sep != "/":  # pragma: nocover
+                    key = key.replace(os.sep, "/")
+
+                if key in files:
+                    continue
+
+                try:
+                    # This follows links, so changes to their targets count
+                    st = os.stat(path)
+                except OSError:
+                    continue
+
+                files[key] = (
+                    tz_root,
+                    st.st_dev,
+                    st.st_ino,
+                    st.st_size,
+                    st.st_mtime_ns,
+                )
+
+    return files, dirs
+
+
+def _drain(fd):
+    try:
+        while os.read(fd, 4096):
+            pass
+    except BlockingIOError:
+        pass
@@ -2,11 +2,12 @@ import bisect
 import calendar
 import collections
 import functools
+import os
 import re
 import weakref
 from datetime import datetime, timedelta, tzinfo
 
-from . import _common, _tzpath
+from . import _bundle, _common, _tzpath, _watch
 
 EPOCH = datetime(1970, 1, 1)
 EPOCHORDINAL = datetime(1970, 1, 1).toordinal()
@@ -27,6 +28,78 @@ def _load_timedelta(seconds):
     return timedelta(seconds=seconds)
 
 
+def _timedelta_cache_info():
+    info = _load_timedelta.cache_info()
+    return {
+        "hits": info.hits,
+        "misses": info.misses,
+        "currsize": info.currsize,
+        "maxsize": info.maxsize,
+    }
+
+
+_ONE_SECOND = timedelta(seconds=1)
+
+
+def _batch_buffer(obj, name, itemsize, formats, writable=False):
+    """Get a flat view of an array for ZoneInfo's batch lookups.
+
+    The items must be `itemsize` bytes long and have one of the native struct
+    formats in `formats`.
+    """
+    view = memoryview(obj)
+    if not view.c_contiguous:
+        raise BufferError(f"{name} is not C-contiguous")
+    if writable and view.readonly:
+        raise BufferError(f"{name} is not writable")
+
+    fmt = view.format[1:] if view.format.startswith("@") else view.format
+    if view.itemsize != itemsize or len(fmt) != 1 or fmt not in formats:
+        raise TypeError(
+            f"{name} must be a buffer of {itemsize}-byte items with one of "
+            f"the formats '{formats}', not '{view.format}'"
+        )
+
+    return view.cast("B").cast(fmt)
+
+
+def _check_batch_length(view, name, n, input="timestamps"):
+    if len(view) != n:
+        raise ValueError(f"{name} must have the same length as {input}")
+
+
+def _year_of_timestamp(timestamp):
+    """Get the year of a timestamp (UTC or local) in seconds since 1970."""
+    return (EPOCH + timedelta(seconds=timestamp)).year
+
+
+def _timestamp_year(timestamp, i, input="timestamps"):
+    """Get the year of the timestamp at index `i` of a batch lookup."""
+    try:
+        return _year_of_timestamp(timestamp)
+    except OverflowError:
+        raise OverflowError(
+            f"{input}[{i}] is out of the range of datetime"
+        ) from None
+
+
+# The range of timestamps that datetime can represent
+_MIN_TIMESTAMP = (datetime.min - EPOCH) // _ONE_SECOND
+_MAX_TIMESTAMP = (datetime.max - EPOCH) // _ONE_SECOND
+
+# The policies of ZoneInfo.toutc_timestamps for local times in gaps and folds,
+# and the UTC timestamp written for those that they mask (NumPy's NaT)
+_GAP_POLICIES = ("raise", "shift_forward", "shift_backward", "mask")
+_FOLD_POLICIES = ("raise", "earliest", "latest", "mask")
+_MASKED_TIMESTAMP = -(2 ** 63)
+
+
+# The result of ZoneInfo.lookup
+LookupResult = collections.namedtuple(
+    "LookupResult", ["utcoffset", "dst", "tzname", "in_fold", "in_gap"]
+)
+
+
 class ZoneInfo(tzinfo):
     _strong_cache_size = 8
     _strong_cache = collections.OrderedDict()
@@ -62,6 +135,13 @@ class ZoneInfo(tzinfo):
     def _new_instance(cls, key):
         obj = super().__new__(cls)
         obj._key = key
+
+        shared_data = _bundle.load_shared_zone_data(key)
+        if shared_data is not None:
+            obj._file_path = None
+            obj._load_data(*shared_data)
+            return obj
+
         obj._file_path = obj._find_tzfile(key)
 
         if obj._file_path is not None:
@@ -87,6 +167,50 @@ class ZoneInfo(tzinfo):
 
         return obj
 
+    @classmethod
+    def from_bundle(cls, path, key):
+        obj = super().__new__(cls)
+        obj._key = key
+        obj._file_path = None
+        obj._load_data(*_bundle.load_zone_data(path, key))
+
+        # Like objects created from files, these can't be pickled by key
+        obj.__reduce__ = obj._file_reduce
+
+        return obj
+
+    @classmethod
+    def preload(cls, keys, workers=None, *, freeze=False):
+        if workers is None:
+            workers = os.cpu_count() or 1
+        elif workers <= 0:
+            raise ValueError("workers must be greater than 0")
+
+        keys = list(keys)
+        missing = [
+            key
+            for key in dict.fromkeys(keys)
+            if cls._weak_cache.get(key, None) is None
+        ]
+
+        # The files are read and parsed on the worker threads, but the zones
+        # are added to the cache on this thread, in order. The new zones are
+        # kept alive until the constructor has added them to the strong cache.
+        loaded = []
+        if missing:
+            from concurrent.futures import ThreadPoolExecutor
+
+            with ThreadPoolExecutor(max_workers=workers) as executor:
+                instances = executor.map(cls._new_instance, missing)
+                for key, instance in zip(missing, instances):
+                    instance = cls._weak_cache.setdefault(key, instance)
+                    instance._from_cache = True
+                    loaded.append(instance)
+
+        # Every zone is fully built when it is loaded, so there is nothing to
+        # freeze: freeze only changes the memory layout of the C extension
+        return [cls(key) for key in keys]
+
     @classmethod
     def clear_cache(cls, *, only_keys=None):
         if only_keys is not None:
@@ -98,6 +222,21 @@ class ZoneInfo(tzinfo):
             cls._weak_cache.clear()
             cls._strong_cache.clear()
 
+    @classmethod
+    def _evict_keys(cls, keys):
+        evicted = []
+        for key in keys:
+            # Popping from the strong cache may drop the last reference
+            if cls._weak_cache.pop(key, None) is not None:
+                evicted.append(key)
+            cls._strong_cache.pop(key, None)
+
+        return evicted
+
+    @classmethod
+    def watch_tzpath(cls, *, reload=False, interval=None):
+        return _watch.TZPathWatcher(cls, reload=reload, interval=interval)
+
     @property
     def key(self):
         return self._key
@@ -111,6 +250,33 @@ class ZoneInfo(tzinfo):
     def tzname(self, dt):
         return self._find_trans(dt).tzname
 
+    def lookup(self, dt):
+        """Look up the UTC offset, DST and abbreviation at a local datetime.
+
+        This also determines whether the datetime is in a fold or a gap.
+        """
+        if not isinstance(dt, datetime):
+            raise TypeError("lookup() requires a datetime argument")
+
+        tti = self._find_trans(dt)
+
+        # The offsets for fold=0 and fold=1 only differ in a fold, where
+        # fold=0 gets the larger offset from before the transition, and in a
+        # gap, where it gets the smaller one.
+        tti_other = self._find_trans(dt.replace(fold=1 - dt.fold))
+        if dt.fold:
+            utcoff_0, utcoff_1 = tti_other.utcoff, tti.utcoff
+        else:
+            utcoff_0, utcoff_1 = tti.utcoff, tti_other.utcoff
+
+        return LookupResult(
+            tti.utcoff,
+            tti.dstoff,
+            tti.tzname,
+            utcoff_0 > utcoff_1,
+            utcoff_0 < utcoff_1,
+        )
+
     def fromutc(self, dt):
         """Convert from datetime in UTC to datetime in local time"""
 
@@ -119,7 +285,172 @@ class ZoneInfo(tzinfo):
         if dt.tzinfo is not self:
             raise ValueError("dt.tzinfo is not self")
 
-        timestamp = self._get_local_timestamp(dt)
+        tti, fold = self._find_trans_utc(self._get_local_timestamp(dt), None)
+        dt += tti.utcoff
+        if fold:
+            return dt.replace(fold=1)
+        else:
+            return dt
+
+    def utcoffsets(self, timestamps, offsets, isdst=None):
+        """Find the UTC offsets at an array of UTC timestamps.
+
+        The offsets in seconds are written to the array of 32-bit integers
+        `offsets`, and if `isdst` is given, whether DST is in effect at each
+        timestamp is written to it.
+        """
+        timestamps = _batch_buffer(timestamps, "timestamps", 8, "lqn")
+        offsets = _batch_buffer(offsets, "offsets", 4, "il", writable=True)
+        if isdst is not None:
+            isdst = _batch_buffer(isdst, "isdst", 1, "?bB", writable=True)
+
+        _check_batch_length(offsets, "offsets", len(timestamps))
+        if isdst is not None:
+            _check_batch_length(isdst, "isdst", len(timestamps))
+
+        for i, timestamp in enumerate(timestamps):
+            tti, _ = self._find_trans_utc(
+                timestamp, _timestamp_year(timestamp, i)
+            )
+            offsets[i] = tti.utcoff // _ONE_SECOND
+            if isdst is not None:
+                isdst[i] = bool(tti.dstoff)
+
+    def fromutc_timestamps(self, timestamps, local, fold=None):
+        """Convert an array of UTC timestamps to local timestamps.
+
+        The local timestamps (in seconds since 1970-01-01 in local time) are
+        written to the array of 64-bit integers `local`, and if `fold` is
+        given, the fold of each local time is written to it.
+        """
+        timestamps = _batch_buffer(timestamps, "timestamps", 8, "lqn")
+        local = _batch_buffer(local, "local", 8, "lqn", writable=True)
+        if fold is not None:
+            fold = _batch_buffer(fold, "fold", 1, "?bB", writable=True)
+
+        _check_batch_length(local, "local", len(timestamps))
+        if fold is not None:
+            _check_batch_length(fold, "fold", len(timestamps))
+
+        for i, timestamp in enumerate(timestamps):
+            tti, tti_fold = self._find_trans_utc(
+                timestamp, _timestamp_year(timestamp, i)
+            )
+            local[i] = timestamp + tti.utcoff // _ONE_SECOND
+            if fold is not None:
+                fold[i] = bool(tti_fold)
+
+    def toutc_timestamps(
+        self,
+        local,
+        utc,
+        *,
+        nonexistent="raise",
+        ambiguous="raise",
+        in_gap=None,
+        in_fold=None,
+    ):
+        """Convert an array of local timestamps to UTC timestamps.
+
+        The UTC timestamps are written to the array of 64-bit integers `utc`.
+        Local times in gaps are resolved by the `nonexistent` policy and those
+        in folds by the `ambiguous` policy or array of folds, and if `in_gap`
+        or `in_fold` are given, which local times were in gaps or folds is
+        written to them.
+        """
+        if nonexistent not in _GAP_POLICIES:
+            raise ValueError(f"invalid nonexistent policy: {nonexistent!r}")
+        if isinstance(ambiguous, str) and ambiguous not in _FOLD_POLICIES:
+            raise ValueError(f"invalid ambiguous policy: {ambiguous!r}")
+
+        local = _batch_buffer(local, "local", 8, "lqn")
+        utc = _batch_buffer(utc, "utc", 8, "lqn", writable=True)
+        folds = None
+        if not isinstance(ambiguous, str):
+            folds = _batch_buffer(ambiguous, "ambiguous", 1, "?bB")
+        if in_gap is not None:
+            in_gap = _batch_buffer(in_gap, "in_gap", 1, "?bB", writable=True)
+        if in_fold is not None:
+            in_fold = _batch_buffer(in_fold, "in_fold", 1, "?bB", writable=True)
+
+        for name, view in (
+            ("utc", utc),
+            ("ambiguous", folds),
+            ("in_gap", in_gap),
+            ("in_fold", in_fold),
+        ):
+            if view is not None:
+                _check_batch_length(view, name, len(local), "local")
+
+        for i, timestamp in enumerate(local):
+            year = _timestamp_year(timestamp, i, "local")
+            off_0, off_1 = (
+                self._find_trans_local(timestamp, year, fold).utcoff
+                // _ONE_SECOND
+                for fold in (0, 1)
+            )
+
+            if off_0 < off_1:
+                if nonexistent == "raise":
+                    raise ValueError(
+                        f"local[{i}] does not exist (it is in a gap)"
+                    )
+                elif nonexistent == "mask":
+                    result = _MASKED_TIMESTAMP
+                else:
+                    result = self._find_gap_transition(timestamp, off_0, off_1)
+                    if nonexistent == "shift_backward":
+                        result -= 1
+            elif off_0 > off_1:
+                if folds is not None:
+                    result = timestamp - (off_1 if folds[i] else off_0)
+                elif ambiguous == "raise":
+                    raise ValueError(
+                        f"local[{i}] is ambiguous (it is in a fold)"
+                    )
+                elif ambiguous == "mask":
+                    result = _MASKED_TIMESTAMP
+                else:
+                    fold = ambiguous == "latest"
+                    result = timestamp - (off_1 if fold else off_0)
+            else:
+                result = timestamp - off_0
+
+            utc[i] = result
+            if in_gap is not None:
+                in_gap[i] = off_0 < off_1
+            if in_fold is not None:
+                in_fold[i] = off_0 > off_1
+
+    def _find_gap_transition(self, timestamp, off_before, off_after):
+        """Find the UTC timestamp of the transition creating a gap.
+
+        That is the first UTC timestamp in the interval
+        (timestamp - off_after, timestamp - off_before] at which the offset
+        is off_after, which is found by bisection.
+        """
+        before = timestamp - off_after
+        after = timestamp - off_before
+        while after - before > 1:
+            mid = (before + after) // 2
+
+            # Shifting local times near the ends of the range of datetime by
+            # their offsets can leave it
+            clamped = min(max(mid, _MIN_TIMESTAMP), _MAX_TIMESTAMP)
+            year = _year_of_timestamp(clamped)
+            tti, _ = self._find_trans_utc(mid, year)
+            if tti.utcoff // _ONE_SECOND == off_after:
+                after = mid
+            else:
+                before = mid
+
+        return after
+
+    def _find_trans_utc(self, timestamp, year):
+        """Find the ttinfo and fold at a UTC timestamp in the given year.
+
+        If `year` is None, it is calculated from the timestamp when needed.
+        """
         num_trans = len(self._trans_utc)
 
         if num_trans >= 1 and timestamp < self._trans_utc[0]:
@@ -128,9 +459,9 @@ class ZoneInfo(tzinfo):
         elif (
             num_trans == 0 or timestamp > self._trans_utc[-1]
         ) and not isinstance(self._tz_after, _ttinfo):
-            tti, fold = self._tz_after.get_trans_info_fromutc(
-                timestamp, dt.year
-            )
+            if year is None:
+                year = _year_of_timestamp(timestamp)
+            tti, fold = self._tz_after.get_trans_info_fromutc(timestamp, year)
         elif num_trans == 0:
             tti = self._tz_after
             fold = 0
@@ -149,11 +480,8 @@ class ZoneInfo(tzinfo):
             # Detect fold
             shift = tti_prev.utcoff - tti.utcoff
             fold = shift.total_seconds() > timestamp - self._trans_utc[idx - 1]
-        dt += tti.utcoff
-        if fold:
-            return dt.replace(fold=1)
-        else:
-            return dt
+
+        return tti, fold
 
     def _find_trans(self, dt):
         if dt is None:
@@ -162,9 +490,19 @@ class ZoneInfo(tzinfo):
             else:
                 return _NO_TTINFO
 
-        ts = self._get_local_timestamp(dt)
+        # The year is calculated from the timestamp rather than read from
+        # dt.year, which a subclass that overrides toordinal() may not keep
+        # consistent with it
+        return self._find_trans_local(
+            self._get_local_timestamp(dt), None, dt.fold
+        )
+
+    def _find_trans_local(self, ts, year, fold):
+        """Find the ttinfo at a local timestamp in the given year and fold.
 
-        lt = self._trans_local[dt.fold]
+        If `year` is None, it is calculated from the timestamp when needed.
+        """
+        lt = self._trans_local[fold]
 
         num_trans = len(lt)
 
@@ -172,7 +510,9 @@ class ZoneInfo(tzinfo):
             return self._tti_before
         elif not num_trans or ts > lt[-1]:
             if isinstance(self._tz_after, _TZStr):
-                return self._tz_after.get_trans_info(ts, dt.year, dt.fold)
+                if year is None:
+                    year = _year_of_timestamp(ts)
+                return self._tz_after.get_trans_info(ts, year, fold)
             else:
                 return self._tz_after
         else:
@@ -224,9 +564,9 @@ class ZoneInfo(tzinfo):
 
     def _load_file(self, fobj):
         # Retrieve all the data as it exists in the zoneinfo file
-        trans_idx, trans_utc, utcoff, isdst, abbr, tz_str = _common.load_data(
-            fobj
-        )
+        self._load_data(*_common.load_data(fobj))
+
+    def _load_data(self, trans_idx, trans_utc, utcoff, isdst, abbr, tz_str):
 
         # Infer the DST offsets (needed for .dst()) from the data
         dstoff = self._utcoff_to_dstoff(trans_idx, utcoff, isdst)
@@ -1,3 +1,4 @@
+import array
 import base64
 import contextlib
 import dataclasses
@@ -10,8 +11,10 @@ import pickle
 import re
 import shutil
 import struct
+import sys
 import tempfile
 import unittest
+import zipfile
 from datetime import date, datetime, time, timedelta, timezone
 
 from . import _support as test_support
@@ -44,7 +47,9 @@ ZONEINFO_JSON = DATA_DIR / "zoneinfo_data.json"
 
 # Useful constants
 ZERO = timedelta(0)
+ONE_SECOND = timedelta(seconds=1)
 ONE_H = timedelta(hours=1)
+EPOCH_UTC = datetime(1970, 1, 1, tzinfo=timezone.utc)
 
 
 def setUpModule():
@@ -366,6 +371,290 @@ class ZoneInfoTest(TzPathUserMixin, ZoneInfoTestBase):
                     self.assertEqual(dt.utcoffset(), offset.utcoffset, dt)
                     self.assertEqual(dt.dst(), offset.dst, dt)
 
+    def test_lookup(self):
+        for key in self.zones():
+            zi = self.zone_from_key(key)
+            for zt in self.load_transition_examples(key):
+                in_anomaly = zt.fold or zt.gap
+                cases = [
+                    (zt.anomaly_start - timedelta(seconds=1), False),
+                    (zt.anomaly_start, in_anomaly),
+                    (zt.anomaly_end - timedelta(seconds=1), in_anomaly),
+                    (zt.anomaly_end, False),
+                ]
+
+                for dt, anomaly in cases:
+                    for fold in (0, 1):
+                        dt = dt.replace(tzinfo=zi, fold=fold)
+                        with self.subTest(key=key, dt=dt, fold=fold):
+                            result = zi.lookup(dt)
+
+                            self.assertEqual(result.utcoffset, dt.utcoffset())
+                            self.assertEqual(result.dst, dt.dst())
+                            self.assertEqual(result.tzname, dt.tzname())
+                            self.assertIs(result.in_fold, anomaly and zt.fold)
+                            self.assertIs(result.in_gap, anomaly and zt.gap)
+                            self.assertEqual(
+                                tuple(result),
+                                (
+                                    dt.utcoffset(),
+                                    dt.dst(),
+                                    dt.tzname(),
+                                    result.in_fold,
+                                    result.in_gap,
+                                ),
+                            )
+
+    def test_lookup_fixed_offset(self):
+        for key, offset in self.fixed_offset_zones():
+            zi = self.zone_from_key(key)
+            dt = datetime(2020, 1, 1, tzinfo=zi)
+            expected = (offset.utcoffset, offset.dst, offset.tzname)
+            with self.subTest(key=key):
+                self.assertEqual(
+                    tuple(zi.lookup(dt)), expected + (False, False)
+                )
+
+    def test_lookup_not_datetime(self):
+        zi = self.zone_from_key("UTC")
+        for arg in [None, time(12, tzinfo=zi), date(2020, 1, 1)]:
+            with self.subTest(arg=arg):
+                with self.assertRaises(TypeError):
+                    zi.lookup(arg)
+
+    def batch_timestamps(self, key):
+        """UTC timestamps around the transitions of a zone for the batch
+        lookups, followed by historical and future ones in an unsorted order
+        (and more of them than the C implementation looks up while holding
+        the GIL)."""
+        timestamps = []
+        for zt in self.load_transition_examples(key):
+            trans_ts = (zt.transition_utc - EPOCH_UTC) // ONE_SECOND
+            for delta in (-86400, -3600, -1, 0, 1, 3600, 86400):
+                timestamps.append(trans_ts + delta)
+        for i in range(5000):
+            timestamps.append((i * 7919 % 5000 - 2500) * 1234567)
+
+        return array.array("q", timestamps)
+
+    def test_utcoffsets(self):
+        for key in self.zones():
+            zi = self.zone_from_key(key)
+            timestamps = self.batch_timestamps(key)
+            offsets = array.array("i", [0]) * len(timestamps)
+            isdst = bytearray(len(timestamps))
+            zi.utcoffsets(timestamps, offsets, isdst)
+
+            with self.subTest(key=key):
+                for ts, offset, dst in zip(timestamps, offsets, isdst):
+                    dt = (EPOCH_UTC + timedelta(seconds=ts)).astimezone(zi)
+                    expected = dt.utcoffset() // ONE_SECOND
+                    self.assertEqual(offset, expected, dt)
+                    self.assertEqual(dst, bool(dt.dst()), dt)
+
+    def test_fromutc_timestamps(self):
+        epoch = datetime(1970, 1, 1)
+        for key in self.zones():
+            zi = self.zone_from_key(key)
+            timestamps = self.batch_timestamps(key)
+            local = array.array("q", [0]) * len(timestamps)
+            fold = bytearray(len(timestamps))
+            zi.fromutc_timestamps(timestamps, local, fold)
+
+            with self.subTest(key=key):
+                for ts, local_ts, local_fold in zip(timestamps, local, fold):
+                    dt = (EPOCH_UTC + timedelta(seconds=ts)).astimezone(zi)
+                    expected = (dt.replace(tzinfo=None) - epoch) // ONE_SECOND
+                    self.assertEqual(local_ts, expected, dt)
+                    self.assertEqual(local_fold, dt.fold, dt)
+
+    def test_utcoffsets_fixed_offset(self):
+        timestamps = array.array("q", [-(2 ** 35), 0, 1577836800, 2 ** 35])
+        for key, offset in self.fixed_offset_zones():
+            zi = self.zone_from_key(key)
+            offsets = array.array("i", [0]) * len(timestamps)
+            isdst = array.array("b", [-1]) * len(timestamps)
+            zi.utcoffsets(timestamps, offsets, isdst=isdst)
+
+            expected = offset.utcoffset // ONE_SECOND
+            with self.subTest(key=key):
+                self.assertEqual(list(offsets), [expected] * len(timestamps))
+                self.assertEqual(
+                    list(isdst), [bool(offset.dst)] * len(timestamps)
+                )
+
+    def test_utcoffsets_invalid(self):
+        zi = self.zone_from_key("America/Los_Angeles")
+        timestamps = array.array("q", [0, 1])
+        offsets = array.array("i", [0, 0])
+
+        bad_args = [
+            (TypeError, (array.array("d", [0, 1]), offsets)),
+            (TypeError, (array.array("i", [0, 1]), offsets)),
+            (TypeError, (timestamps, array.array("q", [0, 0]))),
+            (TypeError, (timestamps, offsets, array.array("i", [0, 0]))),
+            (TypeError, ([0, 1], offsets)),
+            (BufferError, (timestamps, bytes(8))),
+            (ValueError, (timestamps, array.array("i", [0]))),
+            (ValueError, (timestamps, offsets, bytearray(3))),
+            (OverflowError, (array.array("q", [0, 2 ** 40]), offsets)),
+            (OverflowError, (array.array("q", [-(2 ** 40)]), offsets[:1])),
+        ]
+
+        for exc_type, args in bad_args:
+            with self.subTest(args=args):
+                with self.assertRaises(exc_type):
+                    zi.utcoffsets(*args)
+
+        zi.utcoffsets(array.array("q"), array.array("i"))
+
+    def test_fromutc_timestamps_invalid(self):
+        zi = self.zone_from_key("America/Los_Angeles")
+        timestamps = array.array("q", [0, 1])
+        local = array.array("q", [0, 0])
+
+        bad_args = [
+            (TypeError, (array.array("d", [0, 1]), local)),
+            (TypeError, (timestamps, array.array("i", [0, 0]))),
+            (TypeError, (timestamps, local, array.array("i", [0, 0]))),
+            (BufferError, (timestamps, bytes(16))),
+            (ValueError, (timestamps, array.array("q", [0]))),
+            (ValueError, (timestamps, local, bytearray(3))),
+            (OverflowError, (array.array("q", [0, 2 ** 40]), local)),
+        ]
+
+        for exc_type, args in bad_args:
+            with self.subTest(args=args):
+                with self.assertRaises(exc_type):
+                    zi.fromutc_timestamps(*args)
+
+    def test_toutc_timestamps(self):
+        epoch = datetime(1970, 1, 1)
+        for key in self.zones():
+            zi = self.zone_from_key(key)
+            # The batch timestamps are read as local times here, with local
+            # times in the gaps and folds of the transition examples added
+            local = self.batch_timestamps(key)
+            for zt in self.load_transition_examples(key):
+                start = (zt.anomaly_start - epoch) // ONE_SECOND
+                end = (zt.anomaly_end - epoch) // ONE_SECOND
+                local.extend([start, (start + end) // 2, end - 1])
+
+            n = len(local)
+            folds = bytes(i % 2 for i in range(n))
+            forward = array.array("q", [0]) * n
+            backward = array.array("q", [0]) * n
+            in_gap, in_fold = bytearray(n), bytearray(n)
+            zi.toutc_timestamps(
+                local,
+                forward,
+                nonexistent="shift_forward",
+                ambiguous=folds,
+                in_gap=in_gap,
+                in_fold=in_fold,
+            )
+            zi.toutc_timestamps(
+                local,
+                backward,
+                nonexistent="shift_backward",
+                ambiguous="latest",
+            )
+
+            with self.subTest(key=key):
+                for i, ts in enumerate(local):
+                    dt = (epoch + timedelta(seconds=ts)).replace(tzinfo=zi)
+                    result = zi.lookup(dt)
+                    self.assertEqual(in_gap[i], result.in_gap, dt)
+                    self.assertEqual(in_fold[i], result.in_fold, dt)
+                    if not result.in_gap:
+                        expected = dt.replace(fold=folds[i]) - EPOCH_UTC
+                        self.assertEqual(forward[i] * ONE_SECOND, expected, dt)
+                        expected = dt.replace(fold=1) - EPOCH_UTC
+                        self.assertEqual(backward[i] * ONE_SECOND, expected, dt)
+                        continue
+
+                    # The offset changes from the one with fold=0 to the one
+                    # with fold=1 at the transition that created the gap
+                    self.assertEqual(backward[i], forward[i] - 1, dt)
+                    for utc_ts, fold in [(backward[i], 0), (forward[i], 1)]:
+                        utc_dt = EPOCH_UTC + timedelta(seconds=utc_ts)
+                        self.assertEqual(
+                            utc_dt.astimezone(zi).utcoffset(),
+                            dt.replace(fold=fold).utcoffset(),
+                            dt,
+                        )
+
+    def test_toutc_timestamps_policies(self):
+        zi = self.zone_from_key("America/Los_Angeles")
+        # 2020-03-08 02:30 (in a gap), 2020-11-01 01:30 (in a fold) and
+        # 2020-06-01 12:00
+        local = array.array("q", [1583634600, 1604194200, 1591012800])
+        gap, fold, normal = 1583661600, 1604219400, 1591038000
+        masked = -(2 ** 63)
+
+        test_cases = [
+            ("shift_forward", "earliest", [gap, fold, normal]),
+            ("shift_backward", "latest", [gap - 1, fold + 3600, normal]),
+            ("mask", "mask", [masked, masked, normal]),
+            ("mask", b"\x01\x01\x01", [masked, fold + 3600, normal]),
+            ("mask", [False, False, True], [masked, fold, normal]),
+        ]
+
+        for nonexistent, ambiguous, expected in test_cases:
+            with self.subTest(nonexistent=nonexistent, ambiguous=ambiguous):
+                if isinstance(ambiguous, list):
+                    ambiguous = array.array("b", ambiguous)
+                utc = array.array("q", [0, 0, 0])
+                in_gap, in_fold = bytearray(3), array.array("B", [2, 2, 2])
+                zi.toutc_timestamps(
+                    local,
+                    utc,
+                    nonexistent=nonexistent,
+                    ambiguous=ambiguous,
+                    in_gap=in_gap,
+                    in_fold=in_fold,
+                )
+                self.assertEqual(list(utc), expected)
+                self.assertEqual(list(in_gap), [1, 0, 0])
+                self.assertEqual(list(in_fold), [0, 1, 0])
+
+        utc = array.array("q", [0, 0, 0])
+        with self.assertRaisesRegex(ValueError, r"local\[0\]"):
+            zi.toutc_timestamps(local, utc, ambiguous="earliest")
+        with self.assertRaisesRegex(ValueError, r"local\[1\]"):
+            zi.toutc_timestamps(local, utc, nonexistent="mask")
+        with self.assertRaisesRegex(ValueError, r"local\[0\]"):
+            zi.toutc_timestamps(local, utc)
+
+    def test_toutc_timestamps_invalid(self):
+        zi = self.zone_from_key("America/Los_Angeles")
+        local = array.array("q", [0, 1])
+        utc = array.array("q", [0, 0])
+
+        bad_args = [
+            (TypeError, (array.array("d", [0, 1]), utc), {}),
+            (TypeError, (local, array.array("i", [0, 0])), {}),
+            (TypeError, (local, utc, "raise"), {}),
+            (TypeError, (local, utc), {"ambiguous": array.array("i", [0, 0])}),
+            (TypeError, (local, utc), {"ambiguous": None}),
+            (TypeError, (local, utc), {"in_gap": array.array("q", [0, 0])}),
+            (BufferError, (local, bytes(16)), {}),
+            (BufferError, (local, utc), {"in_fold": bytes(2)}),
+            (ValueError, (local, array.array("q", [0])), {}),
+            (ValueError, (local, utc), {"ambiguous": bytes(3)}),
+            (ValueError, (local, utc), {"in_gap": bytearray(1)}),
+            (ValueError, (local, utc), {"in_fold": bytearray(3)}),
+            (ValueError, (local, utc), {"nonexistent": "shift"}),
+            (ValueError, (local, utc), {"nonexistent": None}),
+            (ValueError, (local, utc), {"ambiguous": "first"}),
+            (OverflowError, (array.array("q", [0, 2 ** 40]), utc), {}),
+        ]
+
+        for exc_type, args, kwargs in bad_args:
+            with self.subTest(args=args, kwargs=kwargs):
+                with self.assertRaises(exc_type):
+                    zi.toutc_timestamps(*args, **kwargs)
+
     def test_folds_from_utc(self):
         for key in self.zones():
             zi = self.zone_from_key(key)
@@ -384,6 +673,109 @@ class ZoneInfoTest(TzPathUserMixin, ZoneInfoTestBase):
                     dt_after = dt_after_utc.astimezone(zi)
                     self.assertEqual(dt_after.fold, 1, (dt_after, dt_utc))
 
+    def test_sequential_lookups(self):
+        # Lookups that move forwards and backwards across each transition in
+        # small steps, on a single zone object (which may remember where the
+        # previous lookup landed)
+        for key in self.zones():
+            zi = self.zone_from_key(key)
+            with self.subTest(key=key):
+                for zt in self.load_transition_examples(key):
+                    trans_utc = zt.transition_utc
+                    fold_end = trans_utc - min(zt.delta, ZERO)
+
+                    steps = [timedelta(minutes=10 * i) for i in range(-9, 10)]
+                    steps += [timedelta(seconds=s) for s in (-1, 1)]
+                    steps.sort()
+                    steps += steps[::-1]
+
+                    for step in steps:
+                        dt_utc = trans_utc + step
+                        if dt_utc < trans_utc:
+                            offset = zt.offset_before
+                        else:
+                            offset = zt.offset_after
+                        fold = int(trans_utc <= dt_utc < fold_end)
+
+                        dt = dt_utc.astimezone(zi)
+                        self.assertEqual(dt.utcoffset(), offset.utcoffset, dt)
+                        self.assertEqual(dt.fold, fold, dt)
+
+                        dt_local = dt_utc + offset.utcoffset
+                        dt_local = dt_local.replace(tzinfo=zi, fold=fold)
+                        self.assertEqual(
+                            dt_local.utcoffset(), offset.utcoffset, dt_local
+                        )
+
+    def test_fromutc_range(self):
+        # Conversions that would leave the range of datetime raise
+        # OverflowError, like datetime arithmetic does
+        out_of_range = [
+            ("Africa/Abidjan", datetime.min),  # LMT is UTC-00:16:08
+            ("Asia/Tokyo", datetime.max),
+        ]
+
+        for key, dt_utc in out_of_range:
+            zi = self.zone_from_key(key)
+            with self.subTest(key=key, dt_utc=dt_utc):
+                with self.assertRaises(OverflowError):
+                    zi.fromutc(dt_utc.replace(tzinfo=zi))
+
+        for key, dt_utc in [
+            ("Africa/Abidjan", datetime.max),
+            ("Asia/Tokyo", datetime.min + timedelta(hours=9)),
+        ]:
+            zi = self.zone_from_key(key)
+            with self.subTest(key=key, dt_utc=dt_utc):
+                dt = zi.fromutc(dt_utc.replace(tzinfo=zi))
+                dt_expected = dt_utc + dt.utcoffset()
+                self.assertEqual(dt.replace(tzinfo=None), dt_expected)
+
+    def test_datetime_subclass_use_attributes(self):
+        # A subclass that overrides the fields of the datetime, and opts in to
+        # having its attributes used to look up the offset
+        class JulyDatetime(datetime):
+            __zoneinfo_use_attributes__ = True
+
+            def toordinal(self):
+                return date(self.year, 7, self.day).toordinal()
+
+        for key in self.zones():
+            zi = self.zone_from_key(key)
+            with self.subTest(key=key):
+                for year in (1950, 2020, 2050):
+                    dt = JulyDatetime(year, 1, 15, 12, tzinfo=zi)
+                    dt_july = datetime(year, 7, 15, 12, tzinfo=zi)
+
+                    self.assertEqual(dt.utcoffset(), dt_july.utcoffset())
+                    self.assertEqual(dt.dst(), dt_july.dst())
+                    self.assertEqual(dt.tzname(), dt_july.tzname())
+
+    def test_datetime_subclass_use_attributes_shifted_year(self):
+        # A subclass whose toordinal() is in a different year from its year
+        # attribute, beyond the last transition of the zone, where the
+        # offset depends on the year the rule is applied in
+        class ShiftedDatetime(datetime):
+            __zoneinfo_use_attributes__ = True
+
+            def toordinal(self):
+                return super().toordinal() - 30 * 365
+
+        zi = self.zone_from_key("America/Los_Angeles")
+        shifted = ShiftedDatetime(2080, 7, 15, 12, tzinfo=zi)
+        local = datetime.fromordinal(shifted.toordinal()).replace(hour=12)
+
+        dts = [local] + [datetime(year, 7, 1) for year in (2045, 2080, 2100)]
+        expected = [dt.replace(tzinfo=zi).utcoffset() for dt in dts]
+
+        self.assertEqual(shifted.utcoffset(), expected[0])
+
+        # The lookup for the subclass does not affect later ones with plain
+        # datetimes on the same instance
+        for dt, offset in zip(dts, expected):
+            with self.subTest(dt=dt):
+                self.assertEqual(dt.replace(tzinfo=zi).utcoffset(), offset)
+
     def test_time_variable_offset(self):
         # self.zones() only ever returns variable-offset zones
         for key in self.zones():
@@ -460,6 +852,87 @@ class CZoneInfoTest(ZoneInfoTest):
                 self.assertEqual(dt_fromutc.fold, 1)
                 self.assertEqual(dt.fold, 0)
 
+    def test_truncated_zones(self):
+        """Test that the C TZif parser rejects truncated files.
+
+        The pure Python parser raises whatever error struct.unpack happens to
+        raise on truncated input, but the C parser checks the sizes declared
+        in the header against the length of the file.
+        """
+        key = "America/Los_Angeles"
+        with open(self.zoneinfo_data.path_from_key(key), "rb") as f:
+            contents = f.read()
+
+        for size in (43, 44, 100, len(contents) // 2, len(contents) - 1):
+            with self.subTest(size=size):
+                fobj = io.BytesIO(contents[:size])
+                with self.assertRaises(ValueError):
+                    self.klass.from_file(fobj)
+
+    def test_large_file(self):
+        """Test loading a file large enough to be memory-mapped.
+
+        The C extension reads small files directly, but maps large ones;
+        anything after the TZ string footer is ignored, so we can pad a real
+        zone to force the mapped code path.
+        """
+        key = "America/Los_Angeles"
+        with open(self.zoneinfo_data.path_from_key(key), "rb") as f:
+            contents = f.read()
+
+        with tempfile.TemporaryDirectory() as tzpath:
+            with open(os.path.join(tzpath, "Padded"), "wb") as f:
+                f.write(contents + b"\x00" * (128 * 1024))
+
+            with self.tzpath_context([tzpath]):
+                zi_padded = self.klass.no_cache("Padded")
+
+        zi = self.zone_from_key(key)
+        for zt in self.load_transition_examples(key):
+            dt = zt.transition
+            with self.subTest(dt=dt):
+                self.assertEqual(
+                    dt.replace(tzinfo=zi_padded).utcoffset(),
+                    dt.replace(tzinfo=zi).utcoffset(),
+                )
+
+    def test_lazy_lookup_order(self):
+        """Test that results don't depend on which lookup happens first.
+
+        The C extension builds the parts of a zone needed for each kind of
+        lookup on first use, so a fresh zone is queried in several orders.
+        """
+        far_future = datetime(2300, 7, 1)
+        for key in self.zones():
+            transitions = list(self.load_transition_examples(key))
+            first = transitions[0].transition - timedelta(days=1)
+            middle = transitions[len(transitions) // 2].transition
+            dts = [far_future, first, middle, None]
+
+            expected = self.zone_from_key(key)
+            for _ in range(len(dts)):
+                dts.append(dts.pop(0))
+                zi = self.klass.no_cache(key)
+
+                with self.subTest(key=key, first=dts[0]):
+                    for dt in dts:
+                        if dt is None:
+                            self.assertEqual(
+                                time(tzinfo=zi).utcoffset(),
+                                time(tzinfo=expected).utcoffset(),
+                            )
+                            continue
+
+                        self.assertEqual(
+                            dt.replace(tzinfo=zi).utcoffset(),
+                            dt.replace(tzinfo=expected).utcoffset(),
+                        )
+                        dt_utc = dt.replace(tzinfo=timezone.utc)
+                        self.assertEqual(
+                            dt_utc.astimezone(zi).replace(tzinfo=None),
+                            dt_utc.astimezone(expected).replace(tzinfo=None),
+                        )
+
 
 class ZoneInfoDatetimeSubclassTest(DatetimeSubclassMixin, ZoneInfoTest):
     pass
@@ -516,6 +989,277 @@ class CZoneInfoV1Test(ZoneInfoV1Test):
     module = c_zoneinfo
 
 
+class ZoneInfoBundleTest(ZoneInfoTest):
+    """Runs all the ZoneInfoTest tests against zones loaded from a bundle."""
+
+    @property
+    def bundle_path(self):
+        # Each class writes its own bundle with its own module, which reads
+        # the zones from the TZPATH set up for the test
+        return TEMP_DIR / f"{type(self).__name__}.tzbundle"
+
+    def write_bundle(self, path, keys, **kwargs):
+        self.module._bundle.write_bundle(path, keys, **kwargs)
+
+    def setUp(self):
+        super().setUp()
+
+        if not self.bundle_path.exists():
+            self.write_bundle(
+                self.bundle_path, self.zoneinfo_data.keys, source="tzpath"
+            )
+
+    def zone_from_key(self, key):
+        return self.klass.from_bundle(self.bundle_path, key)
+
+    def test_bundle_missing_key(self):
+        with self.assertRaises(self.module.ZoneInfoNotFoundError):
+            self.klass.from_bundle(self.bundle_path, "Invalid/Key")
+
+    def test_bundle_not_picklable(self):
+        zi = self.zone_from_key("Europe/Dublin")
+        with self.assertRaises(pickle.PicklingError):
+            pickle.dumps(zi)
+
+    def test_bundle_replaced(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "zones.tzbundle")
+            self.write_bundle(path, ["Europe/Dublin"])
+            dublin = self.klass.from_bundle(path, "Europe/Dublin")
+
+            with self.assertRaises(self.module.ZoneInfoNotFoundError):
+                self.klass.from_bundle(path, "Asia/Tokyo")
+
+            # Replacing the bundle must not affect zones already loaded from
+            # the old version
+            self.write_bundle(path, ["Asia/Tokyo"])
+            tokyo = self.klass.from_bundle(path, "Asia/Tokyo")
+
+            dt = datetime(2020, 7, 1, 12)
+            self.assertEqual(dt.replace(tzinfo=dublin).utcoffset(), ONE_H)
+            self.assertEqual(dt.replace(tzinfo=tokyo).utcoffset(), 9 * ONE_H)
+
+    def test_bundle_invalid(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "zones.tzbundle")
+            with open(path, "wb") as f:
+                f.write(b"TZif2" + b"\x00" * 64)
+
+            with self.assertRaises(ValueError):
+                self.klass.from_bundle(path, "Europe/Dublin")
+
+
+class CZoneInfoBundleTest(ZoneInfoBundleTest):
+    module = c_zoneinfo
+
+
+class ZoneInfoSharedCacheTest(ZoneInfoTest):
+    """Runs all the ZoneInfoTest tests with a shared cache in use."""
+
+    @property
+    def cache_path(self):
+        return TEMP_DIR / "shared.tzbundle"
+
+    def setUp(self):
+        super().setUp()
+
+        # reset_tzpath, called when the test is torn down, disables it again
+        self.module.set_shared_cache(self.cache_path)
+
+    def test_shared_cache_used(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tzpath = os.path.join(tmpdir, "zoneinfo")
+            zone_path = os.path.join(tzpath, "Europe", "Dublin")
+            os.makedirs(os.path.dirname(zone_path))
+            shutil.copy(
+                self.zoneinfo_data.path_from_key("Europe/Dublin"), zone_path
+            )
+
+            cache_path = os.path.join(tmpdir, "shared.tzbundle")
+            self.module.reset_tzpath([tzpath])
+            self.module.set_shared_cache(cache_path)
+
+            # Modifying the file in place does not modify the directory, so
+            # the zone is still loaded from the shared cache.
+            tokyo_path = self.zoneinfo_data.path_from_key("Asia/Tokyo")
+            with open(zone_path, "wb") as f:
+                f.write(tokyo_path.read_bytes())
+
+            dt = datetime(2020, 7, 1, 12)
+            dublin = self.klass.no_cache("Europe/Dublin")
+            self.assertEqual(dt.replace(tzinfo=dublin).utcoffset(), ONE_H)
+
+            self.module.set_shared_cache(None)
+            tokyo = self.klass.no_cache("Europe/Dublin")
+            self.assertEqual(dt.replace(tzinfo=tokyo).utcoffset(), 9 * ONE_H)
+
+    def test_shared_cache_preload(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tzpath = os.path.join(tmpdir, "zoneinfo")
+            for key in ("Europe/Dublin", "Europe/London"):
+                zone_path = os.path.join(tzpath, key)
+                os.makedirs(os.path.dirname(zone_path), exist_ok=True)
+                shutil.copy(self.zoneinfo_data.path_from_key(key), zone_path)
+
+            cache_path = os.path.join(tmpdir, "shared.tzbundle")
+            self.module.reset_tzpath([tzpath])
+            self.module.set_shared_cache(cache_path)
+
+            # As with the constructor, the zones come from the shared cache
+            # rather than the modified files
+            tokyo_path = self.zoneinfo_data.path_from_key("Asia/Tokyo")
+            for key in ("Europe/Dublin", "Europe/London"):
+                with open(os.path.join(tzpath, key), "wb") as f:
+                    f.write(tokyo_path.read_bytes())
+
+            self.klass.clear_cache()
+            keys = ["Europe/Dublin", "Europe/London", "Europe/Dublin"]
+            zones = self.klass.preload(keys, workers=2)
+
+            for key, zone in zip(keys, zones):
+                with self.subTest(key=key):
+                    self.assertIs(zone, self.klass(key))
+                    dt = datetime(2020, 7, 1, 12, tzinfo=zone)
+                    self.assertEqual(dt.utcoffset(), ONE_H)
+
+    def test_shared_cache_rebuilt(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tzpath = os.path.join(tmpdir, "zoneinfo")
+            os.mkdir(tzpath)
+
+            cache_path = os.path.join(tmpdir, "shared.tzbundle")
+            self.module.reset_tzpath([tzpath])
+            self.module.set_shared_cache(cache_path)
+            mtime = os.stat(cache_path).st_mtime_ns
+
+            # An unchanged TZPATH does not need a new bundle
+            self.module.set_shared_cache(cache_path)
+            self.assertEqual(os.stat(cache_path).st_mtime_ns, mtime)
+
+            zone_path = os.path.join(tzpath, "Asia", "Tokyo")
+            os.mkdir(os.path.dirname(zone_path))
+            shutil.copy(
+                self.zoneinfo_data.path_from_key("Asia/Tokyo"), zone_path
+            )
+
+            self.module.set_shared_cache(cache_path)
+            self.klass.from_bundle(cache_path, "Asia/Tokyo")
+
+    def test_shared_cache_reset_tzpath(self):
+        self.assertIsNotNone(self.module._bundle.SHARED_CACHE)
+        self.module.reset_tzpath(self.tzpath)
+        self.assertIsNone(self.module._bundle.SHARED_CACHE)
+
+
+class CZoneInfoSharedCacheTest(ZoneInfoSharedCacheTest):
+    module = c_zoneinfo
+
+
+class ZoneInfoTZDataDirectoryTest(ZoneInfoTest):
+    """Runs all the ZoneInfoTest tests against a stand-in tzdata package.
+
+    The package is built from the test data, so these tests run whether or
+    not tzdata is installed.
+    """
+
+    @property
+    def tzpath(self):
+        return []
+
+    @property
+    def block_tzdata(self):
+        return False
+
+    @property
+    def tzdata_file(self):
+        return TEMP_DIR / "tzdata_dir"
+
+    @property
+    def tzdata_path(self):
+        return self.tzdata_file
+
+    def write_tzdata(self, files):
+        for name, contents in files.items():
+            file_path = self.tzdata_file / name
+            file_path.parent.mkdir(parents=True, exist_ok=True)
+            file_path.write_bytes(contents)
+
+    def setUp(self):
+        super().setUp()
+
+        if not self.tzdata_file.exists():
+            files = {}
+            for key in self.zoneinfo_data.keys:
+                *dirs, _ = key.split("/")
+                for i in range(len(dirs) + 1):
+                    package = "/".join(["tzdata", "zoneinfo"] + dirs[:i])
+                    files[f"{package}/__init__.py"] = b""
+
+                zone_file = self.zoneinfo_data.path_from_key(key)
+                files[f"tzdata/zoneinfo/{key}"] = zone_file.read_bytes()
+
+            files["tzdata/__init__.py"] = b""
+            self.write_tzdata(files)
+
+        tzdata_modules = {
+            name: sys.modules.pop(name)
+            for name in list(sys.modules)
+            if name.split(".", 1)[0] == "tzdata"
+        }
+        sys.path.insert(0, str(self.tzdata_path))
+
+        def restore_tzdata():
+            sys.path.remove(str(self.tzdata_path))
+            sys.path_importer_cache.pop(str(self.tzdata_path), None)
+            for name in list(sys.modules):
+                if name.split(".", 1)[0] == "tzdata":
+                    del sys.modules[name]
+            sys.modules.update(tzdata_modules)
+
+        self.addCleanup(restore_tzdata)
+
+    def zone_from_key(self, key):
+        return self.klass(key=key)
+
+    def test_tzdata_not_found(self):
+        for key in ["America", "America/Nowhere", "Nowhere/UTC"]:
+            with self.subTest(key=key):
+                with self.assertRaises(self.module.ZoneInfoNotFoundError):
+                    self.klass.no_cache(key)
+
+
+class CZoneInfoTZDataDirectoryTest(ZoneInfoTZDataDirectoryTest):
+    module = c_zoneinfo
+
+
+class ZoneInfoTZDataArchiveTest(ZoneInfoTZDataDirectoryTest):
+    """Runs the tests against a stand-in tzdata package in a zip file.
+
+    The package is placed in a subdirectory of the archive, with the zones
+    alternating between stored and compressed members.
+    """
+
+    @property
+    def tzdata_file(self):
+        return TEMP_DIR / "tzdata.zip"
+
+    @property
+    def tzdata_path(self):
+        return self.tzdata_file / "lib"
+
+    def write_tzdata(self, files):
+        with zipfile.ZipFile(self.tzdata_file, "w") as zf:
+            for i, (name, contents) in enumerate(sorted(files.items())):
+                compress_type = (zipfile.ZIP_STORED, zipfile.ZIP_DEFLATED)[
+                    i % 2
+                ]
+                zf.writestr(f"lib/{name}", contents, compress_type)
+
+
+class CZoneInfoTZDataArchiveTest(ZoneInfoTZDataArchiveTest):
+    module = c_zoneinfo
+
+
 @unittest.skipIf(
     not HAS_TZDATA_PKG, "Skipping tzdata-specific tests: tzdata not installed"
 )
@@ -763,6 +1507,38 @@ class WeirdZoneTest(ZoneInfoTestBase):
             self.assertEqual(dt_utc.astimezone(zi), dt)
             self.assertEqual(dt, dt_utc)
 
+    def test_batch_fold_after_last_transition(self):
+        # The fold right after the last transition is between the offsets on
+        # either side of it, not between those of the TZ string
+        LMT = ZoneOffset("LMT", timedelta(minutes=90))
+        AAA = ZoneOffset("AAA", 2 * ONE_H)
+        BBB = ZoneOffset("BBB", ONE_H)
+        transitions = [
+            ZoneTransition(datetime(1900, 1, 1), LMT, AAA),
+            ZoneTransition(datetime(2000, 1, 1, 2), AAA, BBB),
+        ]
+
+        zf = self.construct_zone(transitions, "BBB-1")
+        zi = self.klass.from_file(zf)
+
+        trans_ts = (transitions[-1].transition_utc - EPOCH_UTC) // ONE_SECOND
+        timestamps = array.array(
+            "q", [trans_ts + delta for delta in (-1, 0, 1800, 3599, 3600)]
+        )
+        offsets = array.array("i", [0]) * len(timestamps)
+        local = array.array("q", [0]) * len(timestamps)
+        fold = bytearray(len(timestamps))
+        zi.utcoffsets(timestamps, offsets)
+        zi.fromutc_timestamps(timestamps, local, fold)
+
+        self.assertEqual(list(offsets), [7200, 3600, 3600, 3600, 3600])
+        self.assertEqual(list(fold), [0, 1, 1, 1, 0])
+        for ts, local_ts, local_fold in zip(timestamps, local, fold):
+            dt = (EPOCH_UTC + timedelta(seconds=ts)).astimezone(zi)
+            with self.subTest(dt=dt):
+                self.assertEqual(local_ts, ts + dt.utcoffset() // ONE_SECOND)
+                self.assertEqual(local_fold, dt.fold)
+
     def test_fixed_offset_phantom_transition(self):
         UTC = ZoneOffset("UTC", ZERO, ZERO)
 
@@ -784,6 +1560,68 @@ class WeirdZoneTest(ZoneInfoTestBase):
             self.assertEqual(t.utcoffset(), UTC.utcoffset)
             self.assertEqual(t.dst(), UTC.dst)
 
+    def test_shared_offsets(self):
+        # Zones with the same offsets share their timedeltas, even odd ones
+        LMT = ZoneOffset("LMT", -timedelta(hours=6, minutes=31, seconds=2))
+        STD = ZoneOffset("STD", -timedelta(hours=6))
+        CST = ZoneOffset("CST", -timedelta(hours=6))
+
+        zones = []
+        for offset in [STD, CST]:
+            transitions = [
+                ZoneTransition(datetime(1883, 6, 9, 14), LMT, offset),
+            ]
+            after = f"{offset.tzname}6"
+            zf = self.construct_zone(transitions, after)
+            zones.append(self.klass.from_file(zf))
+
+        for dt, offset in [
+            (datetime(1883, 6, 9, 1), LMT),
+            (datetime(2020, 1, 1), STD),
+        ]:
+            with self.subTest(dt=dt):
+                offset_0 = dt.replace(tzinfo=zones[0]).utcoffset()
+                offset_1 = dt.replace(tzinfo=zones[1]).utcoffset()
+                self.assertEqual(offset_0, offset.utcoffset)
+                self.assertIs(offset_0, offset_1)
+
+        info = self.timedelta_cache_info()
+        self.assertGreater(info["hits"], 0)
+        self.assertLessEqual(info["currsize"], info["maxsize"])
+
+    def test_many_offsets(self):
+        # The number of cached timedeltas is bounded, even when zones have
+        # many distinct offsets
+        zones = []
+        for i in range(32):
+            # The abbreviations are not deduplicated, so the zones must have
+            # few enough offsets to fit in 127 characters
+            offsets = [
+                ZoneOffset("A", timedelta(seconds=2551 * i + 37 * j - 80000))
+                for j in range(60)
+            ]
+            transitions = [
+                ZoneTransition(datetime(1910 + j, 1, 1), before, after)
+                for j, (before, after) in enumerate(
+                    zip(offsets, offsets[1:])
+                )
+            ]
+            zf = self.construct_zone(transitions, after="")
+            zones.append((self.klass.from_file(zf), offsets))
+
+        for zi, offsets in zones:
+            for j, offset in enumerate(offsets[1:]):
+                dt = datetime(1910 + j, 6, 1, tzinfo=zi)
+                self.assertEqual(dt.utcoffset(), offset.utcoffset)
+
+        info = self.timedelta_cache_info()
+        self.assertLessEqual(info["currsize"], info["maxsize"])
+
+    def timedelta_cache_info(self):
+        # From the module that self.klass was defined in, which may not be
+        # the one in sys.modules
+        return self.klass.utcoffset.__globals__["_timedelta_cache_info"]()
+
     def construct_zone(self, transitions, after=None, version=3):
         # These are not used for anything, so we're not going to include
         # them for now.
@@ -906,6 +1744,11 @@ class WeirdZoneTest(ZoneInfoTestBase):
 class CWeirdZoneTest(WeirdZoneTest):
     module = c_zoneinfo
 
+    def timedelta_cache_info(self):
+        from backports.zoneinfo import _czoneinfo
+
+        return _czoneinfo._timedelta_cache_info()
+
 
 class TZStrTest(ZoneInfoTestBase):
     module = py_zoneinfo
@@ -1383,10 +2226,303 @@ class ZoneInfoCacheTest(TzPathUserMixin, ZoneInfoTestBase):
         self.assertIsNot(dub0, dub1)
         self.assertIs(tok0, tok1)
 
+    def test_preload(self):
+        keys = [
+            "America/Los_Angeles",
+            "Europe/Dublin",
+            "Asia/Tokyo",
+            "Europe/Dublin",
+        ]
+
+        for workers in [None, 1, 2, 8]:
+            with self.subTest(workers=workers):
+                self.klass.clear_cache()
+                zones = self.klass.preload(iter(keys), workers=workers)
+
+                self.assertEqual([zone.key for zone in zones], keys)
+                for key, zone in zip(keys, zones):
+                    self.assertIs(zone, self.klass(key))
+
+                dt = datetime(2020, 7, 1, tzinfo=zones[0])
+                self.assertEqual(dt.utcoffset(), timedelta(hours=-7))
+
+    def test_preload_cached(self):
+        la0 = self.klass("America/Los_Angeles")
+        la1, tok = self.klass.preload(["America/Los_Angeles", "Asia/Tokyo"])
+
+        self.assertIs(la0, la1)
+        self.assertIs(tok, self.klass("Asia/Tokyo"))
+
+    def test_preload_empty(self):
+        self.assertEqual(self.klass.preload([]), [])
+
+    def test_preload_freeze(self):
+        keys = ["America/Los_Angeles", "Europe/Dublin", "Asia/Tokyo", "UTC"]
+        datetimes = [
+            datetime(1800, 1, 1),
+            datetime(1970, 1, 1),
+            datetime(2020, 3, 8, 2, 30),
+            datetime(2020, 11, 1, 1, 30, fold=1),
+            datetime(2100, 7, 1),
+        ]
+
+        # Zones loaded before they are frozen (which share their data) must
+        # still work once they are, as must zones that are frozen twice.
+        unfrozen = [self.klass.no_cache(key) for key in keys]
+        self.klass.preload(keys[:2], freeze=True)
+        zones = self.klass.preload(keys, freeze=True)
+
+        for zone, expected_zone in zip(zones + unfrozen, unfrozen * 2):
+            for dt in datetimes:
+                with self.subTest(zone=zone, dt=dt):
+                    dt_zone = dt.replace(tzinfo=zone)
+                    expected = dt.replace(tzinfo=expected_zone)
+
+                    self.assertEqual(dt_zone.utcoffset(), expected.utcoffset())
+                    self.assertEqual(dt_zone.dst(), expected.dst())
+                    self.assertEqual(dt_zone.tzname(), expected.tzname())
+
+                    dt_utc = dt.replace(tzinfo=timezone.utc)
+                    local = dt_utc.astimezone(zone)
+                    expected = dt_utc.astimezone(expected_zone)
+                    self.assertEqual(
+                        (local.replace(tzinfo=None), local.fold),
+                        (expected.replace(tzinfo=None), expected.fold),
+                    )
+
+        del zones, unfrozen
+        self.klass.clear_cache()
+        dt = datetime(2020, 7, 1, tzinfo=self.klass("Asia/Tokyo"))
+        self.assertEqual(dt.utcoffset(), timedelta(hours=9))
+
+    def test_preload_errors(self):
+        with self.assertRaises(self.module.ZoneInfoNotFoundError):
+            self.klass.preload(["Asia/Tokyo", "Invalid/Nonexistent"])
+
+        with self.assertRaises(ValueError):
+            self.klass.preload(["Asia/Tokyo", "../zoneinfo/Asia/Tokyo"])
+
+        with self.assertRaises(ValueError):
+            self.klass.preload(["Asia/Tokyo"], workers=0)
+
 
 class CZoneInfoCacheTest(ZoneInfoCacheTest):
     module = c_zoneinfo
 
+    def test_shared_zone_data(self):
+        """Tests that zones loaded from identical data share it.
+
+        The _ttinfo objects are part of the shared data, so this is visible
+        as the identity of the tzname strings.
+        """
+        dt = datetime(2020, 1, 1)
+
+        def tzname(zone):
+            return dt.replace(tzinfo=zone).tzname()
+
+        # US/Pacific is a copy of America/Los_Angeles, rather than a link
+        links = {
+            "America/Los_Angeles": "America/Los_Angeles",
+            "US/Pacific": "America/Los_Angeles",
+            "Asia/Tokyo": "Asia/Tokyo",
+        }
+
+        with tempfile.TemporaryDirectory() as td:
+            for key, target in links.items():
+                path = os.path.join(td, key)
+                os.makedirs(os.path.dirname(path), exist_ok=True)
+                shutil.copy(self.zoneinfo_data.path_from_key(target), path)
+
+            with self.tzpath_context([td]):
+                la = self.klass.no_cache("America/Los_Angeles")
+                pacific = self.klass.no_cache("US/Pacific")
+                tokyo = self.klass.no_cache("Asia/Tokyo")
+
+                with open(os.path.join(td, "US/Pacific"), "rb") as f:
+                    from_file = self.klass.from_file(f)
+
+        self.assertEqual(tzname(la), "PST")
+        self.assertIs(tzname(pacific), tzname(la))
+        self.assertIs(tzname(from_file), tzname(la))
+        self.assertIsNot(tzname(tokyo), tzname(la))
+
+        # The shared data outlives the zone that loaded it
+        expected = tzname(la)
+        del la
+        self.assertIs(tzname(pacific), expected)
+        self.assertEqual(
+            datetime(2020, 7, 1, tzinfo=pacific).utcoffset(),
+            timedelta(hours=-7),
+        )
+
+    def test_shared_tznames(self):
+        """Tests that zones with different data share their abbreviations."""
+        dt = datetime(2020, 1, 1)
+        zones = [
+            self.klass.no_cache(key)
+            for key in ("Europe/London", "Africa/Abidjan", "Europe/Dublin")
+        ]
+
+        tznames = [dt.replace(tzinfo=zone).tzname() for zone in zones]
+        self.assertEqual(tznames, ["GMT", "GMT", "GMT"])
+        self.assertIs(tznames[0], tznames[1])
+        self.assertIs(tznames[0], tznames[2])
+
+
+class ZoneInfoWatchTest(TzPathUserMixin, ZoneInfoTestBase):
+    module = py_zoneinfo
+
+    @property
+    def zoneinfo_data(self):
+        return ZONEINFO_DATA
+
+    @property
+    def tzpath(self):
+        return []
+
+    def setUp(self):
+        super().setUp()
+        self.klass.clear_cache()
+
+        self.tz_root = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.tz_root)
+        for key in ["Europe/Dublin", "Asia/Tokyo"]:
+            self.write_zone(key, key)
+
+        self.module.reset_tzpath([self.tz_root])
+
+    def write_zone(self, key, source_key):
+        """Replaces the file for `key` with the data for `source_key`."""
+        path = os.path.join(self.tz_root, key)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+
+        tmp_path = path + ".tmp"
+        shutil.copy(self.zoneinfo_data.path_from_key(source_key), tmp_path)
+        os.replace(tmp_path, path)
+
+    def watch(self, **kwargs):
+        watcher = self.klass.watch_tzpath(**kwargs)
+        self.addCleanup(watcher.stop)
+        return watcher
+
+    def utcoffset(self, zone):
+        return datetime(2020, 7, 1, tzinfo=zone).utcoffset()
+
+    def test_changed_zone_evicted(self):
+        class ZISubclass(self.klass):
+            pass
+
+        watcher = self.watch()
+        dublin = self.klass("Europe/Dublin")
+        dublin_sub = ZISubclass("Europe/Dublin")
+        tokyo = self.klass("Asia/Tokyo")
+
+        # The zones may already have been evicted by the watcher's thread,
+        # but they must have been by the time check() returns
+        self.write_zone("Europe/Dublin", "Asia/Tokyo")
+        watcher.check()
+
+        for cls, old_zone in [(self.klass, dublin), (ZISubclass, dublin_sub)]:
+            with self.subTest(cls=cls):
+                new_zone = cls("Europe/Dublin")
+                self.assertIsNot(new_zone, old_zone)
+                self.assertEqual(self.utcoffset(new_zone), 9 * ONE_H)
+
+        self.assertIs(self.klass("Asia/Tokyo"), tokyo)
+        self.assertEqual(self.utcoffset(dublin), ONE_H)
+
+    def test_link_evicted(self):
+        link_path = os.path.join(self.tz_root, "Eire")
+        try:
+            os.symlink("Europe/Dublin", link_path)
+        except (OSError, NotImplementedError):  # pragma: nocover
+            self.skipTest("Symbolic links are not supported")
+
+        watcher = self.watch()
+        eire = self.klass("Eire")
+
+        self.write_zone("Europe/Dublin", "Asia/Tokyo")
+        watcher.check()
+
+        self.assertIsNot(self.klass("Eire"), eire)
+        self.assertEqual(self.utcoffset(self.klass("Eire")), 9 * ONE_H)
+
+    def test_added_and_removed_zones(self):
+        watcher = self.watch()
+        with self.assertRaises(self.module.ZoneInfoNotFoundError):
+            self.klass("America/Los_Angeles")
+        tokyo = self.klass("Asia/Tokyo")
+
+        self.write_zone("America/Los_Angeles", "America/Los_Angeles")
+        os.remove(os.path.join(self.tz_root, "Asia/Tokyo"))
+        self.assertEqual(
+            watcher.check(), {"America/Los_Angeles", "Asia/Tokyo"}
+        )
+
+        self.klass("America/Los_Angeles")
+        with self.assertRaises(self.module.ZoneInfoNotFoundError):
+            self.klass("Asia/Tokyo")
+        self.assertEqual(self.utcoffset(tokyo), 9 * ONE_H)
+
+        # A watcher that reloads evicted zones does not find removed ones
+        # (or resolve them to their old paths) either
+        watcher.stop()
+        watcher = self.watch(reload=True)
+        self.klass("Europe/Dublin")
+        os.remove(os.path.join(self.tz_root, "Europe/Dublin"))
+        self.assertEqual(watcher.check(), {"Europe/Dublin"})
+
+        with self.assertRaises(self.module.ZoneInfoNotFoundError):
+            self.klass("Europe/Dublin")
+        with self.assertRaises(self.module.ZoneInfoNotFoundError):
+            self.klass.preload(["Europe/Dublin"])
+
+    def test_reload(self):
+        watcher = self.watch(reload=True)
+        dublin = self.klass("Europe/Dublin")
+
+        self.write_zone("Europe/Dublin", "Asia/Tokyo")
+        watcher.check()
+
+        # The new zone is loaded into the cache by the watcher
+        self.assertEqual(
+            self.klass._evict_keys(["Europe/Dublin"]), ["Europe/Dublin"]
+        )
+        self.assertIsNot(self.klass("Europe/Dublin"), dublin)
+
+    def test_tzpath_changed(self):
+        watcher = self.watch()
+        dublin = self.klass("Europe/Dublin")
+
+        # Changing TZPATH does not invalidate the cache
+        with tempfile.TemporaryDirectory() as tz_root:
+            self.module.reset_tzpath([tz_root])
+            self.assertEqual(watcher.check(), set())
+            self.assertIs(self.klass("Europe/Dublin"), dublin)
+
+    def test_stop(self):
+        with self.klass.watch_tzpath(interval=3600) as watcher:
+            dublin = self.klass("Europe/Dublin")
+
+        # Stopping the watcher again does nothing
+        watcher.stop()
+
+        self.write_zone("Europe/Dublin", "Asia/Tokyo")
+        self.assertIs(self.klass("Europe/Dublin"), dublin)
+
+    def test_invalid_interval(self):
+        for interval in [0, -1]:
+            with self.subTest(interval=interval):
+                with self.assertRaises(ValueError):
+                    self.klass.watch_tzpath(interval=interval)
+
+        with self.assertRaises(TypeError):
+            self.klass.watch_tzpath(True)
+
+
+class CZoneInfoWatchTest(ZoneInfoWatchTest):
+    module = c_zoneinfo
+
 
 class ZoneInfoPickleTest(TzPathUserMixin, ZoneInfoTestBase):
     module = py_zoneinfo
@@ -1639,6 +2775,92 @@ class TzPathTest(TzPathUserMixin, ZoneInfoTestBase):
                 with self.assertRaises(ValueError):
                     self.module.reset_tzpath(to=input_paths)
 
+    def test_tzpath_search_order(self):
+        """Tests which TZPATH entry files are found in as files are added."""
+        with open(ZONEINFO_DATA.path_from_key("Asia/Tokyo"), "rb") as f:
+            contents = f.read()
+
+        with tempfile.TemporaryDirectory() as td:
+            roots = [os.path.join(td, "first"), os.path.join(td, "second")]
+            for root in roots:
+                os.makedirs(os.path.join(root, "Asia"))
+
+            def add_zone(root, key):
+                with open(os.path.join(root, key), "wb") as f:
+                    f.write(contents)
+
+            with self.tzpath_context(roots):
+                with self.assertRaises(self.module.ZoneInfoNotFoundError):
+                    self.klass.no_cache("Asia/Tokyo")
+
+                # Files added after a directory was first searched are found
+                add_zone(roots[1], "Asia/Tokyo")
+                self.assertEqual(
+                    self.klass.no_cache("Asia/Tokyo").key, "Asia/Tokyo"
+                )
+
+                add_zone(roots[0], "Asia/Tokyo")
+                os.remove(os.path.join(roots[1], "Asia/Tokyo"))
+                self.assertEqual(
+                    self.klass.no_cache("Asia/Tokyo").key, "Asia/Tokyo"
+                )
+
+                # Symlinks to files are found, but directories are not
+                os.symlink(
+                    os.path.join(roots[0], "Asia/Tokyo"),
+                    os.path.join(roots[1], "Tokyo"),
+                )
+                self.assertEqual(self.klass.no_cache("Tokyo").key, "Tokyo")
+                with self.assertRaises(self.module.ZoneInfoNotFoundError):
+                    self.klass.no_cache("Asia")
+
+    def test_tzpath_search_order_after_listing(self):
+        """Tests that files are found in the first TZPATH entry with them,
+        even if a later entry was searched (and listed) since they were
+        added or removed."""
+        tokyo_path = ZONEINFO_DATA.path_from_key("Asia/Tokyo")
+        dublin_path = ZONEINFO_DATA.path_from_key("Europe/Dublin")
+
+        with tempfile.TemporaryDirectory() as td:
+            roots = [os.path.join(td, "first"), os.path.join(td, "second")]
+            for root in roots:
+                os.makedirs(os.path.join(root, "d"))
+            shutil.copy(tokyo_path, os.path.join(roots[1], "d/Zone"))
+
+            def utcoffset():
+                zone = self.klass.no_cache("d/Zone")
+                return datetime(2020, 7, 1, tzinfo=zone).utcoffset()
+
+            with self.tzpath_context(roots):
+                self.assertEqual(utcoffset(), timedelta(hours=9))
+
+                shutil.copy(dublin_path, os.path.join(roots[0], "d/Zone"))
+                self.assertEqual(utcoffset(), timedelta(hours=1))
+
+                os.remove(os.path.join(roots[0], "d/Zone"))
+                self.assertEqual(utcoffset(), timedelta(hours=9))
+
+    def test_tzpath_file_removed_after_listing(self):
+        with tempfile.TemporaryDirectory() as td:
+            path = os.path.join(td, "d/Zone")
+            os.makedirs(os.path.dirname(path))
+            shutil.copy(ZONEINFO_DATA.path_from_key("Asia/Tokyo"), path)
+
+            with self.tzpath_context([td]):
+                self.klass.no_cache("d/Zone")
+
+                os.remove(path)
+                with self.assertRaises(self.module.ZoneInfoNotFoundError):
+                    self.klass.no_cache("d/Zone")
+
+                shutil.copy(ZONEINFO_DATA.path_from_key("Asia/Tokyo"), path)
+                self.klass.no_cache("d/Zone")
+
+                os.remove(path)
+                self.klass.clear_cache()
+                with self.assertRaises(self.module.ZoneInfoNotFoundError):
+                    self.klass.preload(["d/Zone"])
+
     def test_tzpath_type_error(self):
         bad_values = [
             "/etc/zoneinfo:/usr/share/zoneinfo",
@@ -1791,10 +3013,76 @@ class TestModule(ZoneInfoTestBase):
                 actual = self.module.available_timezones()
                 self.assertEqual(actual, expected)
 
+    def test_available_timezones_updated(self):
+        """Tests that the cached zones are updated when TZPATH changes."""
+        with tempfile.TemporaryDirectory() as td:
+            self.touch_zone("Europe/London", td)
+
+            with self.tzpath_context([td]):
+                actual = self.module.available_timezones()
+                self.assertEqual(actual, {"Europe/London"})
+
+                # Each call returns a new set
+                actual.add("America/New_York")
+                actual = self.module.available_timezones()
+                self.assertEqual(actual, {"Europe/London"})
+
+                self.touch_zone("America/New_York", td)
+                self.touch_zone("UTC", td)
+                os.remove(os.path.join(td, "Europe", "London"))
+
+                actual = self.module.available_timezones()
+                self.assertEqual(actual, {"America/New_York", "UTC"})
+
 
 class CTestModule(TestModule):
     module = c_zoneinfo
 
+    def test_civil_dates(self):
+        """Tests the C date arithmetic against its reference implementation."""
+        from backports.zoneinfo import _czoneinfo
+
+        _czoneinfo._check_civil_dates()
+
+    def test_walk_tzpath(self):
+        """Tests that the C TZPATH walker matches the pure Python one."""
+        from backports.zoneinfo import _czoneinfo, _tzpath
+
+        if not hasattr(_czoneinfo, "_walk_tzpath"):  # pragma: nocover
+            self.skipTest("No C TZPATH walker on this platform")
+
+        with tempfile.TemporaryDirectory() as td:
+            for key in ["UTC", "Europe/London", "America/Argentina/Salta"]:
+                self.touch_zone(key, td)
+                self.touch_zone(f"right/{key}", td)
+
+            with open(os.path.join(td, "zone.tab"), "w") as f:
+                f.write("# Not a TZif file\n")
+            os.symlink(os.path.join(td, "UTC"), os.path.join(td, "Zulu"))
+            os.symlink(os.path.join(td, "right"), os.path.join(td, "posix"))
+            os.symlink(os.path.join(td, "Europe"), os.path.join(td, "EU"))
+
+            for root in [td, td + "/"]:
+                with self.subTest(root=root):
+                    keys, dir_mtimes = _czoneinfo._walk_tzpath(root)
+                    py_keys, py_dir_mtimes = _tzpath._walk_tzpath_py(root)
+
+                    def normalize(dir_mtimes):
+                        return {
+                            os.path.normpath(d): m
+                            for d, m in dir_mtimes.items()
+                        }
+
+                    self.assertEqual(sorted(keys), sorted(py_keys))
+                    self.assertEqual(
+                        normalize(dir_mtimes), normalize(py_dir_mtimes)
+                    )
+
+            self.assertEqual(
+                sorted(keys),
+                ["America/Argentina/Salta", "Europe/London", "UTC", "Zulu"],
+            )
+
 
 @unittest.skipIf(IS_PYPY, "C Extension not built on PyPy")
 class ExtensionBuiltTest(unittest.TestCase):